@@ -75,11 +75,12 @@ public:
 	DISPATCH0(transitive_reduction);
 	DISPATCH0(calculate_A_statistics);
 	DISPATCH0(collapse_unbranched_paths);
-	DISPATCH0(min_cost_circulation);
+	DISPATCH1(min_cost_circulation, circulation_solver);
 	DISPATCH1(print_stats, std::ostream &);
 	DISPATCH1(write, const char *);
 	DISPATCH1(extract_edge_seqs, BaseVecVec &);
+	DISPATCH1(map_contained_reads, const std::vector<ContainedReadEnd> &);
+	DISPATCH1(set_read_weights, const std::vector<float> &);
 	DISPATCH2(print, std::ostream &, bool);
 	DISPATCH2(print_dot, std::ostream &, bool);
-	DISPATCH3(map_contained_read, size_t, size_t, size_t);
 };
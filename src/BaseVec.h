@@ -1,12 +1,15 @@
 #pragma once
 
 #include "BaseUtils.h"
+#include "checksum.h"
 #include "util.h"
 
 #include <boost/serialization/split_member.hpp>
+#include <algorithm>
 #include <string>
 #include <ostream>
 #include <string.h>
+#include <stdint.h>
 
 //
 // Vector of DNA bases, stored in binary format (2 bits per base).
@@ -17,6 +20,7 @@ public:
 	typedef unsigned size_type;
 private:
 	size_type _size;
+	size_type _capacity;
 	storage_type *_bases;
 	static const size_type BITS_PER_BASE = 2;
 	static const size_type BASES_PER_BYTE = 8 / BITS_PER_BASE;
@@ -44,6 +48,22 @@ public:
 		return DIV_ROUND_UP(_size, BASES_PER_BYTE);
 	}
 
+	// Update the checksum @sum with the length and bases of this BaseVec.
+	// The unused bits of the last byte are not included, since they are
+	// not necessarily zero.
+	uint64_t update_checksum(uint64_t sum) const
+	{
+		sum = checksum_update(sum, &_size, sizeof(_size));
+		const size_type full_bytes = _size / BASES_PER_BYTE;
+		sum = checksum_update(sum, _bases, full_bytes);
+		if (full_bytes != length_bytes()) {
+			const storage_type last = _bases[full_bytes] &
+				((1 << ((_size % BASES_PER_BYTE) * BITS_PER_BASE)) - 1);
+			sum = checksum_update(sum, &last, 1);
+		}
+		return sum;
+	}
+
 	// Get the binary base in this BaseVec at index @idx.
 	unsigned char operator[](size_type idx) const
 	{
@@ -82,20 +102,156 @@ public:
 	template <class Archive>
 	void load(Archive & ar, unsigned version)
 	{
-		ar >> _size;
-		resize(_size);
+		size_type size;
+		ar >> size;
+		clear();
+		resize(size);
 		ar.load_binary(_bases, length_bytes());
 	}
 	BOOST_SERIALIZATION_SPLIT_MEMBER()
 
-	// Resizes this BaseVec to hold up to @size bases.
+	// Return the number of bases this BaseVec can hold without
+	// reallocating its storage.
+	size_type capacity() const
+	{
+		return _capacity;
+	}
+
+	// Make this BaseVec able to hold at least @capacity bases without
+	// reallocating its storage.  The bases in it are preserved.
+	void reserve(size_type capacity)
+	{
+		if (capacity <= _capacity)
+			return;
+		capacity = DIV_ROUND_UP(capacity, BASES_PER_STORAGE_TYPE) *
+			   BASES_PER_STORAGE_TYPE;
+		storage_type *bases = new storage_type[capacity / BASES_PER_BYTE];
+		if (_bases)
+			memcpy(bases, _bases, length_bytes());
+		delete[] _bases;
+		_bases = bases;
+		_capacity = capacity;
+	}
+
+	// Resizes this BaseVec to hold @size bases.  The bases up to the old
+	// size or the new size, whichever is less, are preserved; any bases
+	// after them are undefined.
 	void resize(size_type size)
 	{
+		reserve(size);
 		_size = size;
-		delete[] _bases;
-		_bases = new storage_type[length_bytes()];
 	}
 
+	// Make this BaseVec empty, keeping its storage.
+	void clear()
+	{
+		_size = 0;
+	}
+
+	// Append the bases [@beg, @beg + @len) of @bv to this BaseVec.
+	//
+	// Once this BaseVec has been filled up to a byte boundary, the bases
+	// are copied 32 at a time as 64-bit words.
+	void append(const BaseVec & bv, size_type beg, size_type len)
+	{
+		assert(beg + len <= bv.size());
+		assert(&bv != this);
+		grow_for_append(len);
+		while (len != 0 && _size % BASES_PER_BYTE != 0) {
+			push_back(bv[beg++]);
+			len--;
+		}
+		for (; len >= BASES_PER_WORD; len -= BASES_PER_WORD) {
+			store_word(_size, bv.load_word(beg));
+			_size += BASES_PER_WORD;
+			beg += BASES_PER_WORD;
+		}
+		while (len--)
+			push_back(bv[beg++]);
+	}
+
+	// Append the reverse complement of the bases [@beg, @beg + @len) of
+	// @bv to this BaseVec, in the same way as append().
+	void append_rc(const BaseVec & bv, size_type beg, size_type len)
+	{
+		assert(beg + len <= bv.size());
+		assert(&bv != this);
+		grow_for_append(len);
+		while (len != 0 && _size % BASES_PER_BYTE != 0) {
+			len--;
+			push_back(3 ^ bv[beg + len]);
+		}
+		for (; len >= BASES_PER_WORD; len -= BASES_PER_WORD) {
+			store_word(_size, reverse_complement_word(
+					bv.load_word(beg + len - BASES_PER_WORD)));
+			_size += BASES_PER_WORD;
+		}
+		while (len--)
+			push_back(3 ^ bv[beg + len]);
+	}
+
+	// Append the binary base @base to this BaseVec.
+	void push_back(unsigned char base)
+	{
+		grow_for_append(1);
+		_size++;
+		set(_size - 1, base);
+	}
+
+	// Number of bases in the 64-bit words used by load_word().
+	static const size_type BASES_PER_WORD = 64 / BITS_PER_BASE;
+
+	// Return the bases [@idx, @idx + BASES_PER_WORD) as a 64-bit word in
+	// the same layout as the storage: base @idx + i in bits 2i and 2i + 1.
+	uint64_t load_word(size_type idx) const
+	{
+		assert2(idx + BASES_PER_WORD <= _size);
+		const size_type byte = idx / BASES_PER_BYTE;
+		const unsigned shift = (idx % BASES_PER_BYTE) * BITS_PER_BASE;
+		uint64_t word = 0;
+		for (unsigned i = 0; i < 8; i++)
+			word |= uint64_t(_bases[byte + i]) << (8 * i);
+		if (shift != 0)
+			word = (word >> shift) |
+			       (uint64_t(_bases[byte + 8]) << (64 - shift));
+		return word;
+	}
+
+	// Return the reverse complement of the 32 bases in the 64-bit word
+	// @word.
+	static uint64_t reverse_complement_word(uint64_t word)
+	{
+		word = ~word;
+		word = ((word >> 2) & 0x3333333333333333ULL) |
+		       ((word & 0x3333333333333333ULL) << 2);
+		word = ((word >> 4) & 0x0f0f0f0f0f0f0f0fULL) |
+		       ((word & 0x0f0f0f0f0f0f0f0fULL) << 4);
+		return __builtin_bswap64(word);
+	}
+
+private:
+	// Make room for @len more bases, at least doubling the capacity if the
+	// storage has to be reallocated, so that repeated appends take
+	// amortized constant time per base.
+	void grow_for_append(size_type len)
+	{
+		if (_size + len > _capacity)
+			reserve(std::max(_size + len, _capacity * 2));
+	}
+
+	// Store the bases in the 64-bit word @word, in the layout returned by
+	// load_word(), at position @idx, which must be at the start of a byte.
+	void store_word(size_type idx, uint64_t word)
+	{
+		assert2(idx % BASES_PER_BYTE == 0);
+		assert2(idx + BASES_PER_WORD <= _capacity);
+		const size_type byte = idx / BASES_PER_BYTE;
+		for (unsigned i = 0; i < 8; i++)
+			_bases[byte + i] = storage_type(word >> (8 * i));
+	}
+
+public:
+
 	// Initializes this BaseVec from a text string of A's, T's, C's, and
 	// G's.
 	void load_from_text(const std::string &s)
@@ -120,15 +276,11 @@ public:
 		assert(end >= beg);
 		assert(end < size());
 
-		size_type len = end - beg + 1;
-		dest.resize(len);
-		if (rc) {
-			for (size_type i = 0; i < len; i++)
-				dest.set(i, (3 ^ (*this)[end - i]));
-		} else {
-			for (size_type i = 0; i < len; i++)
-				dest.set(i, (*this)[beg + i]);
-		}
+		dest.clear();
+		if (rc)
+			dest.append_rc(*this, beg, end - beg + 1);
+		else
+			dest.append(*this, beg, end - beg + 1);
 	}
 
 	// Print the sequence contained in this BaseVec
@@ -142,11 +294,13 @@ public:
 	BaseVec()
 	{
 		_size = 0;
+		_capacity = 0;
 		_bases = NULL;
 	}
 
 	void set_from_bv(const BaseVec & bv)
 	{
+		clear();
 		resize(bv.size());
 		memcpy(_bases, bv._bases, bv.length_bytes());
 	}
@@ -168,6 +322,7 @@ public:
 	void destroy()
 	{
 		_size = 0;
+		_capacity = 0;
 		delete[] _bases;
 		_bases = NULL;
 	}
@@ -1,12 +1,18 @@
 #include "BaseVecVec.h"
+#include "PackedIntVec.h"
 #include "util.h"
 #include <string.h>
+#include <sys/stat.h>
 #include <string>
 
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/algorithm/string/trim.hpp>
+#include <boost/serialization/collection_size_type.hpp>
+#include <boost/serialization/item_version_type.hpp>
+#include <boost/serialization/split_member.hpp>
 #include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 
 #include <iostream>
 #include <fstream>
@@ -42,43 +48,18 @@ BaseVecVec::file_type BaseVecVec::detect_file_type(const char *filename)
 	fatal_error("`%s': Unknown file type", filename);
 }
 
-// Create a new BaseVec from the ASCII read @seq and add it to this BaseVecVec.
-void BaseVecVec::push_ascii_seq(const std::string &seq)
+// Return the type of the reads file @filename to write from its extension:
+// FASTQ for .fq or .fastq, FASTA for .fa or .fasta, and otherwise native.
+BaseVecVec::file_type BaseVecVec::file_type_from_extension(const char *filename)
 {
-	BaseVec bv;
-	bv.load_from_text(seq);
-	this->push_back(bv);
-}
-
-// Load the reads from a FASTA file into this BaseVecVec.
-void BaseVecVec::load_fasta(std::istream &in)
-{
-	std::string seq;
-	std::string s;
-	BaseVec cur_bv;
-	while (in >> s) {
-		boost::algorithm::trim_right(s);
-		if (s[0] == '>') {
-			if (seq.size() != 0) {
-				this->push_ascii_seq(seq);
-				seq.clear();
-			}
-		} else {
-			seq += s;
-		}
-	}
-	if (seq.size() != 0)
-		this->push_ascii_seq(seq);
-}
-
-// Load the reads from a FASTQ file into this BaseVecVec.
-void BaseVecVec::load_fastq(std::istream &in)
-{
-	std::string tag, seq, sep, quals;
-	while (in >> tag && in >> seq && in >> sep && in >> quals) {
-		boost::algorithm::trim_right(seq);
-		this->push_ascii_seq(seq);
+	const char *dot = strrchr(filename, '.');
+	if (dot) {
+		if (strcasecmp(dot + 1, "fq") == 0 || strcasecmp(dot + 1, "fastq") == 0)
+			return FASTQ;
+		else if (strcasecmp(dot + 1, "fa") == 0 || strcasecmp(dot + 1, "fasta") == 0)
+			return FASTA;
 	}
+	return NATIVE;
 }
 
 // Load the reads from a file into this BaseVecVec.  The file may be in FASTA,
@@ -88,85 +69,358 @@ void BaseVecVec::read(const char *filename, BaseVecVec::file_type ft)
 	if (ft == AUTODETECT)
 		ft = detect_file_type(filename);
 	//info("Loading \"%s\" (filetype: %s)", filename, file_type_string(ft));
-	std::ifstream in(filename);
-	switch (ft) {
-	case NATIVE: {
-			char buf[MAGIC_LEN];
-			in.read(buf, MAGIC_LEN);
-			boost::archive::binary_iarchive ar(in);
-			ar >> *this;
-		}
-		break;
-	case FASTA:
-		load_fasta(in);
-		break;
-	case FASTQ:
-		load_fastq(in);
-		break;
-	default:
-		assert(0);
+	if (ft == NATIVE) {
+		std::ifstream in(filename);
+		char buf[MAGIC_LEN];
+		in.read(buf, MAGIC_LEN);
+		boost::archive::binary_iarchive ar(in);
+		ar >> *this;
+	} else {
+		BaseVecVecReader reader(filename, ft);
+		BaseVec bv;
+		while (reader.next(bv))
+			this->push_back(bv);
 	}
 	//info("Loaded %zu reads from \"%s\")", this->size(), filename);
 }
 
 // Write the BaseVecVec to a file in FASTA, FASTQ, or native binary format.
+//
+// In native format, the table of read lengths is also written alongside the
+// reads, to the file named by lengths_filename().
 void BaseVecVec::write(const char *filename, file_type ft) const
 {
-	if (ft == AUTODETECT) {
-		const char *dot = strrchr(filename, '.');
-		ft = NATIVE;
-		if (dot) {
-			if (strcasecmp(dot + 1, "fq") == 0 || strcasecmp(dot + 1, "fastq") == 0)
-				ft = FASTQ;
-			else if (strcasecmp(dot + 1, "fa") == 0 || strcasecmp(dot + 1, "fasta") == 0)
-				ft = FASTA;
-		}
-	}
 	//info("Writing \"%s\" [filetype: %s]", filename, file_type_string(ft));
-	std::ofstream out(filename);
-	switch (ft) {
-	case NATIVE: {
-			out.write(magic, MAGIC_LEN);
-			boost::archive::binary_oarchive ar(out);
-			ar << *this;
+	BaseVecVecWriter writer(filename, ft);
+	for (size_t i = 0; i < this->size(); i++)
+		writer.push_back((*this)[i]);
+	writer.close();
+	//info("Wrote %zu reads to \"%s\"", this->size(), filename);
+}
+
+// Fill in @lens with the length of each read in this BaseVecVec, using the
+// fewest bytes per entry that can hold the longest read.
+void BaseVecVec::get_lengths(PackedIntVec & lens) const
+{
+	size_t max_len = 0;
+	for (size_t i = 0; i < this->size(); i++)
+		max_len = std::max<size_t>(max_len, (*this)[i].size());
+	lens.resize(this->size(), PackedIntVec::bytes_needed(max_len));
+	for (size_t i = 0; i < this->size(); i++)
+		lens.set(i, (*this)[i].size());
+}
+
+// Return a checksum of the first @num_reads reads in this BaseVecVec, which
+// depends only on their bases and not on how they are stored.
+uint64_t BaseVecVec::checksum(size_t num_reads) const
+{
+	assert(num_reads <= this->size());
+	uint64_t sum = CHECKSUM_INIT;
+	for (size_t i = 0; i < num_reads; i++)
+		sum = (*this)[i].update_checksum(sum);
+	return sum;
+}
+
+// Return the name of the read length table that is written alongside the
+// native-format reads file @filename.
+std::string BaseVecVec::lengths_filename(const char *filename)
+{
+	return std::string(filename) + ".lens";
+}
+
+// Header at the beginning of a read length table, which records the size of the
+// reads file and the number of reads in it when the table was written.  The
+// lengths follow as a PackedIntVec.
+struct read_lengths_header {
+	char magic[10];
+	uint64_t reads_file_size;
+	uint64_t num_reads;
+};
+
+static const char read_lengths_magic[10] =
+	{'R', 'e', 'a', 'd', 'L', 'e', 'n', 's', '\0', '\0'};
+
+// Write the read length table @lens of the native-format reads file
+// @filename, which must already have been written in full.
+void BaseVecVec::write_lengths(const char *filename, const PackedIntVec & lens)
+{
+	struct stat stbuf;
+	if (stat(filename, &stbuf) != 0)
+		fatal_error_with_errno("Error reading \"%s\"", filename);
+	read_lengths_header hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, read_lengths_magic, sizeof(read_lengths_magic));
+	hdr.reads_file_size = stbuf.st_size;
+	hdr.num_reads = lens.size();
+
+	const std::string lens_file = lengths_filename(filename);
+	std::ofstream out(lens_file.c_str());
+	out.write((const char*)&hdr, sizeof(hdr));
+	lens.write(out);
+	out.close();
+	if (!out)
+		fatal_error_with_errno("Error writing to \"%s\"",
+				       lens_file.c_str());
+}
+
+// Return %true iff the read length table @lens_file was written for the reads
+// file @filename as it is now: the reads file is in the native format and has
+// the size and number of reads recorded in the table's header, @hdr.
+static bool lengths_up_to_date(const char *filename, const std::string & lens_file,
+			       read_lengths_header & hdr)
+{
+	std::ifstream in(lens_file.c_str());
+	if (!in.read((char*)&hdr, sizeof(hdr)) ||
+	    memcmp(hdr.magic, read_lengths_magic, sizeof(read_lengths_magic)) != 0)
+		return false;
+	struct stat stbuf;
+	if (stat(filename, &stbuf) != 0 ||
+	    uint64_t(stbuf.st_size) != hdr.reads_file_size)
+		return false;
+	BaseVecVecReader reader(filename);
+	return reader.type() == BaseVecVec::NATIVE &&
+	       reader.num_left() == hdr.num_reads;
+}
+
+// Load the length of each read in the reads file @filename into @lens, without
+// loading the reads themselves if possible.
+//
+// The read length table written alongside the reads file is used if the size of
+// the reads file and the number of reads in it are those recorded in the table,
+// so that a table left over from different reads is not trusted just because
+// its modification time is recent enough.  Otherwise, the reads are loaded and
+// measured.
+void BaseVecVec::read_lengths(const char *filename, PackedIntVec & lens)
+{
+	const std::string lens_file = lengths_filename(filename);
+	read_lengths_header hdr;
+
+	if (lengths_up_to_date(filename, lens_file, hdr)) {
+		lens.read(lens_file.c_str(), sizeof(hdr));
+		if (lens.size() == hdr.num_reads)
+			return;
+	}
+	info("No up-to-date read length table for \"%s\"; loading the reads",
+	     filename);
+	BaseVecVec bvv(filename);
+	bvv.get_lengths(lens);
+}
+
+namespace {
+
+//
+// Stand-ins for a BaseVecVec and its std::vector<BaseVec> base, with the same
+// serialization traits, for reading and writing the native format a read at a
+// time.  Serializing a native_header reads or writes exactly what boost writes
+// for a BaseVecVec before its first read: the class information of the two
+// classes and the number of reads.  The reads follow, each serialized as a
+// BaseVec on its own.
+//
+struct native_vector_header {
+	boost::serialization::collection_size_type count;
+
+	// Where the number of reads was written, so that it can be updated.
+	std::ostream *out;
+	mutable std::streampos count_pos;
+
+	native_vector_header(size_t _count, std::ostream *_out)
+		: count(_count), out(_out)
+	{ }
+
+	template <class Archive>
+	void save(Archive & ar, unsigned version) const
+	{
+		count_pos = out->tellp();
+		ar << count;
+		const boost::serialization::item_version_type
+			item_version(boost::serialization::version<BaseVec>::value);
+		ar << item_version;
+	}
+
+	template <class Archive>
+	void load(Archive & ar, unsigned version)
+	{
+		ar >> count;
+		boost::serialization::item_version_type item_version(0);
+		if (boost::archive::library_version_type(3) < ar.get_library_version())
+			ar >> item_version;
+	}
+	BOOST_SERIALIZATION_SPLIT_MEMBER()
+};
+
+struct native_header : public native_vector_header {
+	native_header(size_t _count, std::ostream *_out)
+		: native_vector_header(_count, _out)
+	{ }
+
+	template <class Archive>
+	void serialize(Archive & ar, unsigned version)
+	{
+		ar & boost::serialization::base_object<native_vector_header>(*this);
+	}
+};
+
+} // end anonymous namespace
+
+BaseVecVecReader::BaseVecVecReader(const char *filename, BaseVecVec::file_type ft)
+	: _filename(filename), _ft(ft), _ar(NULL), _num_left(0)
+{
+	if (_ft == BaseVecVec::AUTODETECT)
+		_ft = BaseVecVec::detect_file_type(filename);
+	_in.open(filename);
+	if (!_in)
+		fatal_error_with_errno("Error opening \"%s\"", filename);
+	if (_ft == BaseVecVec::NATIVE) {
+		char buf[BaseVecVec::MAGIC_LEN];
+		_in.read(buf, BaseVecVec::MAGIC_LEN);
+		_ar = new boost::archive::binary_iarchive(_in);
+		native_header hdr(0, NULL);
+		*_ar >> hdr;
+		_num_left = hdr.count;
+	}
+}
+
+BaseVecVecReader::~BaseVecVecReader()
+{
+	delete _ar;
+}
+
+bool BaseVecVecReader::next(BaseVec & bv)
+{
+	bv = BaseVec();
+	switch (_ft) {
+	case BaseVecVec::NATIVE:
+		if (_num_left == 0)
+			return false;
+		*_ar >> bv;
+		_num_left--;
+		return true;
+	case BaseVecVec::FASTA: {
+			// The sequence of a record is all the lines up to the
+			// next header line.
+			std::string seq;
+			std::string s;
+			while (_in >> s) {
+				boost::algorithm::trim_right(s);
+				if (s[0] == '>') {
+					if (seq.size() != 0)
+						break;
+				} else {
+					seq += s;
+				}
+			}
+			if (seq.size() == 0)
+				return false;
+			bv.load_from_text(seq);
+			return true;
+		}
+	case BaseVecVec::FASTQ: {
+			std::string tag, seq, sep, quals;
+			if (!(_in >> tag && _in >> seq && _in >> sep && _in >> quals))
+				return false;
+			boost::algorithm::trim_right(seq);
+			bv.load_from_text(seq);
+			return true;
 		}
+	default:
+		assert(0);
+	}
+	return false;
+}
+
+size_t BaseVecVecReader::read_batch(BaseVecVec & batch, size_t max_reads)
+{
+	for (size_t i = 0; i < batch.size(); i++)
+		batch[i].destroy();
+	batch.clear();
+	BaseVec bv;
+	while (batch.size() < max_reads && next(bv))
+		batch.push_back(bv);
+	return batch.size();
+}
+
+BaseVecVecWriter::BaseVecVecWriter(const char *filename, BaseVecVec::file_type ft)
+	: _filename(filename), _ft(ft), _num_written(0), _ar(NULL)
+{
+	if (_ft == BaseVecVec::AUTODETECT)
+		_ft = BaseVecVec::file_type_from_extension(filename);
+	_out.open(filename);
+	if (!_out)
+		fatal_error_with_errno("Error opening \"%s\"", filename);
+	if (_ft == BaseVecVec::NATIVE) {
+		// The number of reads is not known yet, so it is written as
+		// 0 and filled in by close().
+		_out.write(BaseVecVec::magic, BaseVecVec::MAGIC_LEN);
+		_ar = new boost::archive::binary_oarchive(_out);
+		const native_header hdr(0, &_out);
+		*_ar << hdr;
+		_count_pos = hdr.count_pos;
+	}
+}
+
+BaseVecVecWriter::~BaseVecVecWriter()
+{
+	delete _ar;
+}
+
+void BaseVecVecWriter::push_back(const BaseVec & bv)
+{
+	switch (_ft) {
+	case BaseVecVec::NATIVE:
+		*_ar << bv;
+		_lens.push_back(bv.size());
 		break;
-	case FASTA:
-		for (size_t i = 0; i < this->size(); i++) {
-			const BaseVec &bv = (*this)[i];
-			out << ">read_" << i + 1 << '\n';
+	case BaseVecVec::FASTA: {
+			_out << ">read_" << _num_written + 1 << '\n';
 			size_t chars_in_line = 0;
 			for (size_t j = 0; j < bv.size(); j++) {
-				out << BaseUtils::bin_to_ascii(bv[j]);
+				_out << BaseUtils::bin_to_ascii(bv[j]);
 				if (++chars_in_line == 70) {
 					if (j != bv.size() - 1) {
-						out << '\n';
+						_out << '\n';
 					}
 					chars_in_line = 0;
 				}
 			}
-			out << '\n';
+			_out << '\n';
 		}
 		break;
-	case FASTQ:
-		for (size_t i = 0; i < this->size(); i++) {
-			const BaseVec &bv = (*this)[i];
-			out << "@read_" << i + 1 << '\n';
-			for (size_t j = 0; j < bv.size(); j++)
-				out << BaseUtils::bin_to_ascii(bv[j]);
-			out << '\n';
-			out << '+';
-			out << '\n';
-			for (size_t j = 0; j < bv.size(); j++)
-				out << '@';
-			out << '\n';
-		}
+	case BaseVecVec::FASTQ:
+		_out << "@read_" << _num_written + 1 << '\n';
+		for (size_t j = 0; j < bv.size(); j++)
+			_out << BaseUtils::bin_to_ascii(bv[j]);
+		_out << '\n';
+		_out << '+';
+		_out << '\n';
+		for (size_t j = 0; j < bv.size(); j++)
+			_out << '@';
+		_out << '\n';
 		break;
 	default:
 		assert(0);
 	}
-	out.close();
-	if (!out)
-		fatal_error_with_errno("Error writing to \"%s\"", filename);
-	//info("Wrote %zu reads to \"%s\"", this->size(), filename);
+	_num_written++;
+}
+
+void BaseVecVecWriter::close()
+{
+	if (_ft == BaseVecVec::NATIVE) {
+		// Fill in the number of reads.
+		_out.seekp(_count_pos);
+		*_ar << boost::serialization::collection_size_type(_num_written);
+		delete _ar;
+		_ar = NULL;
+	}
+	_out.close();
+	if (!_out)
+		fatal_error_with_errno("Error writing to \"%s\"", _filename);
+	if (_ft == BaseVecVec::NATIVE) {
+		size_t max_len = 0;
+		foreach (const BaseVec::size_type len, _lens)
+			max_len = std::max<size_t>(max_len, len);
+		PackedIntVec lens(_lens.size(), PackedIntVec::bytes_needed(max_len));
+		for (size_t i = 0; i < _lens.size(); i++)
+			lens.set(i, _lens[i]);
+		BaseVecVec::write_lengths(_filename, lens);
+	}
 }
@@ -1,9 +1,20 @@
 #pragma once
 
 #include "BaseVec.h"
+#include <fstream>
+#include <string>
 #include <vector>
 #include <boost/serialization/base_object.hpp>
 
+class PackedIntVec;
+
+namespace boost {
+	namespace archive {
+		class binary_iarchive;
+		class binary_oarchive;
+	}
+}
+
 //
 // A vector of BaseVecs; in other words, a vector of DNA sequences (reads).
 //
@@ -20,6 +31,8 @@ private:
 	static const size_t MAGIC_LEN;
 
 	friend class boost::serialization::access;
+	friend class BaseVecVecReader;
+	friend class BaseVecVecWriter;
 
 	template <class Archive>
 	void serialize(Archive & ar, unsigned version)
@@ -29,9 +42,6 @@ private:
 
 	static const char *file_type_string(file_type ft);
 	static file_type detect_file_type(const char *filename);
-	void push_ascii_seq(const std::string &seq);
-	void load_fasta(std::istream &in);
-	void load_fastq(std::istream &in);
 
 public:
 	BaseVecVec() { }
@@ -48,4 +58,89 @@ public:
 	}
 	void read(const char *filename, file_type ft = AUTODETECT);
 	void write(const char *filename, file_type ft = AUTODETECT) const;
+
+	void get_lengths(PackedIntVec & lens) const;
+
+	uint64_t checksum(size_t num_reads) const;
+
+	static file_type file_type_from_extension(const char *filename);
+
+	static std::string lengths_filename(const char *filename);
+	static void write_lengths(const char *filename, const PackedIntVec & lens);
+	static void read_lengths(const char *filename, PackedIntVec & lens);
+};
+
+//
+// Reads the reads from a FASTA, FASTQ, or native BaseVecVec file one at a time
+// or a batch at a time, so that a read set does not have to be held in memory
+// in full to be processed in one pass.
+//
+class BaseVecVecReader {
+private:
+	std::ifstream _in;
+	const char *_filename;
+	BaseVecVec::file_type _ft;
+
+	// For the native format: the archive the reads are read from, and the
+	// number of reads not yet read.
+	boost::archive::binary_iarchive *_ar;
+	size_t _num_left;
+
+	BaseVecVecReader(const BaseVecVecReader &) = delete;
+	BaseVecVecReader & operator=(const BaseVecVecReader &) = delete;
+public:
+	BaseVecVecReader(const char *filename,
+			 BaseVecVec::file_type ft = BaseVecVec::AUTODETECT);
+	~BaseVecVecReader();
+
+	// Set @bv to a new BaseVec holding the next read, which the caller
+	// then owns, and return %true; or return %false if there are no more
+	// reads.
+	bool next(BaseVec & bv);
+
+	// Replace the reads in @batch, which are destroyed, with up to
+	// @max_reads of the next reads.  Returns the number of reads read,
+	// which is 0 only if there are no more reads.
+	size_t read_batch(BaseVecVec & batch, size_t max_reads);
+
+	BaseVecVec::file_type type() const { return _ft; }
+
+	// In the native format, return the number of reads not yet read.
+	size_t num_left() const { return _num_left; }
+};
+
+//
+// Writes reads to a FASTA, FASTQ, or native BaseVecVec file one at a time, in
+// the same format as BaseVecVec::write(), so that the reads do not have to be
+// held in memory in full to be written.
+//
+class BaseVecVecWriter {
+private:
+	std::ofstream _out;
+	const char *_filename;
+	BaseVecVec::file_type _ft;
+	size_t _num_written;
+
+	// For the native format: the archive the reads are written to, where
+	// the number of reads is in it, and the length of each read, for the
+	// read length table.
+	boost::archive::binary_oarchive *_ar;
+	std::streampos _count_pos;
+	std::vector<BaseVec::size_type> _lens;
+
+	BaseVecVecWriter(const BaseVecVecWriter &) = delete;
+	BaseVecVecWriter & operator=(const BaseVecVecWriter &) = delete;
+public:
+	BaseVecVecWriter(const char *filename,
+			 BaseVecVec::file_type ft = BaseVecVec::AUTODETECT);
+	~BaseVecVecWriter();
+
+	// Append the read @bv to the file.
+	void push_back(const BaseVec & bv);
+
+	size_t num_written() const { return _num_written; }
+
+	// Finish writing the file, and, in the native format, write the read
+	// length table alongside it.
+	void close();
 };
@@ -1,5 +1,9 @@
 #include "BidirectedStringGraph.h"
 #include "DirectedStringGraph.h"
+#include "GraphStats.h"
+#include "parallel.h"
+#include <algorithm>
+#include <math.h>
 
 const char BidirectedStringGraph::magic[]
 		= {'B', 'i', 'd', 'i', 'g', 'r', 'a', 'p', 'h', '\0'};
@@ -19,152 +23,462 @@ const char BidirectedStringGraph::magic[]
 // 	(3) The heads adjacent to x in v ?-? x and w ?-? x have the same
 // 	orientation.
 // 	(4) And as in the directed case, the sequence v ?-? x must be equal to
-// 	the sequence v ?-? w + v ?-? x.
+// 	the sequence v ?-? w + w ?-? x.
 //
 // In addition, in the directed case, there can be at most one edge v -> w
 // (although there may be an edge w -> v as well).  But in the bidirected case,
 // there can be up to 4 edges between v and w:
-// 	v >--> w  (v.E -> w.E, w.B -> v.E)
+// 	v >--> w  (v.E -> w.E, w.B -> v.B)
 // 	v >--< w  (v.E -> w.B, w.E -> v.B)
 // 	v <--< w  (v.B -> w.B, w.E -> v.E)
 // 	v <--> w  (v.B -> w.E, w.B -> v.E)
+//
+// All of this is handled by running the directed algorithm on the directed
+// graph that the bidirected graph represents, without building it: each end
+// v.B or v.E of a vertex plays the part of a directed vertex, and each way of
+// traversing a bidirected edge (each "half-edge") plays the part of a directed
+// edge.  Each half-edge is reduced exactly when the corresponding directed edge
+// would be, and an edge is removed when both of its half-edges are reduced, so
+// the result is the same as reducing the directed graph and converting it back.
+//
+// As in the directed case, the vertices are processed in parallel.
+//
 void BidirectedStringGraph::transitive_reduction()
 {
-	unimplemented();
-
 	info("Performing transitive reduction on bidirected string graph with "
 	     "%zu vertices and %zu edges", this->num_vertices(), this->num_edges());
 
-	std::vector<BidirectedStringGraphVertex> & vertices = this->vertices();
-	std::vector<BidirectedStringGraphEdge> & edges = this->edges();
+	const std::vector<BidirectedStringGraphEdge> & edges = this->edges();
+	const size_t n_verts = this->num_vertices();
 
 	info("Sorting adjacency lists of vertices by edge length");
 	this->sort_adjlists_by_edge_len();
 
-	static const unsigned char VACANT         = 0x0;
-	static const unsigned char INPLAY_INWARD  = 0x1;
-	static const unsigned char INPLAY_OUTWARD = 0x2;
-	static const unsigned char ELIMINATED     = 0x4;
-	static const unsigned char INPLAY         = INPLAY_INWARD | INPLAY_OUTWARD;
-
-	// Per-vertex mark.  Initially set to VACANT.
-	std::vector<unsigned char> vertex_marks(this->num_vertices(), VACANT);
-
-	// Per-edge boolean indicating whether each edge is to be deleted as
-	// part of the transitive reduction or not.
-	std::vector<bool> reduce_edge(this->num_edges(), false);
+	static const unsigned char VACANT = 0;
+	static const unsigned char INPLAY = 1;
+	static const unsigned char ELIMINATED = 2;
+
+	static const edge_idx_t NONE = std::numeric_limits<edge_idx_t>::max();
+
+	// Per-half-edge flag indicating whether each half-edge is to be reduced.
+	// Half-edge @h is the edge with index @h / 2 traversed from side @h & 1.
+	// There are at most half as many edges as an edge_idx_t can hold (see
+	// push_back_edge()), so a half-edge index always fits.
+	std::vector<unsigned char> reduce_half_edge(this->num_edges() * 2, 0);
+
+	// Hash of the label of each half-edge (see EdgeLabel::hash()), as in
+	// the directed case.
+	info("Hashing edge labels");
+	std::vector<uint64_t> label_hashes(this->num_edges() * 2);
+	BaseVec::size_type max_len = 0;
+	#pragma omp parallel for schedule(static, 4096) reduction(max:max_len)
+	for (size_t h = 0; h < label_hashes.size(); h++) {
+		const EdgeLabel & label = edges[h / 2].get_label(h & 1);
+		label_hashes[h] = label.hash(_reads);
+		max_len = std::max(max_len, label.length());
+	}
+	std::vector<uint64_t> hash_powers;
+	EdgeLabel::hash_powers(max_len, hash_powers);
 
-	for (size_t v_idx = 0; v_idx < vertices.size(); v_idx++) {
-		bool v_head_outward = true;
-		// First, only consider edges leaving v with an out head.  Then,
-		// on the second iteration, only consider edges leaving v with
-		// an in head.
-		do {
-			const BidirectedStringGraphVertex & v = vertices[v_idx];
+	info("Looking for transitive edges based at each of %zu vertices "
+	     "(%d threads)", n_verts, omp_get_max_threads());
 
+	#pragma omp parallel
+	{
+		// Per-vertex-end mark.  Initially set to VACANT.
+		std::vector<unsigned char> marks(n_verts * 2, VACANT);
+
+		// Map from vertex end to the half-edge to it from the vertex end
+		// currently under consideration
+		std::vector<edge_idx_t> dv_idx_to_back_half_edge(n_verts * 2, NONE);
+
+		// The half-edges leaving the vertex end under consideration, and
+		// the half-edges leaving one of its neighbors.
+		std::vector<edge_idx_t> u_half_edges;
+		std::vector<edge_idx_t> w_half_edges;
+
+		#pragma omp for schedule(dynamic, 1024)
+		for (size_t dv_idx = 0; dv_idx < n_verts * 2; dv_idx++) {
+			get_out_half_edges(dv_idx, u_half_edges);
+			if (u_half_edges.empty())
+				continue;
+
+			// Mark each vertex end adjacent to this one as INPLAY,
+			// and initialize the map from the adjacent vertex ends
+			// to the back half-edges.
 			BaseVec::size_type longest = 0;
-
-			foreach(const edge_idx_t edge_idx, v.edge_indices()) {
-				const BidirectedStringGraphEdge & e = edges[edge_idx];
-				if (e.this_v_outward(v_idx) == v_head_outward) {
-					if (e.other_v_outward(v_idx))
-						vertex_marks[e.get_other_v_idx(v_idx)] = INPLAY_OUTWARD;
-					else
-						vertex_marks[e.get_other_v_idx(v_idx)] = INPLAY_INWARD;
-					longest = std::max(longest, e.length());
-				}
+			foreach (const edge_idx_t h, u_half_edges) {
+				const BidirectedStringGraphEdge & e = edges[h / 2];
+				const v_idx_t w_dv_idx = e.get_directed_head_idx(h & 1);
+				assert(dv_idx_to_back_half_edge[w_dv_idx] == NONE);
+				dv_idx_to_back_half_edge[w_dv_idx] = h;
+				marks[w_dv_idx] = INPLAY;
+				longest = std::max(longest, e.get_label(h & 1).length());
 			}
 
-			if (longest == 0)
-				goto cont;
-
-			foreach(const edge_idx_t edge_idx, v.edge_indices()) {
-				const v_idx_t w_idx = edges[edge_idx].get_other_v_idx(v_idx);
-				if (vertex_marks[w_idx] & INPLAY) {
-					const bool w_tail_outward =
-							edges[edge_idx].other_v_outward(v_idx);
-					const BidirectedStringGraphVertex & w = vertices[w_idx];
-					foreach(const edge_idx_t w_edge_idx, w.edge_indices()) {
-						const BidirectedStringGraphEdge & e2 = edges[w_edge_idx];
-						if (e2.length() > longest)
-							break;
-						if (e2.this_v_outward(w_idx) == w_tail_outward)
-							continue;
-						const unsigned char mark =
-							vertex_marks[e2.get_other_v_idx(w_idx)];
-						if ((mark & INPLAY)
-						    && ((mark & INPLAY_OUTWARD)
-							    ? e2.other_v_outward(w_idx) :
-							      !e2.other_v_outward(w_idx)))
-						{
-							vertex_marks[e2.get_other_v_idx(w_idx)] =
-									ELIMINATED;
-						}
-					}
+			// For each half-edge to a vertex end w that is still
+			// INPLAY, in order of length, eliminate the vertex ends
+			// that are reachable through w with the same sequence.
+			foreach (const edge_idx_t h, u_half_edges) {
+				const BidirectedStringGraphEdge & e = edges[h / 2];
+				const EdgeLabel & e_label = e.get_label(h & 1);
+				const v_idx_t w_dv_idx = e.get_directed_head_idx(h & 1);
+
+				if (marks[w_dv_idx] != INPLAY)
+					continue;
+
+				get_out_half_edges(w_dv_idx, w_half_edges);
+				foreach (const edge_idx_t h2, w_half_edges) {
+					const BidirectedStringGraphEdge & e2 = edges[h2 / 2];
+					if (e_label.length() + e2.length_from(w_dv_idx / 2) > longest)
+						break;
+
+					const EdgeLabel & e2_label = e2.get_label(h2 & 1);
+					const v_idx_t x_dv_idx = e2.get_directed_head_idx(h2 & 1);
+					if (marks[x_dv_idx] != INPLAY)
+						continue;
+
+					const edge_idx_t back_h = dv_idx_to_back_half_edge[x_dv_idx];
+					assert(back_h != NONE);
+					const EdgeLabel & back_label =
+						edges[back_h / 2].get_label(back_h & 1);
+
+					if (e_label.length() + e2_label.length() !=
+					    back_label.length())
+						continue;
+
+					if (EdgeLabel::hash_concat(label_hashes[h],
+								   label_hashes[h2],
+								   hash_powers[e2_label.length()])
+					    != label_hashes[back_h])
+						continue;
+
+					if (back_label.equals_concatenation(e_label, e2_label,
+									    _reads))
+						marks[x_dv_idx] = ELIMINATED;
 				}
 			}
 
-			foreach(const edge_idx_t edge_idx, v.edge_indices()) {
-				const BidirectedStringGraphEdge & e = edges[edge_idx];
-				if (e.this_v_outward(v_idx) == v_head_outward
-				    && vertex_marks[e.get_other_v_idx(v_idx)] == ELIMINATED)
-				{
-						reduce_edge[edge_idx] = true;
-				}
+			// Mark the half-edges to the vertex ends marked
+			// ELIMINATED for reduction, and return all the marks to
+			// VACANT.
+			foreach (const edge_idx_t h, u_half_edges) {
+				const v_idx_t w_dv_idx =
+					edges[h / 2].get_directed_head_idx(h & 1);
+				if (marks[w_dv_idx] == ELIMINATED)
+					reduce_half_edge[h] = 1;
+				dv_idx_to_back_half_edge[w_dv_idx] = NONE;
+				marks[w_dv_idx] = VACANT;
 			}
-
-			foreach(const edge_idx_t edge_idx, v.edge_indices())
-				vertex_marks[edges[edge_idx].get_other_v_idx(v_idx)] = VACANT;
-		cont:
-			v_head_outward = !v_head_outward;
-		} while (!v_head_outward);
+		}
 	}
 
 	info("Transitive reduction algorithm complete.  Now updating the string graph");
 
-	// Update the directed string graph to remove the edges marked %true in
-	// the @reduce_edge array.
+	// Both half-edges of an edge should always be reduced together.  If only
+	// one of them was, keep the edge.
+	std::vector<unsigned char> reduce_edge(this->num_edges(), 0);
+	size_t num_one_sided_edges = 0;
+	for (size_t i = 0; i < this->num_edges(); i++) {
+		if (reduce_half_edge[i * 2] && reduce_half_edge[i * 2 + 1])
+			reduce_edge[i] = 1;
+		else if (reduce_half_edge[i * 2] || reduce_half_edge[i * 2 + 1])
+			num_one_sided_edges++;
+	}
+	if (num_one_sided_edges != 0)
+		info("Kept %zu edges that were reduced in only one direction",
+		     num_one_sided_edges);
+
+	// Update the bidirected string graph to remove the edges marked in the
+	// @reduce_edge array.
+	const size_t num_original_edges = this->num_edges();
+	std::vector<edge_idx_t> new_edge_indices;
+	const size_t num_removed_edges = remove_edges(reduce_edge, new_edge_indices);
+
+	info("Removing %zu of %zu edges (%.2f%%)",
+	     num_removed_edges, num_original_edges,
+	     TO_PERCENT(num_removed_edges, num_original_edges));
 
-	// Map from the old edge indices to the new edge indices.
-	std::vector<edge_idx_t> new_edge_indices(edges.size());
-	size_t i, j;
-	for (i = 0, j = 0; i < edges.size(); i++) {
-		if (reduce_edge[i]) {
-			new_edge_indices[i] = std::numeric_limits<edge_idx_t>::max();
+	info("Done removing transitive edges");
+}
+
+//
+// Get the half-edges leaving the vertex end with index @dv_idx--- that is, the
+// half-edges whose tails are @dv_idx in the corresponding directed string
+// graph--- in the order of the adjacency list of the vertex.  Each half-edge is
+// numbered as the edge index times 2 plus the side from which it is traversed.
+//
+// A loop appears twice in the adjacency list of its vertex, so both of its
+// half-edges are considered at its first appearance and none at its second.
+//
+void BidirectedStringGraph::get_out_half_edges(const v_idx_t dv_idx,
+					       std::vector<edge_idx_t> & half_edges) const
+{
+	const v_idx_t v_idx = dv_idx / 2;
+	const EdgeIdxRange<const edge_idx_t> v_edge_indices = edge_indices(v_idx);
+
+	half_edges.clear();
+	for (size_t i = 0; i < v_edge_indices.size(); i++) {
+		const edge_idx_t edge_idx = v_edge_indices[i];
+		const BidirectedStringGraphEdge & e = _edges[edge_idx];
+		if (e.is_loop()) {
+			if (std::find(v_edge_indices.begin(),
+				      v_edge_indices.begin() + i,
+				      edge_idx) != v_edge_indices.begin() + i)
+				continue;
+			for (unsigned side = 0; side < 2; side++)
+				if (e.get_directed_tail_idx(side) == dv_idx)
+					half_edges.push_back(edge_idx * 2 + side);
 		} else {
-			new_edge_indices[i] = j;
-			edges[j++] = edges[i];
+			const unsigned side = (v_idx == e.get_v1_idx()) ? 0 : 1;
+			if (e.get_directed_tail_idx(side) == dv_idx)
+				half_edges.push_back(edge_idx * 2 + side);
 		}
 	}
-	const size_t num_original_edges = edges.size();
-	const size_t num_removed_edges = num_original_edges - j;
-	edges.resize(j);
+}
 
-	info("Removing %zu of %zu edges (%.2f%%)",
-	     num_removed_edges, num_original_edges,
-	     (num_original_edges ?
-		100 * double(num_removed_edges) / num_original_edges : 0.0));
-
-	// Re-number the edge indices list of each vertex, and remove any
-	// indices that correspond to edges that were removed.
-	foreach(BidirectedStringGraphVertex & v, vertices) {
-		std::vector<edge_idx_t> & edge_indices = v.edge_indices();
-		size_t j = 0;
-		foreach(const edge_idx_t edge_idx, edge_indices) {
-			const edge_idx_t new_edge_idx = new_edge_indices[edge_idx];
-			if (new_edge_idx != std::numeric_limits<edge_idx_t>::max()) {
-				edge_indices[j++] = new_edge_idx;
+//
+// Collapse the unbranched path that begins by traversing the edge with index
+// @edge_idx away from the vertex @v_idx into that edge.  Either @v_idx is not
+// inner, or it is on a smooth ring, which is collapsed into a loop on @v_idx.
+//
+// The path is followed as a walk in the bidirected graph: each inner vertex has
+// one inward head and one outward head, so the walk leaves it through the head
+// other than the one it entered by.  Both labels of the collapsed edge are the
+// concatenations of the labels of the edges of the path, taken in the direction
+// of the path for the first label and in the opposite direction for the second.
+//
+void BidirectedStringGraph::follow_unbranched_path(const edge_idx_t edge_idx,
+						   const v_idx_t v_idx,
+						   std::vector<bool> & remove_edge,
+						   std::vector<bool> & remove_vertex,
+						   const std::vector<bool> & v_inner)
+{
+	// The edges of the path, as half-edges traversed in the direction of
+	// the path.
+	std::vector<edge_idx_t> path;
+	BaseVec::size_type fwd_len = 0;
+	BaseVec::size_type rev_len = 0;
+
+	edge_idx_t cur_edge_idx = edge_idx;
+	v_idx_t vi_idx = v_idx;
+	do {
+		const BidirectedStringGraphEdge & ei = _edges[cur_edge_idx];
+		const unsigned side = (vi_idx == ei.get_v1_idx()) ? 0 : 1;
+		if (fwd_len + ei.get_label(side).length() < fwd_len ||
+		    rev_len + ei.get_label(side ^ 1).length() < rev_len)
+			fatal_error("Edge too long");
+		fwd_len += ei.get_label(side).length();
+		rev_len += ei.get_label(side ^ 1).length();
+		path.push_back(cur_edge_idx * 2 + side);
+		vi_idx = ei.get_other_v_idx(vi_idx);
+		if (!v_inner[vi_idx] || vi_idx == v_idx)
+			break;
+
+		// Leave the inner vertex by its other edge.
+		const EdgeIdxRange<edge_idx_t> vi_edge_indices =
+				edge_indices(vi_idx);
+		assert(vi_edge_indices.size() == 2);
+		cur_edge_idx = vi_edge_indices[vi_edge_indices[0] == cur_edge_idx];
+		remove_vertex[vi_idx] = true;
+	} while (1);
+
+	const edge_idx_t first = path.front();
+	const edge_idx_t last = path.back();
+	BaseVec fwd_seq, rev_seq;
+
+	fwd_seq.reserve(fwd_len);
+	foreach (const edge_idx_t h, path)
+		_edges[h / 2].get_label(h & 1).append_to(_reads, fwd_seq);
+	assert(fwd_seq.size() == fwd_len);
+
+	rev_seq.reserve(rev_len);
+	for (size_t j = path.size(); j-- > 0; ) {
+		const edge_idx_t h = path[j];
+		_edges[h / 2].get_label((h & 1) ^ 1).append_to(_reads, rev_seq);
+	}
+	assert(rev_seq.size() == rev_len);
+
+	// The collapsed edge goes from the tail of the first half-edge to the
+	// head of the last one.
+	const v_idx_t tail_idx = _edges[first / 2].get_directed_tail_idx(first & 1);
+	const v_idx_t head_idx = _edges[last / 2].get_directed_head_idx(last & 1);
+
+	BidirectedStringGraphEdge & e = _edges[edge_idx];
+	for (size_t j = 1; j < path.size(); j++) {
+		const edge_idx_t ei_idx = path[j] / 2;
+		e.increment_mapped_read_count(_edges[ei_idx].get_mapped_read_count());
+		remove_edge[ei_idx] = true;
+	}
+	e.set_num_inner_vertices(path.size() - 1);
+	e.set_v_indices(tail_idx / 2, head_idx / 2);
+	e.set_dirs(((tail_idx & 1) << 1) | (head_idx & 1));
+	e.get_label_1_to_2().set_seq(fwd_seq);
+	e.get_label_2_to_1().set_seq(rev_seq);
+}
+
+//
+// Collapse the unbranched paths of a bidirected string graph.
+//
+// A vertex is inner iff it has exactly one inward head and one outward head
+// adjacent to it; this is the same as both of its ends being inner vertices in
+// the directed string graph.  Each unbranched path is collapsed once, from
+// whichever of its end vertices is reached first, where the directed string
+// graph collapses it and its twin separately.
+//
+void BidirectedStringGraph::collapse_unbranched_paths()
+{
+	const v_idx_t n_verts = num_vertices();
+	const size_t n_edges = num_edges();
+
+	info("Collapsing unbranched paths in bidirected string graph");
+	info("Original graph has %zu vertices and %zu edges", n_verts, n_edges);
+
+	size_t num_inner_vertices = 0;
+	std::vector<bool> v_inner(n_verts, false);
+	{
+		std::vector<unsigned char> v_in_heads(n_verts, 0);
+		std::vector<unsigned char> v_out_heads(n_verts, 0);
+
+		foreach (const BidirectedStringGraphEdge & e, _edges) {
+			v_idx_t v1_idx, v2_idx;
+			e.get_v_indices(v1_idx, v2_idx);
+			std::vector<unsigned char> & v1_heads =
+				e.v1_inward() ? v_in_heads : v_out_heads;
+			std::vector<unsigned char> & v2_heads =
+				e.v2_inward() ? v_in_heads : v_out_heads;
+			if (v1_heads[v1_idx] < 2)
+				v1_heads[v1_idx]++;
+			if (v2_heads[v2_idx] < 2)
+				v2_heads[v2_idx]++;
+		}
+		for (v_idx_t v_idx = 0; v_idx < n_verts; v_idx++) {
+			if (v_in_heads[v_idx] == 1 && v_out_heads[v_idx] == 1) {
+				v_inner[v_idx] = true;
+				num_inner_vertices++;
 			}
 		}
-		edge_indices.resize(j);
 	}
 
-	info("Done removing transitive edges");
+	info("Found %zu inner vertices (%.2f%% of all vertices)",
+	     num_inner_vertices, TO_PERCENT(num_inner_vertices, n_verts));
+
+	// Go through each non-inner vertex and look for any neighboring inner
+	// vertices.  These are the starts of unbranched paths that will be
+	// collapsed.  The far end of a path that was already collapsed is
+	// recognized by its inner vertices having been marked for removal.
+	//
+	size_t num_unbranched_paths = 0;
+	std::vector<bool> remove_edge(n_edges, false);
+	std::vector<bool> remove_vertex(n_verts, false);
+	for (v_idx_t v_idx = 0; v_idx < n_verts; v_idx++) {
+		if (!v_inner[v_idx]) {
+			foreach(edge_idx_t edge_idx, edge_indices(v_idx)) {
+				const BidirectedStringGraphEdge & e = _edges[edge_idx];
+				const v_idx_t w_idx = e.get_other_v_idx(v_idx);
+				if (v_inner[w_idx] && !remove_vertex[w_idx]) {
+					num_unbranched_paths++;
+					follow_unbranched_path(edge_idx, v_idx,
+							       remove_edge,
+							       remove_vertex,
+							       v_inner);
+				}
+			}
+		}
+	}
+
+	info("Found %zu unbranched paths", num_unbranched_paths);
+
+	// The inner vertices that remain are on smooth rings.  Collapse each
+	// ring into a loop on its first vertex.
+	size_t num_smooth_rings = 0;
+	for (v_idx_t v_idx = 0; v_idx < n_verts; v_idx++) {
+		if (v_inner[v_idx] && !remove_vertex[v_idx]) {
+			num_smooth_rings++;
+			follow_unbranched_path(first_edge_idx(v_idx), v_idx,
+					       remove_edge, remove_vertex,
+					       v_inner);
+		}
+	}
+	info("Found %zu smooth rings", num_smooth_rings);
+
+	// Materialize the labels that were not concatenated, so that they no
+	// longer refer to the reads.
+	for (edge_idx_t edge_idx = 0; edge_idx < n_edges; edge_idx++) {
+		if (!remove_edge[edge_idx]) {
+			_edges[edge_idx].get_label_1_to_2().materialize(_reads);
+			_edges[edge_idx].get_label_2_to_1().materialize(_reads);
+		}
+	}
+
+	// Compute the new vertex indices and move the vertices.  Only the
+	// reads of the remaining vertices are kept, in the same order, as the
+	// first bases of the paths that start at them.
+	assert(_reads.size() <= n_verts);
+	compact_reads([&](size_t i) { return !remove_vertex[i]; });
+	std::vector<v_idx_t> old_to_new_v_indices(n_verts,
+						  std::numeric_limits<v_idx_t>::max());
+	v_idx_t new_v_idx = 0;
+	for (v_idx_t old_v_idx = 0; old_v_idx < n_verts; old_v_idx++) {
+		if (!remove_vertex[old_v_idx]) {
+			old_to_new_v_indices[old_v_idx] = new_v_idx;
+			_vertices[new_v_idx++] = _vertices[old_v_idx];
+		}
+	}
+	_vertices.resize(new_v_idx);
+	assert(num_vertices() == n_verts - num_inner_vertices + num_smooth_rings);
+
+	info("Updated vertices are indexed [0, %lu)", new_v_idx);
+
+	info("Updating edges");
+	// Set the new vertex indices in each edge and move the edges.
+	edge_idx_t new_edge_idx = 0;
+	for (edge_idx_t old_edge_idx = 0; old_edge_idx < n_edges; old_edge_idx++) {
+		if (!remove_edge[old_edge_idx]) {
+			BidirectedStringGraphEdge & e = _edges[old_edge_idx];
+			v_idx_t v1_idx, v2_idx;
+			e.get_v_indices(v1_idx, v2_idx);
+			e.set_v_indices(old_to_new_v_indices[v1_idx],
+					old_to_new_v_indices[v2_idx]);
+			assert2(e.get_v1_idx() < new_v_idx &&
+				e.get_v2_idx() < new_v_idx);
+			_edges[new_edge_idx++] = _edges[old_edge_idx];
+		}
+	}
+	info("Updated edges are indexed [0, %u)", new_edge_idx);
+	info("%zu edges were removed (%f%% of total)",
+	     _edges.size() - new_edge_idx,
+	     TO_PERCENT(_edges.size() - new_edge_idx, _edges.size()));
+
+	_edges.resize(new_edge_idx);
+
+	// A collapsed edge now appears in the adjacency list of the vertex at
+	// the far end of its path, so the adjacency lists are rebuilt rather
+	// than renumbered.
+	rebuild_adjacency();
+	info("Done collapsing unbranched paths in bidirected string graph");
 }
 
-void BidirectedStringGraph::collapse_unbranched_paths()
+//
+// Weight the reads of a bidirected string graph whose reads have not been
+// collapsed, where @read_weights[i] is the number of original reads that read i
+// stands for.  An edge stands for the overlap of its two reads, so its mapped
+// read count becomes the mean of their weights.  See
+// DirectedStringGraph::set_read_weights().
+//
+void BidirectedStringGraph::set_read_weights(const std::vector<float> & read_weights)
 {
-	unimplemented();
+	assert(read_weights.size() == num_vertices());
+	#pragma omp parallel for schedule(static, 65536)
+	for (size_t i = 0; i < num_edges(); i++) {
+		BidirectedStringGraphEdge & e = _edges[i];
+		e.set_mapped_read_count((read_weights[e.get_v1_idx()] +
+					 read_weights[e.get_v2_idx()]) / 2);
+	}
+	double total_weight = 0;
+	foreach (const float w, read_weights)
+		total_weight += w;
+	_orig_num_reads = llround(total_weight);
 }
 
 void BidirectedStringGraph::build_from_digraph(const DirectedStringGraph & digraph)
@@ -190,8 +504,7 @@ void BidirectedStringGraph::build_from_digraph(const DirectedStringGraph & digra
 		//
 		//   seq
 		//
-		const DirectedStringGraphVertex & v = digraph.vertices()[v_idx];
-		foreach(const edge_idx_t v_w_edge_idx, v.edge_indices()) {
+		foreach(const edge_idx_t v_w_edge_idx, digraph.edge_indices(v_idx)) {
 			const DirectedStringGraphEdge & v_w = digraph.edges()[v_w_edge_idx];
 			const v_idx_t w_idx = v_w.get_v2_idx();
 
@@ -204,8 +517,7 @@ void BidirectedStringGraph::build_from_digraph(const DirectedStringGraph & digra
 			 * - If an edge is a loop, then the edge pair is v.B ->
 			 *   v.B and v.E -> v.E, so skip the v.B -> v.B edge. */
 			if (v_idx < w_idx || (v_idx == w_idx && (v_idx & 1))) {
-				const edge_idx_t w_v_edge_idx =
-						digraph.locate_edge(w_idx ^ 1, v_idx ^ 1);
+				const edge_idx_t w_v_edge_idx = v_w.get_twin_idx();
 
 				const DirectedStringGraphEdge & w_v =
 						digraph.edges()[w_v_edge_idx];
@@ -216,10 +528,8 @@ void BidirectedStringGraph::build_from_digraph(const DirectedStringGraph & digra
 				const v_idx_t v1_idx = v_idx / 2;
 				const v_idx_t v2_idx = w_idx / 2;
 
-				//e.get_seq_1_to_2().set_from_bv(v_g.get_seq());
-				//e.get_seq_2_to_1().set_from_bv(w_f.get_seq());
-				e.get_seq_1_to_2() = v_w.get_seq();
-				e.get_seq_2_to_1() = w_v.get_seq();
+				e.get_label_1_to_2() = v_w.get_label();
+				e.get_label_2_to_1() = w_v.get_label();
 				e.set_v_indices(v1_idx, v2_idx);
 				e.set_dirs(dirs);
 				e.set_mapped_read_count((w_v.get_mapped_read_count() +
@@ -242,12 +552,12 @@ void BidirectedStringGraph::build_from_digraph(const DirectedStringGraph & digra
 					e.set_special();
 				}
 
-				edge_idx_t edge_idx = this->push_back_edge(e);
-				_vertices[v1_idx].add_edge_idx(edge_idx);
-				_vertices[v2_idx].add_edge_idx(edge_idx);
+				this->push_back_edge(e);
 			}
 		}
 	}
+	rebuild_adjacency();
+	copy_reads(digraph);
 	_orig_num_reads = digraph._orig_num_reads;
 	info("Done building bidirected string graph from directed string graph");
 }
@@ -258,60 +568,26 @@ void BidirectedStringGraph::print_stats(std::ostream & os) const
 	os << "    Number of vertices: " << num_vertices() << std::endl;
 	os << "    Number of edges: " << num_edges() << std::endl;
 
-	std::vector<unsigned char> out_degrees(num_vertices(), 0);
-	std::vector<unsigned char> in_degrees(num_vertices(), 0);
-	std::vector<v_idx_t> dir_histo(4, 0);
-	foreach(const BidirectedStringGraphEdge & e, _edges) {
+	GraphStats stats(num_vertices());
+	edge_idx_t dir_histo[4] = {0, 0, 0, 0};
+	#pragma omp parallel for reduction(+: dir_histo[:4])
+	for (edge_idx_t edge_idx = 0; edge_idx < num_edges(); edge_idx++) {
+		const BidirectedStringGraphEdge & e = _edges[edge_idx];
 		v_idx_t v1_idx, v2_idx;
 		e.get_v_indices(v1_idx, v2_idx);
 		dir_histo[e.get_dirs()]++;
-		if (e.v1_inward()) {
-			if (in_degrees[v1_idx] + 1 != 0)
-				in_degrees[v1_idx]++;
-		} else {
-			if (out_degrees[v1_idx] + 1 != 0)
-				out_degrees[v1_idx]++;
-		}
-		if (e.v2_inward()) {
-			if (in_degrees[v2_idx] + 1 != 0)
-				in_degrees[v2_idx]++;
-		} else {
-			if (out_degrees[v2_idx] + 1 != 0)
-				out_degrees[v2_idx]++;
-		}
+		if (e.v1_inward())
+			stats.count_in(v1_idx);
+		else
+			stats.count_out(v1_idx);
+		if (e.v2_inward())
+			stats.count_in(v2_idx);
+		else
+			stats.count_out(v2_idx);
+		stats.add_edge(v1_idx, v2_idx, e.length());
 	}
-	std::vector<v_idx_t> out_degree_hist(0xff, 0);
-	std::vector<v_idx_t> in_degree_hist(0xff, 0);
-	std::vector<v_idx_t> in_out_degree_hist(0xffff, 0);
-	v_idx_t v_in_neq_out = 0;
-	for (v_idx_t v_idx = 0; v_idx < num_vertices(); v_idx++) {
-		out_degree_hist[out_degrees[v_idx]]++;
-		in_degree_hist[in_degrees[v_idx]]++;
-		if (out_degrees[v_idx] != in_degrees[v_idx])
-			v_in_neq_out++;
-		in_out_degree_hist[(v_idx_t(in_degrees[v_idx]) << 8) + out_degrees[v_idx]]++;
-	}
-	v_idx_t max_out_degree = 0, max_in_degree = 0;
-	for (size_t i = 0; i < out_degree_hist.size(); i++)
-		if (out_degree_hist[i] != 0)
-			max_out_degree = i;
-	for (size_t i = 0; i < in_degree_hist.size(); i++)
-		if (in_degree_hist[i] != 0)
-			max_in_degree = i;
-	os << "    Number of isolated vertices: "
-	   << in_out_degree_hist[0x000] << std::endl;
-	os << "    Number of inner vertices: "
-	   << in_out_degree_hist[0x101] << std::endl;
-	os << "    Number of branch beginning vertices: "
-	   << in_out_degree_hist[0x001] << std::endl;
-	os << "    Number of branch ending vertices: "
-	   << in_out_degree_hist[0x100] << std::endl;
-	os << "    Number of vertices with unequal in degree and out degree: "
-	   << v_in_neq_out << std::endl;
-	os << "    Max in degree: " << max_in_degree
-	   << (max_in_degree == 0xff ? '+' : ' ') << std::endl;
-	os << "    Max out degree: " << max_out_degree
-	   << (max_out_degree == 0xff ? '+' : ' ') << std::endl;
+	stats.finish();
+	stats.print_degrees(os);
 
 	// 11
 	// (v1_outward, v2_inward)
@@ -322,29 +598,379 @@ void BidirectedStringGraph::print_stats(std::ostream & os) const
 	os << "    Number of edges >--->: " << (dir_histo[0x0] + dir_histo[0x3]) << std::endl;
 	os << "    Number of edges <--->: " << (dir_histo[0x1]) << std::endl;
 	os << "    Number of edges >---<: " << (dir_histo[0x2]) << std::endl;
+
+	stats.print_components(os);
 	os << "}" << std::endl;
 }
 
-void BidirectedStringGraph::map_contained_read(const v_idx_t downstream_read_idx,
-					       const v_idx_t downstream_read_dir,
-					       const BaseVec::size_type overhang_len)
+// Index the half-edges entering each end of each vertex--- that is, each vertex
+// of the corresponding directed string graph--- so that it's possible to walk
+// the graph backwards.
+void BidirectedStringGraph::index_back_edges()
 {
-	unimplemented();
+	const size_t n_dverts = num_vertices() * 2;
+
+	info("Indexing back edges (num_vertices = %zu, num_edges = %zu)",
+	     num_vertices(), num_edges());
+	_back_edge_offsets.assign(n_dverts + 1, 0);
+	foreach (const BidirectedStringGraphEdge & e, _edges)
+		for (unsigned side = 0; side < 2; side++)
+			_back_edge_offsets[e.get_directed_head_idx(side) + 1]++;
+	for (size_t dv_idx = 0; dv_idx < n_dverts; dv_idx++)
+		_back_edge_offsets[dv_idx + 1] += _back_edge_offsets[dv_idx];
+
+	std::vector<edge_idx_t> next(_back_edge_offsets.begin(),
+				     _back_edge_offsets.end() - 1);
+	_back_edges.resize(num_edges() * 2);
+	for (edge_idx_t edge_idx = 0; edge_idx < num_edges(); edge_idx++)
+		for (unsigned side = 0; side < 2; side++)
+			_back_edges[next[_edges[edge_idx].get_directed_head_idx(side)]++] =
+				edge_idx * 2 + side;
 }
 
+//
+// Returns the half-edges onto which the end of a contained read maps, walking
+// back from the end @dv_idx of a vertex with @overhang_len bases of the
+// uncontained read still to be threaded back.
+//
+// This is DirectedStringGraph::walk_back_edges() on the directed string graph
+// that this bidirected string graph represents; see there.
+//
+const BidirectedStringGraph::back_walk_result &
+BidirectedStringGraph::walk_back_edges(const v_idx_t dv_idx,
+				       const BaseVec::size_type overhang_len,
+				       back_walk_memo & memo) const
+{
+	const uint64_t key = (uint64_t(dv_idx) << 32) | overhang_len;
+	back_walk_memo::const_iterator it = memo.find(key);
+	if (it != memo.end())
+		return it->second;
+
+	const edge_idx_t begin = _back_edge_offsets[dv_idx];
+	const edge_idx_t end = _back_edge_offsets[dv_idx + 1];
+	back_walk_result res;
+	res.overflowed = false;
+
+	for (edge_idx_t i = begin; i < end && !res.overflowed; i++) {
+		const edge_idx_t h = _back_edges[i];
+		const BidirectedStringGraphEdge & e = _edges[h / 2];
+		assert2(e.get_directed_head_idx(h & 1) == dv_idx);
+		if (overhang_len < e.get_label(h & 1).length()) {
+			res.edges.push_back(h);
+			if (res.edges.size() == MAX_MAPPED_EDGES)
+				res.overflowed = true;
+		}
+	}
+
+	for (edge_idx_t i = begin; i < end && !res.overflowed; i++) {
+		const edge_idx_t h = _back_edges[i];
+		const BidirectedStringGraphEdge & e = _edges[h / 2];
+		const BaseVec::size_type len = e.get_label(h & 1).length();
+		if (overhang_len >= len) {
+			const back_walk_result & sub =
+				walk_back_edges(e.get_directed_tail_idx(h & 1),
+						overhang_len - len, memo);
+			if (sub.overflowed ||
+			    res.edges.size() + sub.edges.size() >= MAX_MAPPED_EDGES)
+				res.overflowed = true;
+			else
+				res.edges.insert(res.edges.end(),
+						 sub.edges.begin(), sub.edges.end());
+		}
+	}
+	if (res.overflowed)
+		std::vector<edge_idx_t>().swap(res.edges);
+	return memo.emplace(key, std::move(res)).first->second;
+}
+
+//
+// Map the ends of contained reads, @ends, into the graph.
+//
+// The ends are mapped onto half-edges exactly as DirectedStringGraph maps them
+// onto directed edges.  The mapped read count of a bidirected edge is the mean
+// of the counts of its two half-edges, as when it is built from a directed
+// string graph, so each half-edge contributes half of its count to the edge.
+//
+void BidirectedStringGraph::map_contained_reads(const std::vector<ContainedReadEnd> & ends)
+{
+	// The key of each end, with its weight.
+	std::vector<std::pair<uint64_t, float> > keys(ends.size());
+	for (size_t i = 0; i < ends.size(); i++) {
+		const ContainedReadEnd & end = ends[i];
+		assert(end.downstream_read_idx < num_vertices());
+		assert(end.downstream_read_dir < 2);
+		const v_idx_t dv_idx = end.downstream_read_idx * 2 +
+				       end.downstream_read_dir;
+		keys[i] = std::make_pair((uint64_t(dv_idx) << 32) | end.overhang_len,
+					 end.weight);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	// Start of each group of identical keys, plus a sentinel.
+	std::vector<size_t> group_starts;
+	for (size_t i = 0; i < keys.size(); i++)
+		if (i == 0 || keys[i].first != keys[i - 1].first)
+			group_starts.push_back(i);
+	group_starts.push_back(keys.size());
+	const size_t num_groups = group_starts.size() - 1;
+
+	info("Mapping %zu ends of contained reads (%zu distinct) into the graph",
+	     ends.size(), num_groups);
+
+	index_back_edges();
+
+	// Amount to add to the mapped read count of each half-edge.
+	std::vector<double> mapped_read_counts(num_edges() * 2, 0.0);
+
+	size_t num_mapped = 0;
+	size_t num_unmapped = 0;
+	size_t num_ambiguous = 0;
+
+	#pragma omp parallel reduction(+:num_mapped, num_unmapped, num_ambiguous)
+	{
+		back_walk_memo memo;
+
+		#pragma omp for schedule(dynamic, 256)
+		for (size_t g = 0; g < num_groups; g++) {
+			const uint64_t key = keys[group_starts[g]].first;
+			const size_t count = group_starts[g + 1] - group_starts[g];
+			double group_weight = 0;
+			for (size_t i = group_starts[g]; i < group_starts[g + 1]; i++)
+				group_weight += keys[i].second;
+
+			if (memo.size() > (1 << 20))
+				memo.clear();
+
+			const back_walk_result & res =
+				walk_back_edges(v_idx_t(key >> 32),
+						BaseVec::size_type(key), memo);
+			if (res.overflowed) {
+				num_ambiguous += count;
+			} else if (res.edges.size() == 0) {
+				num_unmapped += count;
+			} else {
+				const double weight = group_weight /
+						      double(res.edges.size());
+				foreach (const edge_idx_t h, res.edges) {
+					assert2(h < num_edges() * 2);
+					atomic_add(&mapped_read_counts[h], weight);
+				}
+				num_mapped += count;
+			}
+		}
+	}
+
+	for (edge_idx_t edge_idx = 0; edge_idx < num_edges(); edge_idx++) {
+		const double n = mapped_read_counts[edge_idx * 2] +
+				 mapped_read_counts[edge_idx * 2 + 1];
+		if (n != 0.0)
+			_edges[edge_idx].increment_mapped_read_count(n / 2);
+	}
+
+	std::vector<edge_idx_t>().swap(_back_edge_offsets);
+	std::vector<edge_idx_t>().swap(_back_edges);
+
+	info("Mapped %zu ends; %zu mapped nowhere, %zu mapped ambiguously",
+	     num_mapped, num_unmapped, num_ambiguous);
+}
+
+//
+// Calculate the A-statistic of each edge.
+//
+// The statistics are calculated for each half-edge with its own label length,
+// as DirectedStringGraph::calculate_A_statistics() calculates them for each
+// directed edge, and the A-statistic of an edge is the mean of those of its
+// half-edges.
+//
 void BidirectedStringGraph::calculate_A_statistics()
 {
-	unimplemented();
+	size_t num_reads = _orig_num_reads;
+	size_t genome_len;
+
+	size_t bootstrap_genome_len = 0;
+	size_t bootstrap_num_reads = num_reads;
+	size_t n_edges = num_edges();
+	for (size_t i = 0; i < n_edges; i++)
+		for (unsigned side = 0; side < 2; side++)
+			if (_edges[i].get_directed_tail_idx(side) & 1)
+				bootstrap_genome_len += _edges[i].get_label(side).length();
+
+	float global_arrival_rate = FLOAT_DIV_NONZERO(bootstrap_num_reads,
+						      bootstrap_genome_len);
+
+	info("Bootstrapping with bootstream_genome_len = %zu, "
+	     "bootstrap_num_reads = %zu, global_arrival_rate = %f",
+	     bootstrap_genome_len, bootstrap_num_reads, global_arrival_rate);
+
+	const size_t NUM_BOOTSTRAP_ITERATIONS = 3;
+	const float SINGLE_COPY_THRESHOLD = 17.0;
+
+	for (size_t i = 0; i < NUM_BOOTSTRAP_ITERATIONS; i++) {
+		size_t num_unique_edges = 0;
+		size_t num_optional_edges = 0;
+		size_t num_required_edges = 0;
+
+		bootstrap_genome_len = 0;
+		bootstrap_num_reads = 0;
+		for (size_t j = 0; j < n_edges; j++) {
+			BidirectedStringGraphEdge & e = _edges[j];
+			unsigned edge_reads = e.get_mapped_read_count();
+			float A_statistic_sum = 0;
+			for (unsigned side = 0; side < 2; side++) {
+				size_t edge_len = e.get_label(side).length();
+				float A_statistic = (global_arrival_rate * edge_len) -
+						     (edge_reads * M_LN2);
+				A_statistic_sum += A_statistic;
+				if (A_statistic >= SINGLE_COPY_THRESHOLD) {
+					bootstrap_genome_len += edge_len;
+					bootstrap_num_reads += edge_reads;
+					num_unique_edges++;
+				} else if (edge_reads == 0) {
+					num_optional_edges++;
+				} else {
+					num_required_edges++;
+				}
+			}
+			e.set_A_statistic(A_statistic_sum / 2);
+		}
+		global_arrival_rate = FLOAT_DIV_NONZERO(bootstrap_num_reads,
+							bootstrap_genome_len);
+		genome_len = DIV_NONZERO(num_reads, global_arrival_rate);
+		info("Iteration %zu of %zu:  Estimated genome length "
+		     "%zu", i, NUM_BOOTSTRAP_ITERATIONS, genome_len);
+		info("num_unique_edges = %zu", num_unique_edges);
+		info("num_optional_edges = %zu", num_optional_edges);
+		info("num_required_edges = %zu", num_required_edges);
+	}
 }
 
-void BidirectedStringGraph::min_cost_circulation()
+//
+// Solve a minimum-cost circulation problem on a bidirected string graph,
+// setting the traversal count of each edge.
+//
+// A special vertex is added, with an edge of each of the four orientations
+// between it and every other vertex; these are the special edges of the
+// directed string graph, two special vertices of which are the ends of the
+// special vertex here.  The flow network is built over the ends of the vertices
+// with an arc for each half-edge, as DirectedStringGraph::min_cost_circulation()
+// builds it over its vertices and edges, and the traversal count of an edge is
+// the sum of the flows on its half-edges.  Flow is conserved at both ends of a
+// vertex, so the traversal counts balance the inward and outward heads of every
+// vertex, as an Eulerian cycle requires.
+//
+// The problem is solved separately, and in parallel, on each weakly connected
+// component of the graph without the special vertex.
+//
+void BidirectedStringGraph::min_cost_circulation(const circulation_solver solver)
 {
-	unimplemented();
+	info("Adding special vertex and edges");
+	v_idx_t n_verts = num_vertices();
+	const edge_idx_t first_special_edge_idx = num_edges();
+	_vertices.resize(n_verts + 1);
+	_vertices[n_verts].set_special();
+
+	for (v_idx_t v_idx = 0; v_idx < n_verts; v_idx++) {
+		for (v_idx_t dirs = 0; dirs < 4; dirs++) {
+			add_edge_pair(v_idx, n_verts, dirs, EdgeLabel(), EdgeLabel());
+			_edges.back().set_special();
+		}
+	}
+	index_new_edges(first_special_edge_idx);
+
+	info("Finding weakly connected components");
+	component_index ci;
+	index_components(ci);
+	const size_t n_comps = ci.num_components();
+
+	// As in DirectedStringGraph::min_cost_circulation(), the largest
+	// components are started first.
+	std::vector<size_t> order(n_comps);
+	for (size_t c = 0; c < n_comps; c++)
+		order[c] = c;
+	std::stable_sort(order.begin(), order.end(),
+			 [&](size_t c1, size_t c2) {
+				 return ci.edge_indices(c1).size() >
+					ci.edge_indices(c2).size();
+			 });
+
+	info("Solving min-cost circulation on %zu components", n_comps);
+	int64_t total_cost = 0;
+	#pragma omp parallel for schedule(dynamic, 1) reduction(+: total_cost)
+	for (size_t i = 0; i < n_comps; i++)
+		total_cost += component_min_cost_circulation(ci, order[i], n_verts,
+							     solver);
+	info("Done (total cost: %lld)", (long long)total_cost);
 }
 
-// Verifies an Eulerian cycle that was computed on this bidirected graph.
+// Solve the min-cost circulation problem on the component @c of @ci, setting
+// the traversal counts of its edges, and return the cost of the solution.  The
+// network has a node for each end of each vertex of the component and of a
+// local copy of the special vertex @special_v_idx.
+int64_t BidirectedStringGraph::component_min_cost_circulation(const component_index & ci,
+							       const size_t c,
+							       const v_idx_t special_v_idx,
+							       const circulation_solver solver)
+{
+	static const int INFINITE_FLOW = 1000000;
+	static const int HUGE_COST = 1000000;
+	static const float SINGLE_COPY_THRESHOLD = 17.0;
+
+	const v_idx_t n_local_verts = ci.num_vertices(c);
+	const EdgeIdxRange<const edge_idx_t> comp_edges = ci.edge_indices(c);
+	CirculationNetwork network((n_local_verts + 1) * 2,
+				   comp_edges.size() * 2);
+
+	// Node of the vertex end with directed vertex index @d_idx.
+	auto node = [&](const v_idx_t d_idx) {
+		const v_idx_t v_idx = d_idx / 2;
+		const v_idx_t local_v_idx = (v_idx == special_v_idx) ?
+					    n_local_verts :
+					    ci.local_v_indices[v_idx];
+		return local_v_idx * 2 + (d_idx & 1);
+	};
+	foreach (const edge_idx_t edge_idx, comp_edges) {
+		const BidirectedStringGraphEdge & e = _edges[edge_idx];
+		int flow_lower_bound;
+		int flow_upper_bound;
+		int cost_per_unit_flow;
+		if (e.is_special()) {
+			flow_lower_bound = 0;
+			flow_upper_bound = INFINITE_FLOW;
+			cost_per_unit_flow = HUGE_COST;
+		} else {
+			if (e.get_A_statistic() >= SINGLE_COPY_THRESHOLD) {
+				flow_lower_bound = 1;
+				flow_upper_bound = 1;
+			} else {
+				if (e.get_num_inner_vertices() > 0)
+					flow_lower_bound = 1;
+				else
+					flow_lower_bound = 0;
+				flow_upper_bound = INFINITE_FLOW;
+			}
+			cost_per_unit_flow = 1;
+		}
+		for (unsigned side = 0; side < 2; side++) {
+			network.add_arc(node(e.get_directed_tail_idx(side)),
+					node(e.get_directed_head_idx(side)),
+					flow_lower_bound, flow_upper_bound,
+					cost_per_unit_flow);
+		}
+	}
+
+	const int64_t cost = network.solve(solver);
+	for (size_t i = 0; i < comp_edges.size(); i++) {
+		_edges[comp_edges[i]].set_traversal_count(network.flow(i * 2) +
+							  network.flow(i * 2 + 1));
+	}
+	return cost;
+}
+
+// Verifies an Eulerian cycle that was computed on this bidirected graph: every
+// edge is traversed the correct number of times, and each half-edge of the
+// cycle leaves the end of the vertex at which the previous one arrived.
 void BidirectedStringGraph::assert_eulerian_cycle_valid
-			(const std::vector<size_t> & cycle) const
+			(const PackedIntVec & cycle) const
 {
 
 	info("Verifying Eulerian cycle of length %zu on bidirected graph...",
@@ -353,80 +979,23 @@ void BidirectedStringGraph::assert_eulerian_cycle_valid
 	// Make sure every edge was traversed the correct number of times.
 	{
 		std::vector<edge_idx_t> times_traversed(num_edges(), 0);
-		foreach (const size_t edge_idx, cycle) {
-			times_traversed[edge_idx]++;
+		for (size_t i = 0; i < cycle.size(); i++) {
+			assert(cycle[i] / 2 < num_edges());
+			times_traversed[cycle[i] / 2]++;
 		}
 		for (size_t i = 0; i < num_edges(); i++) {
 			assert(times_traversed[i] == _edges[i].get_traversal_count());
 		}
 	}
 
-	// An empty cycle is valid provided that no edges needed to be
-	// traversed.
-	if (cycle.empty())
-		return;
-
-	const BidirectedStringGraphEdge & first_edge = _edges[cycle[0]];
-
-	// Index of the current vertex, and the direction of the head relative
-	// through which it was entered (relative to itself)
-	v_idx_t cur_v_idx = first_edge.get_v1_idx();
-	bool inward = !first_edge.v1_inward();
-
-	if (cycle.size() > 1) {
-		// We want to go around the cycle in the direction that it was
-		// provided in.  So, for the first edge between vertices A and
-		// B, check to make sure the second edge in the cycle includes
-		// vertex B with the direction of the adjacent head consistent
-		// with the head in the edge between A and B.  If not, flip
-		// vertices B and A so we go the other way around the cycle.
-		const BidirectedStringGraphEdge & second_edge = _edges[cycle[1]];
-		if ((second_edge.get_v1_idx() != first_edge.get_v2_idx() ||
-		     second_edge.v1_inward() == first_edge.v2_inward())
-		    && (second_edge.get_v2_idx() != first_edge.get_v2_idx() ||
-			second_edge.v2_inward() == first_edge.v2_inward()))
-		{
-			cur_v_idx = first_edge.get_v2_idx();
-			inward = !first_edge.v2_inward();
-		}
-	}
-	v_idx_t start_v_idx = cur_v_idx;
-	bool start_inward = inward;
-
-	for (const edge_idx_t edge_idx : cycle) {
-		// Given that vertex v of index cur_v_idx has been entered
-		// through a head in direction @inward relative to v, assert
-		// that the next edge e in the cycle contains v and can be
-		// traversed as part of a valid walk in the bidirected graph.
-		const BidirectedStringGraphEdge & e = _edges[edge_idx];
-
-		assert(cur_v_idx == e.get_v1_idx() ||
-		       cur_v_idx == e.get_v2_idx());
-
-		if (e.get_v1_idx() == cur_v_idx &&
-		    e.v1_inward() != inward)
-		{
-			// We can walk from the first vertex to the second
-			// vertex in the edge.
-			inward = e.v2_inward();
-			cur_v_idx = e.get_v2_idx();
-			continue;
-		}
-		if (e.get_v2_idx() == cur_v_idx &&
-		    e.v2_inward() != inward)
-		{
-			// We can walk from the second vertex to the first
-			// vertex in the edge.
-			inward = e.v1_inward();
-			cur_v_idx = e.get_v1_idx();
-			continue;
-		}
-		assert(0);
+	// Make sure the half-edges form a walk that returns to where it
+	// started, through the correctly directed head.
+	for (size_t i = 0; i < cycle.size(); i++) {
+		const edge_idx_t h = cycle[i];
+		const edge_idx_t next_h = cycle[(i + 1) % cycle.size()];
+		assert(_edges[h / 2].get_directed_head_idx(h & 1) ==
+		       _edges[next_h / 2].get_directed_tail_idx(next_h & 1));
 	}
-	// Assert we got back to where we started and went through the
-	// correctly directed head to get there.
-	assert(cur_v_idx == start_v_idx);
-	assert(inward == start_inward);
 	info("Eulerian cycle verified.");
 }
 
@@ -435,10 +1004,9 @@ void BidirectedStringGraph::assert_eulerian_cycle_valid
 void BidirectedStringGraph::assert_eulerian_cycle_possible() const
 {
 	for (v_idx_t v_idx = 0; v_idx < num_vertices(); v_idx++) {
-		const BidirectedStringGraphVertex & v = _vertices[v_idx];
 		unsigned long in_degree = 0;
 		unsigned long out_degree = 0;
-		foreach (const edge_idx_t edge_idx, v.edge_indices()) {
+		foreach (const edge_idx_t edge_idx, edge_indices(v_idx)) {
 			const BidirectedStringGraphEdge & e = _edges[edge_idx];
 			v_idx_t v1_idx, v2_idx;
 			e.get_v_indices(v1_idx, v2_idx);
@@ -456,8 +1024,7 @@ void BidirectedStringGraph::assert_eulerian_cycle_possible() const
 			}
 		}
 		if (in_degree != out_degree) {
-			std::cerr << _vertices[v_idx] << std::endl;
-			foreach (const edge_idx_t edge_idx, v.edge_indices()) {
+			foreach (const edge_idx_t edge_idx, edge_indices(v_idx)) {
 				std::cerr << _edges[edge_idx] << std::endl;
 			}
 			fatal_error("Vertex %u: in_degree(=%u) != out_degree(=%u)",
@@ -477,160 +1044,123 @@ void BidirectedStringGraph::assert_eulerian_cycle_possible() const
 // calling BidirectedStringGraphEdge::get_traversal_count().
 //
 // If a generalized Eulerian cycle can be found in this bidirected graph, the
-// indices of the edges in the cycle, in order, are returned in the vector
-// @cycle, which is resized to the length of the cycle.  Otherwise, this
-// function aborts the program with an error message.
+// half-edges of the cycle, in order, are written to the file @filename as a
+// PackedIntVec as they are found.  Half-edge edge_idx * 2 + side is the edge
+// traversed from side @side, so readers of the cycle need not work out the
+// direction of each edge.  Otherwise, this function aborts the program with an
+// error message.
 //
-void BidirectedStringGraph::eulerian_cycle(std::vector<size_t> & cycle) const
+// A walk in the bidirected graph is a walk in the directed graph it represents:
+// entering a vertex through an inward head means being at the end of the vertex
+// from which the edges with an outward head there leave.  So this is
+// Hierholzer's algorithm run on the half-edges, with their tails and heads at
+// the ends of the vertices, except that the two half-edges of an edge share its
+// remaining traversal count.  The half-edges are indexed by the vertex end at
+// their tail, so the next half-edge out of the current end is found without
+// looking at any half-edge leaving in the wrong direction, and each one is
+// passed over only once it has no traversals left; each step is therefore O(1)
+// amortized.
+//
+// The stack of half-edges on the current walk holds up to one entry per
+// traversal, but the cycle itself is never held in memory: each half-edge is
+// written out as it is popped, which gives the cycle in reverse order.  So the
+// opposite half-edge, which traverses the edge the other way, is written.
+//
+void BidirectedStringGraph::eulerian_cycle(const char *filename) const
 {
 	assert_eulerian_cycle_possible();
 
-	v_idx_t n_verts = num_vertices();
-	edge_idx_t n_edges = num_edges();
+	const v_idx_t n_verts = num_vertices();
+	const size_t n_edges = num_edges();
+	const size_t n_dverts = size_t(n_verts) * 2;
 
 	info("Finding a generalized Eulerian cycle in bidirected graph");
 	info("n_verts = %lu", n_verts);
-	info("n_edges = %lu", n_edges);
+	info("n_edges = %zu", n_edges);
 
 	unsigned long total_traversal_count = 0;
 	unsigned long num_special_edges = 0;
 	unsigned long special_traversal_count = 0;
-	v_idx_t start_v_idx;
-	bool found_start_v_idx = false;
-	foreach (const BidirectedStringGraphEdge & e, _edges) {
+	std::vector<unsigned> remaining(n_edges);
+	std::vector<edge_idx_t> offsets(n_dverts + 1, 0);
+	for (edge_idx_t edge_idx = 0; edge_idx < n_edges; edge_idx++) {
+		const BidirectedStringGraphEdge & e = _edges[edge_idx];
 		if (e.is_special()) {
 			num_special_edges++;
 			special_traversal_count += e.get_traversal_count();
 		}
 		total_traversal_count += e.get_traversal_count();
-		if (!found_start_v_idx) {
-			if (e.v1_outward()) {
-				start_v_idx = e.get_v1_idx();
-				found_start_v_idx = true;
-			} else if (e.v2_outward()) {
-				start_v_idx = e.get_v2_idx();
-				found_start_v_idx = true;
-			}
-		}
+		remaining[edge_idx] = e.get_traversal_count();
+		if (remaining[edge_idx] != 0)
+			for (unsigned side = 0; side < 2; side++)
+				offsets[e.get_directed_tail_idx(side) + 1]++;
 	}
 	info("total_traversal_count = %lu", total_traversal_count);
 	info("num_special_edges = %lu", num_special_edges);
 	info("special_traversal_count = %lu", special_traversal_count);
 
-	if (!found_start_v_idx) {
+	PackedIntVecWriter out(filename, total_traversal_count,
+			       PackedIntVec::bytes_needed(n_edges * 2));
+	if (total_traversal_count == 0) {
 		info("WARNING: Empty Eulerian cycle!");
+		out.close();
 		return;
 	}
-	info("Starting the cycle at vertex %lu", start_v_idx + 1);
-
-	// Start with empty path and empty stack
-	cycle.clear();
-	cycle.reserve(total_traversal_count);
-
-	struct stack_elem {
-		// index of vertex
-		v_idx_t v_idx;
 
-		// index of edge we're taking out of vertex v_idx
-		edge_idx_t edge_idx;
-
-		// direction of head relative to vertex v_idx through which
-		// vertex v_idx was entered
-		bool inward;
-	};
-	std::vector<stack_elem> stack;
-
-	std::vector<edge_idx_t> in_indices(n_verts, 0);
-	std::vector<edge_idx_t> out_indices(n_verts, 0);
-	std::vector<unsigned> times_traversed(n_edges, 0);
-
-	// Start by looking for out heads; this implies that we consider the
-	// starting vertex to have been entered through an inward head.
-	bool inward = true;
-	v_idx_t v_idx = start_v_idx;
-	while (1) {
-		edge_idx_t edge_idx;
-		bool pop_stack = true;
-		const BidirectedStringGraphVertex & v = _vertices[v_idx];
-		const BidirectedStringGraphEdge *e;
-		if (inward) {
-			// v was entered through an inwards head, so look for
-			// adjacent edges that still have traversal count
-			// remaining and begin with a head pointed outwards
-			// relative to v.
-			for (; out_indices[v_idx] < v.degree(); out_indices[v_idx]++) {
-				edge_idx = v.edge_indices()[out_indices[v_idx]];
-				e = &_edges[edge_idx];
-
-				if (times_traversed[edge_idx] < e->get_traversal_count() &&
-				    e->v_outward(v_idx))
-				{
-					pop_stack = false;
-					break;
-				}
-			}
-		} else {
-			// v was entered through an outwards head, so look for
-			// adjacent edges that still have traversal count
-			// remaining and begin with a head pointed inwards
-			// relative to v.
-			for (; in_indices[v_idx] < v.degree(); in_indices[v_idx]++) {
-				edge_idx = v.edge_indices()[in_indices[v_idx]];
-				e = &_edges[edge_idx];
-				if (times_traversed[edge_idx] < e->get_traversal_count() &&
-				    e->v_inward(v_idx))
-				{
-					pop_stack = false;
-					break;
-				}
-			}
+	// Index the half-edges of the edges still to be traversed by the end
+	// of the vertex at their tails.
+	for (size_t dv_idx = 0; dv_idx < n_dverts; dv_idx++)
+		offsets[dv_idx + 1] += offsets[dv_idx];
+	std::vector<edge_idx_t> half_edges(offsets[n_dverts]);
+	std::vector<edge_idx_t> cur(offsets.begin(), offsets.end() - 1);
+	for (edge_idx_t edge_idx = 0; edge_idx < n_edges; edge_idx++) {
+		if (remaining[edge_idx] != 0) {
+			const BidirectedStringGraphEdge & e = _edges[edge_idx];
+			for (unsigned side = 0; side < 2; side++)
+				half_edges[cur[e.get_directed_tail_idx(side)]++] =
+					edge_idx * 2 + side;
 		}
-		if (pop_stack) {
-
-			// v does not have an edge that can be traversed.
-			//
-			// Pop (v_idx, edge_idx, inward) from stack and add
-			// edge_idx to cycle.  If stack is empty, the cycle is
-			// complete.
+	}
+	std::copy(offsets.begin(), offsets.end() - 1, cur.begin());
+
+	// Start at the tail of the first edge to be traversed.
+	v_idx_t dv_idx = 0;
+	for (edge_idx_t edge_idx = 0; edge_idx < n_edges; edge_idx++) {
+		if (remaining[edge_idx] != 0) {
+			dv_idx = _edges[edge_idx].get_directed_tail_idx(0);
+			break;
+		}
+	}
+	info("Starting the cycle at vertex %lu", dv_idx / 2 + 1);
+
+	std::vector<edge_idx_t> stack;
+	for (;;) {
+		const edge_idx_t end = offsets[dv_idx + 1];
+		while (cur[dv_idx] < end &&
+		       remaining[half_edges[cur[dv_idx]] / 2] == 0)
+			cur[dv_idx]++;
+		if (cur[dv_idx] < end) {
+			// Traverse the half-edge h once more and move on to
+			// the end of the vertex at its head.
+			const edge_idx_t h = half_edges[cur[dv_idx]];
+			remaining[h / 2]--;
+			stack.push_back(h);
+			dv_idx = _edges[h / 2].get_directed_head_idx(h & 1);
+		} else {
+			// Nothing left to traverse from here, so the last
+			// half-edge taken is finished.  Output it, reversed,
+			// and back up to its tail.
 			if (stack.empty())
 				break;
-			const stack_elem & elem = stack.back();
-			v_idx = elem.v_idx;
-			edge_idx = elem.edge_idx;
-			inward = elem.inward;
+			const edge_idx_t h = stack.back();
 			stack.pop_back();
-
-			//info("Popped (v_idx=%u, edge_idx=%u, inward=%d)",
-			     //v_idx, edge_idx, inward);
-			//_edges[edge_idx].print(std::cout, v_idx, false);
-
-			cycle.push_back(edge_idx);
-		} else {
-			// v has an edge (_edges[edge_idx]) that can be traversed.
-			//
-			// Push (v_idx, edge_idx, inward) onto the stack, then
-			// mark the edge as traversed one additional time, then
-			// move to the vertex at the other end of the edge by
-			// updating v_idx and edge_idx.
-			stack_elem elem;
-			elem.v_idx = v_idx;
-			elem.edge_idx = edge_idx;
-			elem.inward = inward;
-
-			//info("Pushed (v_idx=%u, edge_idx=%u, inward=%d)",
-			     //v_idx, edge_idx, inward);
-
-			stack.push_back(elem);
-			times_traversed[edge_idx]++;
-
-			v_idx = _edges[edge_idx].get_other_v_idx(v_idx);
-			if (_edges[edge_idx].is_loop()) {
-				inward ^= (_edges[edge_idx].v1_inward() ==
-					   _edges[edge_idx].v2_inward());
-			} else {
-				inward = _edges[edge_idx].this_v_inward(v_idx);
-			}
+			out.push_back(h ^ 1);
+			dv_idx = _edges[h / 2].get_directed_tail_idx(h & 1);
 		}
 	}
-	assert_eulerian_cycle_valid(cycle);
+	if (out.num_written() != total_traversal_count) {
+		fatal_error("The edges to be traversed are not connected, so "
+			    "there is no Eulerian cycle");
+	}
+	out.close();
 }
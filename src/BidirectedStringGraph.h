@@ -2,6 +2,9 @@
 
 #include "StringGraph.h"
 #include "BaseVec.h"
+#include "Circulation.h"
+#include "EdgeLabel.h"
+#include "PackedIntVec.h"
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/base_object.hpp>
 #include <ostream>
@@ -21,13 +24,6 @@ private:
 		ar & boost::serialization::base_object<StringGraphVertex>(*this);
 	}
 public:
-	size_t out_degree() const
-	{
-		unimplemented();
-	}
-
-	size_t degree() const { return _edge_indices.size(); }
-
 	// Print a bidirected string graph vertex in DOT format
 	void print_dot(std::ostream & os, size_t v_idx) const
 	{
@@ -63,11 +59,11 @@ private:
 
 	// Sequence when this bidirected edge is traversed in the direction
 	// vertex 1 to vertex 2.
-	BaseVec _seq_1_to_2;
+	EdgeLabel _label_1_to_2;
 
 	// Sequence when this bidirected edge is traversed in the direction
 	// vertex 2 to vertex 1.
-	BaseVec _seq_2_to_1;
+	EdgeLabel _label_2_to_1;
 
 	// Serialize or deserialize this bidirected string graph edge to a
 	// stream.
@@ -77,17 +73,65 @@ private:
 	{
 		ar & boost::serialization::base_object<StringGraphEdge>(*this);
 		ar & _data;
-		ar & _seq_1_to_2;
-		ar & _seq_2_to_1;
+		ar & _label_1_to_2;
+		ar & _label_2_to_1;
 	}
 public:
 	typedef unsigned int v_idx_t;
 
-	BaseVec & get_seq_1_to_2() { return _seq_1_to_2; }
-	BaseVec & get_seq_2_to_1() { return _seq_2_to_1; }
-	const BaseVec & get_seq_1_to_2() const { return _seq_1_to_2; }
-	const BaseVec & get_seq_2_to_1() const { return _seq_2_to_1; }
-	BaseVec::size_type length() const { return _seq_1_to_2.size(); }
+	EdgeLabel & get_label_1_to_2() { return _label_1_to_2; }
+	EdgeLabel & get_label_2_to_1() { return _label_2_to_1; }
+	const EdgeLabel & get_label_1_to_2() const { return _label_1_to_2; }
+	const EdgeLabel & get_label_2_to_1() const { return _label_2_to_1; }
+	BaseVec::size_type length() const { return _label_1_to_2.length(); }
+
+	//
+	// An edge can be traversed in two ways, which are numbered by a "side":
+	// side 0 goes from vertex 1 to vertex 2, and side 1 goes from vertex 2
+	// to vertex 1.  Each way corresponds to one of the two edges of the
+	// directed string graph that this edge represents.
+	//
+
+	// Return the sequence label of this edge when traversed from side
+	// @side.
+	const EdgeLabel & get_label(const unsigned side) const
+	{
+		return side ? _label_2_to_1 : _label_1_to_2;
+	}
+
+	// Return the index, in the corresponding directed string graph, of the
+	// vertex at the tail of the edge traversed from side @side.
+	v_idx_t get_directed_tail_idx(const unsigned side) const
+	{
+		if (side)
+			return get_v2_idx() * 2 + v2_outward();
+		else
+			return get_v1_idx() * 2 + v1_outward();
+	}
+
+	// Return the index, in the corresponding directed string graph, of the
+	// vertex at the head of the edge traversed from side @side.
+	v_idx_t get_directed_head_idx(const unsigned side) const
+	{
+		if (side)
+			return get_v1_idx() * 2 + v1_inward();
+		else
+			return get_v2_idx() * 2 + v2_inward();
+	}
+
+	// Return the length of this edge when traversed away from the vertex
+	// @v_idx.  A loop can be traversed away from its vertex either way, so
+	// the shorter of the two lengths is returned for it.
+	BaseVec::size_type length_from(const v_idx_t v_idx) const
+	{
+		if (is_loop())
+			return std::min(_label_1_to_2.length(),
+					_label_2_to_1.length());
+		else if (v_idx == get_v1_idx())
+			return _label_1_to_2.length();
+		else
+			return _label_2_to_1.length();
+	}
 
 	v_idx_t get_other_v_idx(const v_idx_t this_v_idx) const
 	{
@@ -134,6 +178,16 @@ public:
 		v2_idx = get_v2_idx();
 	}
 
+	// Get the indices of the vertices in whose adjacency lists this edge
+	// appears, and return how many there are.  A bidirected edge appears in
+	// the lists of both of its vertices--- twice in the same list if it is
+	// a loop.
+	unsigned get_adj_v_indices(v_idx_t v_indices[2]) const
+	{
+		get_v_indices(v_indices[0], v_indices[1]);
+		return 2;
+	}
+
 	v_idx_t get_dirs() const
 	{
 		return _data >> 62;
@@ -204,10 +258,12 @@ public:
 		_data = (_data & ~(3ULL << 62)) | (uint64_t(dirs) << 62);
 	}
 
-	// Print a bidirected string graph edge
+	// Print a bidirected string graph edge.  @reads is the read store of
+	// the graph, used to print sequence labels that refer to it.
 	void print(std::ostream & os = std::cout,
 		   const v_idx_t v_idx = 0,
-		   const bool print_seqs = false) const
+		   const bool print_seqs = false,
+		   const BaseVecVec * reads = NULL) const
 	{
 		v_idx_t read_1_idx = get_v1_idx();
 		v_idx_t read_2_idx = get_v2_idx();
@@ -223,14 +279,14 @@ public:
 		   << '\t';
 		StringGraphEdge::print(os);
 		if (print_seqs)
-			os << _seq_1_to_2;
+			_label_1_to_2.print(os, reads);
 		else
-			os << _seq_1_to_2.length();
+			os << _label_1_to_2.length();
 		os << '\t';
 		if (print_seqs)
-			os << _seq_2_to_1;
+			_label_2_to_1.print(os, reads);
 		else
-			os << _seq_2_to_1.length();
+			os << _label_2_to_1.length();
 		os << '\r';
 	}
 
@@ -244,7 +300,8 @@ public:
 
 	// Print a bidirected string graph edge in DOT format
 	void print_dot(std::ostream & os, const v_idx_t v_idx,
-		       const bool print_seqs) const
+		       const bool print_seqs,
+		       const BaseVecVec * reads = NULL) const
 	{
 		if (v_idx == get_v1_idx()) {
 			const char *head_1 = (v1_inward()) ? "normal" : "inv";
@@ -256,11 +313,11 @@ public:
 			   << " dir=both arrowhead=" << head_2
 			   << " arrowtail=" << head_1;
 			if (print_seqs) {
-				os << " taillabel=\""
-				   << _seq_1_to_2
-				   << "\" headlabel=\""
-				   << _seq_2_to_1
-				   << '"';
+				os << " taillabel=\"";
+				_label_1_to_2.print(os, reads);
+				os << "\" headlabel=\"";
+				_label_2_to_1.print(os, reads);
+				os << '"';
 
 				//
 				//   |\\\\-
@@ -322,40 +379,29 @@ public:
 	}
 
 	void transitive_reduction();
-	void min_cost_circulation();
+	void min_cost_circulation(const circulation_solver solver);
 	void collapse_unbranched_paths();
 	void calculate_A_statistics();
 	void print_stats(std::ostream & os) const;
 
-	void map_contained_read(const v_idx_t downstream_read_idx,
-			        const v_idx_t downstream_read_dir,
-			        const BaseVec::size_type overhang_len);
+	void map_contained_reads(const std::vector<ContainedReadEnd> & ends);
+	void set_read_weights(const std::vector<float> & read_weights);
 
 	// An an edge to the bidirected string graph, produced from an overlap
 	void add_edge_pair(const v_idx_t read_1_idx,
 			   const v_idx_t read_2_idx,
 			   const v_idx_t dirs,
-			   const BaseVec & bv1,
-			   const BaseVec::size_type beg_1,
-			   const BaseVec::size_type end_1,
-			   const bool bv1_rc,
-			   const BaseVec & bv2,
-			   const BaseVec::size_type beg_2,
-			   const BaseVec::size_type end_2,
-			   const bool bv2_rc)
+			   const EdgeLabel & label_1,
+			   const EdgeLabel & label_2)
 	{
 		BidirectedStringGraphEdge e;
-		const v_idx_t v1_idx = read_1_idx;
-		const v_idx_t v2_idx = read_2_idx;
 
-		bv1.extract_seq(beg_1, end_1, bv1_rc, e.get_seq_1_to_2());
-		bv2.extract_seq(beg_2, end_2, bv2_rc, e.get_seq_2_to_1());
-		e.set_v_indices(v1_idx, v2_idx);
+		e.get_label_1_to_2() = label_1;
+		e.get_label_2_to_1() = label_2;
+		e.set_v_indices(read_1_idx, read_2_idx);
 		e.set_dirs(dirs);
 
-		edge_idx_t edge_idx = this->push_back_edge(e);
-		_vertices[v1_idx].add_edge_idx(edge_idx);
-		_vertices[v2_idx].add_edge_idx(edge_idx);
+		this->push_back_edge(e);
 	}
 
 	void assert_graph_valid() const
@@ -365,13 +411,31 @@ public:
 	void extract_edge_seqs(BaseVecVec & bvv)
 	{
 		foreach (BidirectedStringGraphEdge & e, _edges) {
-			bvv.push_back(e.get_seq_1_to_2());
-			bvv.push_back(e.get_seq_2_to_1());
+			BaseVec bv_1_to_2, bv_2_to_1;
+			e.get_label_1_to_2().extract(_reads, bv_1_to_2);
+			e.get_label_2_to_1().extract(_reads, bv_2_to_1);
+			bvv.push_back(bv_1_to_2);
+			bvv.push_back(bv_2_to_1);
 		}
 	}
 
-	void eulerian_cycle(std::vector<size_t> & cycle) const;
+	void eulerian_cycle(const char *filename) const;
+	void assert_eulerian_cycle_valid(const PackedIntVec & cycle) const;
 private:
+	void get_out_half_edges(const v_idx_t dv_idx,
+				std::vector<edge_idx_t> & half_edges) const;
+	void follow_unbranched_path(const edge_idx_t edge_idx,
+				    const v_idx_t v_idx,
+				    std::vector<bool> & remove_edge,
+				    std::vector<bool> & remove_vertex,
+				    const std::vector<bool> & v_inner);
+	int64_t component_min_cost_circulation(const component_index & ci,
+						       const size_t c,
+						       const v_idx_t special_v_idx,
+						       const circulation_solver solver);
+	void index_back_edges();
+	const back_walk_result & walk_back_edges(const v_idx_t dv_idx,
+						 const BaseVec::size_type overhang_len,
+						 back_walk_memo & memo) const;
 	void assert_eulerian_cycle_possible() const;
-	void assert_eulerian_cycle_valid(const std::vector<size_t> & cycle) const;
 };
@@ -0,0 +1,287 @@
+#include "Circulation.h"
+#include "util.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <string.h>
+#include <lemon/network_simplex.h>
+#include <lemon/smart_graph.h>
+
+circulation_solver parse_circulation_solver(const char *name)
+{
+	if (strcmp(name, "network-simplex") == 0)
+		return SOLVER_NETWORK_SIMPLEX;
+	if (strcmp(name, "ssp") == 0)
+		return SOLVER_SSP;
+	fatal_error("Unknown min-cost circulation solver \"%s\" (expected "
+		    "network-simplex or ssp)", name);
+}
+
+int64_t CirculationNetwork::solve(circulation_solver solver)
+{
+	bool feasible;
+	switch (solver) {
+	case SOLVER_NETWORK_SIMPLEX:
+		feasible = solve_network_simplex();
+		break;
+	case SOLVER_SSP:
+		feasible = solve_ssp();
+		break;
+	default:
+		unreachable();
+	}
+	if (!feasible)
+		fatal_error("No feasible solution to min-cost circulation");
+
+	int64_t total_cost = 0;
+	for (arc_idx_t arc_idx = 0; arc_idx < num_arcs(); arc_idx++)
+		total_cost += int64_t(_flows[arc_idx]) * _costs[arc_idx];
+	return total_cost;
+}
+
+bool CirculationNetwork::solve_network_simplex()
+{
+	lemon::SmartDigraph G;
+	G.reserveNode(num_nodes());
+	G.reserveArc(num_arcs());
+	lemon::SmartDigraph::ArcMap<int> lower_map(G);
+	lemon::SmartDigraph::ArcMap<int> upper_map(G);
+	lemon::SmartDigraph::ArcMap<int> cost_map(G);
+	lemon::SmartDigraph::NodeMap<int> supply_map(G);
+	for (node_idx_t i = 0; i < num_nodes(); i++) {
+		supply_map[G.addNode()] = 0;
+	}
+	for (arc_idx_t arc_idx = 0; arc_idx < num_arcs(); arc_idx++) {
+		lemon::SmartDigraph::Arc arc =
+			G.addArc(G.nodeFromId(_tails[arc_idx]),
+				 G.nodeFromId(_heads[arc_idx]));
+		lower_map[arc] = _lower[arc_idx];
+		upper_map[arc] = _upper[arc_idx];
+		cost_map[arc] = _costs[arc_idx];
+	}
+
+	typedef lemon::NetworkSimplex<lemon::SmartDigraph> simplex_t;
+	simplex_t simplex(G);
+	simplex.lowerMap(lower_map);
+	simplex.upperMap(upper_map);
+	simplex.supplyMap(supply_map);
+	simplex.costMap(cost_map);
+	simplex_t::ProblemType res = simplex.run();
+	if (res == simplex_t::INFEASIBLE)
+		return false;
+	if (res == simplex_t::UNBOUNDED)
+		fatal_error("Objective function unbounded");
+	_flows.resize(num_arcs());
+	for (arc_idx_t arc_idx = 0; arc_idx < num_arcs(); arc_idx++)
+		_flows[arc_idx] = simplex.flow(G.arcFromId(arc_idx));
+	return true;
+}
+
+//
+// Find a minimum-cost circulation by successive shortest paths, augmenting
+// along all the shortest paths found in each round (the primal-dual method).
+//
+// Every arc first carries its lower bound of flow, which leaves some nodes with
+// an excess of flow and others with a deficit.  The excesses are then sent to
+// the deficits along shortest paths in the residual network, which stays free
+// of negative cycles throughout, so the result has minimum cost.
+//
+// Arc a of the network gives the residual arcs 2a, forwards with the remaining
+// capacity of a, and 2a + 1, backwards with the flow along a that may be taken
+// back.  These are indexed by their tails in compressed sparse row form.
+//
+// Each round runs Dijkstra's algorithm with node potentials, from all the nodes
+// with an excess at once, stopping at the first node with a deficit, at
+// distance D.  Adding to each potential the node's distance, capped at D, keeps
+// every reduced cost nonnegative and makes every shortest path to a distance of
+// at most D consist of arcs of reduced cost 0.  As much flow as possible is then
+// sent along such paths by depth-first search, skipping nodes from which the
+// search has already failed in this round, as in Dinic's algorithm.
+//
+// In the string graph problems, the costs are small and most arcs have small
+// bounds, so few rounds are needed.
+//
+bool CirculationNetwork::solve_ssp()
+{
+	const node_idx_t n = num_nodes();
+	const arc_idx_t m = num_arcs();
+	const int64_t INF = std::numeric_limits<int64_t>::max();
+
+	_flows.assign(_lower.begin(), _lower.end());
+	std::vector<int64_t> excess(n, 0);
+	int64_t remaining = 0;
+	for (arc_idx_t a = 0; a < m; a++) {
+		if (_lower[a] > _upper[a])
+			return false;
+		excess[_tails[a]] -= _lower[a];
+		excess[_heads[a]] += _lower[a];
+	}
+	for (node_idx_t v = 0; v < n; v++)
+		if (excess[v] > 0)
+			remaining += excess[v];
+
+	auto r_tail = [&](arc_idx_t r) {
+		return (r & 1) ? _heads[r >> 1] : _tails[r >> 1];
+	};
+	auto r_head = [&](arc_idx_t r) {
+		return (r & 1) ? _tails[r >> 1] : _heads[r >> 1];
+	};
+	auto r_cap = [&](arc_idx_t r) {
+		const arc_idx_t a = r >> 1;
+		return (r & 1) ? _flows[a] - _lower[a] : _upper[a] - _flows[a];
+	};
+	auto r_cost = [&](arc_idx_t r) {
+		return (r & 1) ? -int64_t(_costs[r >> 1]) : int64_t(_costs[r >> 1]);
+	};
+
+	std::vector<arc_idx_t> offsets(n + 1, 0);
+	std::vector<arc_idx_t> adj(2 * size_t(m));
+	for (arc_idx_t r = 0; r < 2 * m; r++)
+		offsets[r_tail(r) + 1]++;
+	for (node_idx_t v = 0; v < n; v++)
+		offsets[v + 1] += offsets[v];
+	{
+		std::vector<arc_idx_t> next(offsets.begin(), offsets.end() - 1);
+		for (arc_idx_t r = 0; r < 2 * m; r++)
+			adj[next[r_tail(r)]++] = r;
+	}
+
+	std::vector<int64_t> potentials(n, 0);
+	std::vector<int64_t> dist(n);
+	std::vector<unsigned char> settled(n);
+	std::vector<unsigned char> dead(n);
+	std::vector<unsigned char> on_path(n, 0);
+	std::vector<arc_idx_t> cur(n);
+	std::vector<arc_idx_t> path;
+	typedef std::pair<int64_t, node_idx_t> heap_entry;
+	std::priority_queue<heap_entry, std::vector<heap_entry>,
+			    std::greater<heap_entry> > heap;
+
+	while (remaining > 0) {
+		std::fill(dist.begin(), dist.end(), INF);
+		std::fill(settled.begin(), settled.end(), 0);
+		for (node_idx_t v = 0; v < n; v++) {
+			if (excess[v] > 0) {
+				dist[v] = 0;
+				heap.push(heap_entry(0, v));
+			}
+		}
+		int64_t D = -1;
+		while (!heap.empty()) {
+			const heap_entry top = heap.top();
+			heap.pop();
+			const node_idx_t u = top.second;
+			if (settled[u])
+				continue;
+			settled[u] = 1;
+			if (excess[u] < 0) {
+				D = top.first;
+				break;
+			}
+			for (arc_idx_t i = offsets[u]; i < offsets[u + 1]; i++) {
+				const arc_idx_t r = adj[i];
+				if (r_cap(r) <= 0)
+					continue;
+				const node_idx_t v = r_head(r);
+				const int64_t d = top.first + r_cost(r) +
+						  potentials[u] - potentials[v];
+				if (d < dist[v]) {
+					dist[v] = d;
+					heap.push(heap_entry(d, v));
+				}
+			}
+		}
+		while (!heap.empty())
+			heap.pop();
+		if (D < 0)
+			return false;
+		for (node_idx_t v = 0; v < n; v++)
+			potentials[v] += std::min(dist[v], D);
+
+		// Send flow along paths of arcs of reduced cost 0.
+		std::copy(offsets.begin(), offsets.end() - 1, cur.begin());
+		std::fill(dead.begin(), dead.end(), 0);
+		int64_t round_flow = 0;
+		for (node_idx_t s = 0; s < n; s++) {
+			while (excess[s] > 0 && !dead[s]) {
+				node_idx_t u = s;
+				on_path[s] = 1;
+				path.clear();
+				for (;;) {
+					if (u != s && excess[u] < 0)
+						break;
+					const arc_idx_t end = offsets[u + 1];
+					for (; cur[u] < end; cur[u]++) {
+						const arc_idx_t r = adj[cur[u]];
+						const node_idx_t v = r_head(r);
+						if (r_cap(r) > 0 && !dead[v] &&
+						    !on_path[v] &&
+						    r_cost(r) + potentials[u] ==
+						    potentials[v])
+							break;
+					}
+					if (cur[u] < end) {
+						const arc_idx_t r = adj[cur[u]];
+						path.push_back(r);
+						u = r_head(r);
+						on_path[u] = 1;
+						continue;
+					}
+					// No way on from u in this round.
+					dead[u] = 1;
+					on_path[u] = 0;
+					if (path.empty())
+						break;
+					u = r_tail(path.back());
+					path.pop_back();
+					cur[u]++;
+				}
+				if (dead[s])
+					break;
+
+				int64_t delta = std::min(excess[s], -excess[u]);
+				foreach (const arc_idx_t r, path)
+					delta = std::min(delta, int64_t(r_cap(r)));
+				foreach (const arc_idx_t r, path) {
+					if (r & 1)
+						_flows[r >> 1] -= delta;
+					else
+						_flows[r >> 1] += delta;
+					on_path[r_head(r)] = 0;
+				}
+				on_path[s] = 0;
+				excess[s] -= delta;
+				excess[u] += delta;
+				remaining -= delta;
+				round_flow += delta;
+			}
+		}
+		// The shortest path found by Dijkstra's algorithm consists of
+		// arcs of reduced cost 0, so some flow must have been sent.
+		assert(round_flow > 0);
+	}
+	if (get_verify_level() >= VERIFY_STRUCTURE)
+		assert_optimal(potentials);
+	return true;
+}
+
+// Verify that the flows found by solve_ssp() form a circulation within the
+// bounds, and that it has minimum cost: no residual arc has a negative reduced
+// cost under @potentials, so the residual network has no negative cycle.
+void CirculationNetwork::assert_optimal(const std::vector<int64_t> & potentials) const
+{
+	std::vector<int64_t> net_flow(num_nodes(), 0);
+	for (arc_idx_t a = 0; a < num_arcs(); a++) {
+		const node_idx_t u = _tails[a];
+		const node_idx_t v = _heads[a];
+		const int64_t reduced_cost = _costs[a] + potentials[u] - potentials[v];
+		assert(_flows[a] >= _lower[a] && _flows[a] <= _upper[a]);
+		assert(_flows[a] == _upper[a] || reduced_cost >= 0);
+		assert(_flows[a] == _lower[a] || reduced_cost <= 0);
+		net_flow[u] -= _flows[a];
+		net_flow[v] += _flows[a];
+	}
+	foreach (const int64_t f, net_flow)
+		assert(f == 0);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+//
+// Solvers for the minimum-cost circulation problems that are solved on string
+// graphs to find how many times each edge is traversed.
+//
+// SOLVER_NETWORK_SIMPLEX: LEMON's general network simplex algorithm.
+// SOLVER_SSP:             The built-in successive shortest path solver; see
+//                         CirculationNetwork::solve_ssp().
+//
+enum circulation_solver {
+	SOLVER_NETWORK_SIMPLEX,
+	SOLVER_SSP,
+};
+
+#define CIRCULATION_SOLVER_USAGE \
+"   --solver=SOLVER  Algorithm to solve the min-cost circulation with:\n" \
+"                    network-simplex (LEMON) or ssp (built-in successive\n" \
+"                    shortest paths).  The default is network-simplex.\n"
+
+extern circulation_solver parse_circulation_solver(const char *name);
+
+//
+// A network on which to find a circulation--- a flow that is conserved at every
+// node--- of minimum total cost, with a lower and upper bound on the flow along
+// each arc.  All costs must be nonnegative.
+//
+// The arcs are stored as plain arrays rather than in a general graph library's
+// structures, so that the built-in solver needs only the flow and a compressed
+// sparse row index of the residual arcs on top of them.
+//
+class CirculationNetwork {
+public:
+	typedef unsigned int node_idx_t;
+	typedef unsigned int arc_idx_t;
+private:
+	node_idx_t _num_nodes;
+	std::vector<node_idx_t> _tails;
+	std::vector<node_idx_t> _heads;
+	std::vector<int> _lower;
+	std::vector<int> _upper;
+	std::vector<int> _costs;
+	std::vector<int> _flows;
+
+	bool solve_network_simplex();
+	bool solve_ssp();
+	void assert_optimal(const std::vector<int64_t> & potentials) const;
+public:
+	CirculationNetwork(node_idx_t num_nodes, arc_idx_t num_arcs_hint = 0)
+		: _num_nodes(num_nodes)
+	{
+		_tails.reserve(num_arcs_hint);
+		_heads.reserve(num_arcs_hint);
+		_lower.reserve(num_arcs_hint);
+		_upper.reserve(num_arcs_hint);
+		_costs.reserve(num_arcs_hint);
+	}
+
+	// Add an arc from node @tail to node @head along which the flow must be
+	// at least @lower and at most @upper, and costs @cost per unit.  Arcs
+	// are numbered in the order they are added.
+	arc_idx_t add_arc(node_idx_t tail, node_idx_t head,
+			  int lower, int upper, int cost)
+	{
+		_tails.push_back(tail);
+		_heads.push_back(head);
+		_lower.push_back(lower);
+		_upper.push_back(upper);
+		_costs.push_back(cost);
+		return _tails.size() - 1;
+	}
+
+	node_idx_t num_nodes() const { return _num_nodes; }
+	arc_idx_t num_arcs() const { return _tails.size(); }
+
+	// Find a minimum-cost circulation with @solver and return its cost.
+	// Aborts the program if there is no feasible circulation.
+	int64_t solve(circulation_solver solver);
+
+	// Return the flow along the arc @arc_idx in the circulation found by
+	// solve().
+	int flow(arc_idx_t arc_idx) const { return _flows[arc_idx]; }
+};
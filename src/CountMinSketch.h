@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// A count-min sketch: approximate counts of a multiset of 64-bit hash values
+// in a fixed amount of memory.
+//
+// There are NUM_ROWS rows of 2^@bits counters.  A value is counted in one
+// counter of each row, chosen by a different hash of the value for each row,
+// and its count is estimated as the smallest of those counters.  The estimate
+// is never less than the true count, and is greater only where every row has a
+// collision.
+//
+// Counters are incremented atomically, so values may be added concurrently;
+// estimates made concurrently with additions may or may not see them.
+//
+class CountMinSketch {
+private:
+	static const unsigned NUM_ROWS = 4;
+
+	std::vector<uint32_t> _counters;
+	unsigned _bits;
+
+	// Return the index, within row @row, of the counter for @hash.
+	size_t counter_idx(const uint64_t hash, const unsigned row) const
+	{
+		return mix(hash + row * 0x9e3779b97f4a7c15ULL) >> (64 - _bits);
+	}
+public:
+	// Finalizer of the splitmix64 generator, which scrambles the bits of
+	// @x well enough to derive independent-looking hashes from one.
+	static uint64_t mix(uint64_t x)
+	{
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9ULL;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111ebULL;
+		x ^= x >> 31;
+		return x;
+	}
+
+	CountMinSketch(const unsigned bits)
+		: _counters(size_t(NUM_ROWS) << bits, 0), _bits(bits)
+	{ }
+
+	// Count one more occurrence of @hash.
+	void add(const uint64_t hash)
+	{
+		for (unsigned row = 0; row < NUM_ROWS; row++) {
+			uint32_t *counter = &_counters[(size_t(row) << _bits) +
+						       counter_idx(hash, row)];
+			__atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+		}
+	}
+
+	// Return an upper bound on the number of occurrences of @hash.
+	uint32_t estimate(const uint64_t hash) const
+	{
+		uint32_t n = UINT32_MAX;
+		for (unsigned row = 0; row < NUM_ROWS; row++) {
+			const uint32_t count =
+				__atomic_load_n(&_counters[(size_t(row) << _bits) +
+							   counter_idx(hash, row)],
+						__ATOMIC_RELAXED);
+			if (count < n)
+				n = count;
+		}
+		return n;
+	}
+
+	// Return the number of bytes of memory used by the counters.
+	size_t memory_size() const
+	{
+		return _counters.size() * sizeof(_counters[0]);
+	}
+};
@@ -4,9 +4,11 @@
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include "BidirectedStringGraph.h"
+#include <algorithm>
 #include <math.h>
-#include <lemon/network_simplex.h>
-#include <lemon/smart_graph.h>
+#include "compiler.h"
+#include "GraphStats.h"
+#include "parallel.h"
 
 const char DirectedStringGraph::magic[] =
 	{'D', 'i', 'g', 'r', 'a', 'p', 'h', '\0', '\0', '\0'};
@@ -26,6 +28,12 @@ const char DirectedStringGraph::magic[] =
 // for any v and w, since this represents one kind of overlap.  But, it's
 // possible for there to be an edge w -> v as well.
 //
+// The work done at each vertex v only reads the graph and only decides whether
+// the edges leaving v are reduced, so the vertices are processed in parallel.
+// Each thread has its own vertex marks and back edge map, which it returns to
+// their initial state after each vertex.  The result is the same as if the
+// vertices were processed one by one.
+//
 void DirectedStringGraph::transitive_reduction()
 {
 	info("Performing transitive reduction on directed string graph with "
@@ -41,258 +49,254 @@ void DirectedStringGraph::transitive_reduction()
 	static const unsigned char INPLAY = 1;
 	static const unsigned char ELIMINATED = 2;
 
-	// Per-vertex mark.  Initially set to VACANT.
-	std::vector<unsigned char> vertex_marks(this->num_vertices(), VACANT);
-
-	// Map from vertex index to index of edges back to the vertex currently
-	// under consideration
-	std::vector<edge_idx_t> v_idx_to_back_edge_idx(this->num_vertices(),
-						       std::numeric_limits<edge_idx_t>::max());
-
-	// Per-edge boolean indicating whether each edge is to be deleted as
-	// part of the transitive reduction or not.
-	std::vector<bool> reduce_edge(this->num_edges(), false);
-
-	info("Looking for transitive edges based at each of %zu vertices",
-	     vertices.size());
-
-	// Iterate through every vertex @v in the graph that has outgoing edges.
-	for (size_t v_idx = 0; v_idx < vertices.size(); v_idx++) {
-		const DirectedStringGraphVertex & v = vertices[v_idx];
+	// Per-edge flag indicating whether each edge is to be deleted as part of
+	// the transitive reduction or not.  (Not a std::vector<bool>, since
+	// threads set the flags of different edges concurrently.)
+	std::vector<unsigned char> reduce_edge(this->num_edges(), 0);
+
+	// Hash of the label of each edge (see EdgeLabel::hash()), so that most
+	// edges v -> x whose labels are not the concatenation of the labels of
+	// v -> w and w -> x are ruled out without comparing the bases.
+	info("Hashing edge labels");
+	std::vector<uint64_t> label_hashes(this->num_edges());
+	BaseVec::size_type max_len = 0;
+	#pragma omp parallel for schedule(static, 4096) reduction(max:max_len)
+	for (size_t i = 0; i < edges.size(); i++) {
+		label_hashes[i] = edges[i].get_label().hash(_reads);
+		max_len = std::max(max_len, edges[i].length());
+	}
+	std::vector<uint64_t> hash_powers;
+	EdgeLabel::hash_powers(max_len, hash_powers);
 
-		if (v.out_degree() == 0)
-			continue;
+	info("Looking for transitive edges based at each of %zu vertices "
+	     "(%d threads)", vertices.size(), omp_get_max_threads());
 
-		// Mark each vertex adjacent to @v as INPLAY, and initialize the
-		// map from the adjacent vertices' indices to the back edges'
-		// indices.
-		foreach(const edge_idx_t edge_idx, v.edge_indices()) {
-			const DirectedStringGraphEdge & e = edges[edge_idx];
-			const v_idx_t w_idx = e.get_v2_idx();
-			assert(edge_idx != std::numeric_limits<edge_idx_t>::max());
-			assert(v_idx_to_back_edge_idx[w_idx] ==
-			       std::numeric_limits<edge_idx_t>::max());
-			v_idx_to_back_edge_idx[w_idx] = edge_idx;
-
-			vertex_marks[w_idx] = INPLAY;
-		}
+	#pragma omp parallel
+	{
+		// Per-vertex mark.  Initially set to VACANT.
+		std::vector<unsigned char> vertex_marks(this->num_vertices(), VACANT);
 
-		// Length of the longest sequence label on the edges leaving
-		// vertex @v.
-		const BaseVec::size_type longest = edges[v.edge_indices().back()].length();
+		// Map from vertex index to index of edges back to the vertex
+		// currently under consideration
+		std::vector<edge_idx_t> v_idx_to_back_edge_idx(this->num_vertices(),
+							       std::numeric_limits<edge_idx_t>::max());
 
-		// For each outgoing edge from v -> w in order of labeled
-		// sequence length, consider each vertex w that is still marked
-		// INPLAY.
-		foreach(const edge_idx_t edge_idx, v.edge_indices()) {
-			const DirectedStringGraphEdge & e = edges[edge_idx];
-			const v_idx_t w_idx = e.get_v2_idx();
+		// Iterate through every vertex @v in the graph that has
+		// outgoing edges.
+		#pragma omp for schedule(dynamic, 1024)
+		for (size_t v_idx = 0; v_idx < vertices.size(); v_idx++) {
+			const EdgeIdxRange<edge_idx_t> v_edge_indices = edge_indices(v_idx);
 
-			if (vertex_marks[w_idx] != INPLAY)
+			if (v_edge_indices.empty())
 				continue;
 
-			// The edge v -> w must be an irreducible edge if w is
-			// still marked INPLAY at this point, since all shorter
-			// edges were already considered.
-			//
-			// Now, consider the edges leaving vertex w.  Each such
-			// edge that goes to a vertex marked INPLAY must be
-			// directly reachable from v, and therefore the edge
-			// must be removed, unless its sequence does not
-			// actually match the sequence from the edges
-			// v -> w -> x.
-			const DirectedStringGraphVertex & w = vertices[w_idx];
-			foreach(const edge_idx_t w_edge_idx, w.edge_indices()) {
-				const DirectedStringGraphEdge & e2 = edges[w_edge_idx];
-				if (e.length() + e2.length() > longest)
-					break;
-
-				const v_idx_t x_idx = e2.get_v2_idx();
-				if (vertex_marks[x_idx] != INPLAY)
-					continue;
-
-				const edge_idx_t back_edge_idx =
-						v_idx_to_back_edge_idx[x_idx];
-
-				assert(back_edge_idx !=
+			// Mark each vertex adjacent to @v as INPLAY, and
+			// initialize the map from the adjacent vertices'
+			// indices to the back edges' indices.
+			foreach(const edge_idx_t edge_idx, v_edge_indices) {
+				const DirectedStringGraphEdge & e = edges[edge_idx];
+				const v_idx_t w_idx = e.get_v2_idx();
+				assert(edge_idx != std::numeric_limits<edge_idx_t>::max());
+				assert(v_idx_to_back_edge_idx[w_idx] ==
 				       std::numeric_limits<edge_idx_t>::max());
+				v_idx_to_back_edge_idx[w_idx] = edge_idx;
 
-				const DirectedStringGraphEdge & back_edge =
-					edges[back_edge_idx];
+				vertex_marks[w_idx] = INPLAY;
+			}
 
-				assert(back_edge.get_v1_idx() == v_idx);
-				assert(back_edge.get_v2_idx() == x_idx);
+			// Length of the longest sequence label on the edges
+			// leaving vertex @v.
+			const BaseVec::size_type longest = edges[v_edge_indices.back()].length();
 
+			// For each outgoing edge from v -> w in order of
+			// labeled sequence length, consider each vertex w that
+			// is still marked INPLAY.
+			foreach(const edge_idx_t edge_idx, v_edge_indices) {
+				const DirectedStringGraphEdge & e = edges[edge_idx];
+				const v_idx_t w_idx = e.get_v2_idx();
 
-				if (e.length() + e2.length() != back_edge.length())
+				if (vertex_marks[w_idx] != INPLAY)
 					continue;
 
-				for (BaseVec::size_type i = 0; i < e.length(); i++)
-					if (e.get_seq()[i] != back_edge.get_seq()[i])
-						goto next_edge;
-
-				for (BaseVec::size_type i = 0; i < e2.length(); i++)
-					if (e2.get_seq()[i] !=
-					    back_edge.get_seq()[i + e.length()])
-						goto next_edge;
-
-				vertex_marks[x_idx] = ELIMINATED;
-				next_edge:
-				;
+				// The edge v -> w must be an irreducible edge
+				// if w is still marked INPLAY at this point,
+				// since all shorter edges were already
+				// considered.
+				//
+				// Now, consider the edges leaving vertex w.
+				// Each such edge that goes to a vertex marked
+				// INPLAY must be directly reachable from v, and
+				// therefore the edge must be removed, unless
+				// its sequence does not actually match the
+				// sequence from the edges v -> w -> x.
+				foreach(const edge_idx_t w_edge_idx, edge_indices(w_idx)) {
+					const DirectedStringGraphEdge & e2 = edges[w_edge_idx];
+					if (e.length() + e2.length() > longest)
+						break;
+
+					const v_idx_t x_idx = e2.get_v2_idx();
+					if (vertex_marks[x_idx] != INPLAY)
+						continue;
+
+					const edge_idx_t back_edge_idx =
+							v_idx_to_back_edge_idx[x_idx];
+
+					assert(back_edge_idx !=
+					       std::numeric_limits<edge_idx_t>::max());
+
+					const DirectedStringGraphEdge & back_edge =
+						edges[back_edge_idx];
+
+					assert(back_edge.get_v1_idx() == v_idx);
+					assert(back_edge.get_v2_idx() == x_idx);
+
+
+					if (e.length() + e2.length() != back_edge.length())
+						continue;
+
+					if (EdgeLabel::hash_concat(label_hashes[edge_idx],
+								   label_hashes[w_edge_idx],
+								   hash_powers[e2.length()])
+					    != label_hashes[back_edge_idx])
+						continue;
+
+					if (back_edge.get_label().equals_concatenation(
+							e.get_label(), e2.get_label(), _reads))
+						vertex_marks[x_idx] = ELIMINATED;
+				}
 			}
-		}
 
-		// Once again, go through the outgoing edges from v.  For each
-		// neighboring vertex marked ELIMINATED, mark the corresponding
-		// edge(s) for reduction.  Return both INPLAY and ELIMINATED
-		// vertices to VACANT status.
-		foreach(const edge_idx_t edge_idx, v.edge_indices()) {
-			const DirectedStringGraphEdge & e = edges[edge_idx];
-			const v_idx_t w_idx = e.get_v2_idx();
-			if (vertex_marks[w_idx] == ELIMINATED)
-				reduce_edge[edge_idx] = true;
-			v_idx_to_back_edge_idx[w_idx] = std::numeric_limits<edge_idx_t>::max();
-			vertex_marks[w_idx] = VACANT;
+			// Once again, go through the outgoing edges from v.
+			// For each neighboring vertex marked ELIMINATED, mark
+			// the corresponding edge(s) for reduction.  Return both
+			// INPLAY and ELIMINATED vertices to VACANT status.
+			foreach(const edge_idx_t edge_idx, v_edge_indices) {
+				const DirectedStringGraphEdge & e = edges[edge_idx];
+				const v_idx_t w_idx = e.get_v2_idx();
+				if (vertex_marks[w_idx] == ELIMINATED)
+					reduce_edge[edge_idx] = 1;
+				v_idx_to_back_edge_idx[w_idx] = std::numeric_limits<edge_idx_t>::max();
+				vertex_marks[w_idx] = VACANT;
+			}
 		}
 	}
 
 	info("Transitive reduction algorithm complete.  Now updating the string graph");
 
+	// An edge and its twin should always be reduced together.  If only one
+	// of them was, keep both, so that every edge still has its twin.
+	size_t num_one_sided_pairs = 0;
 	for (size_t i = 0; i < edges.size(); i++) {
-		if (reduce_edge[i]) {
-			const DirectedStringGraphEdge & e = _edges[i];
-			const edge_idx_t j = locate_edge(e.get_v2_idx() ^ 1,
-							 e.get_v1_idx() ^ 1);
-			if (!reduce_edge[j]) {
-				std::cout << "The following 2 edges are opposites "
-					<< "but were not both reduced:" << std::endl;
-				e.print(std::cout, 0, true);
-				std::cout << std::endl;
-				_edges[j].print(std::cout, 0, true);
-				std::cout << std::endl;
-			}
+		if (reduce_edge[i] && !reduce_edge[_edges[i].get_twin_idx()]) {
+			reduce_edge[i] = 0;
+			num_one_sided_pairs++;
 		}
 	}
+	if (num_one_sided_pairs != 0)
+		info("Kept %zu pairs of twin edges of which only one was reduced",
+		     num_one_sided_pairs);
 
-	// Update the directed string graph to remove the edges marked %true in
-	// the @reduce_edge array.
-
-	// Map from the old edge indices to the new edge indices.
-	std::vector<edge_idx_t> new_edge_indices(edges.size());
-	size_t i, j;
-	for (i = 0, j = 0; i < edges.size(); i++) {
-		if (reduce_edge[i]) {
-			new_edge_indices[i] = std::numeric_limits<edge_idx_t>::max();
-		} else {
-			new_edge_indices[i] = j;
-			edges[j++] = edges[i];
-		}
-	}
+	// Update the directed string graph to remove the edges marked in the
+	// @reduce_edge array, and re-number the twins of the remaining edges.
 	const size_t num_original_edges = edges.size();
-	const size_t num_removed_edges = num_original_edges - j;
-	const size_t num_remaining_edges = j;
-	edges.resize(num_remaining_edges);
+	std::vector<edge_idx_t> new_edge_indices;
+	const size_t num_removed_edges = remove_edges(reduce_edge, new_edge_indices);
+	renumber_twins(new_edge_indices);
 
 	info("Removing %zu of %zu edges (%.2f%%)",
 	     num_removed_edges, num_original_edges,
 	     TO_PERCENT(num_removed_edges, num_original_edges));
 
-	// Re-number the edge indices list of each vertex, and remove any
-	// indices that correspond to edges that were removed.
-	foreach(DirectedStringGraphVertex & v, vertices) {
-		std::vector<edge_idx_t> & edge_indices = v.edge_indices();
-		size_t j = 0;
-		foreach(const edge_idx_t edge_idx, edge_indices) {
-			const edge_idx_t new_edge_idx = new_edge_indices[edge_idx];
-			if (new_edge_idx != std::numeric_limits<edge_idx_t>::max()) {
-				edge_indices[j++] = new_edge_idx;
-			}
-		}
-		edge_indices.resize(j);
-	}
-
-
 	info("Done removing transitive edges");
 }
 
-void DirectedStringGraph::follow_unbranched_path(DirectedStringGraphEdge & e,
-						 std::vector<bool> & remove_edge,
-						 std::vector<bool> & remove_vertex,
-						 const std::vector<bool> & v_inner)
+//
+// Collapse the unbranched path that begins with the edge with index @edge_idx
+// and passes through @num_inner_vertices inner vertices into that edge, whose
+// label becomes the concatenation of the labels of the path, @new_seq_len bases
+// in all.  The other edges of the path and its inner vertices are marked for
+// removal in @remove_edge and @remove_vertex.
+//
+// The path may be a smooth ring that begins and ends at the same vertex, in
+// which case the edge becomes a loop.
+//
+// Different paths share no edges or inner vertices, so paths may be collapsed
+// concurrently.
+//
+void DirectedStringGraph::follow_unbranched_path(const edge_idx_t edge_idx,
+						 const v_idx_t num_inner_vertices,
+						 const BaseVec::size_type new_seq_len,
+						 std::vector<unsigned char> & remove_edge,
+						 std::vector<unsigned char> & remove_vertex)
 {
-	BaseVecVec::size_type new_seq_len = e.length();
-	v_idx_t vi_idx = e.get_v2_idx();
-	assert(v_inner[vi_idx]);
-
-	v_idx_t num_inner_vertices = 0;
-	// Found beginning of unbranched path.  Walk along it until
-	// the end to get the total sequence length.
-	do {
-		const DirectedStringGraphVertex &vi = _vertices[vi_idx];
-		assert(vi.out_degree() == 1);
-		const DirectedStringGraphEdge &ei_i1 = _edges[vi.first_edge_idx()];
-		if (new_seq_len + ei_i1.length() < new_seq_len)
-			fatal_error("Edge too long");
-		new_seq_len += ei_i1.length();
-		num_inner_vertices++;
-		vi_idx = ei_i1.get_v2_idx();
-	} while (v_inner[vi_idx]);
+	DirectedStringGraphEdge & e = _edges[edge_idx];
+	BaseVec new_seq;
+	new_seq.reserve(new_seq_len);
+	e.get_label().append_to(_reads, new_seq);
 
-	// Now build the new sequence, update the first edge in the path to skip
-	// to the last vertex in the path, and mark the other edges for removal
-	// in the @remove_edge array.
-	BaseVec & new_seq = e.get_seq();
-	BaseVec::size_type seq_idx = new_seq.length();
-	new_seq.resize(new_seq_len);
-	vi_idx = e.get_v2_idx();
-
-	e.set_num_inner_vertices(num_inner_vertices);
-	while (num_inner_vertices--) {
-		const DirectedStringGraphVertex &vi = _vertices[vi_idx];
-		const edge_idx_t ei_i1_idx = vi.first_edge_idx();
+	v_idx_t vi_idx = e.get_v2_idx();
+	edge_idx_t last_edge_idx = edge_idx;
+	for (v_idx_t i = 0; i < num_inner_vertices; i++) {
+		assert(out_degree(vi_idx) == 1);
+		const edge_idx_t ei_i1_idx = first_edge_idx(vi_idx);
 		const DirectedStringGraphEdge &ei_i1 = _edges[ei_i1_idx];
-		const BaseVec & ei_i1_seq = ei_i1.get_seq();
-		for (BaseVec::size_type i = 0; i < ei_i1_seq.length(); i++) {
-			assert2(seq_idx < new_seq_len);
-			new_seq.set(seq_idx++, ei_i1_seq[i]);
-		}
+		last_edge_idx = ei_i1_idx;
+		ei_i1.get_label().append_to(_reads, new_seq);
 		e.increment_mapped_read_count(ei_i1.get_mapped_read_count());
-		remove_edge[ei_i1_idx] = true;
-		remove_vertex[vi_idx] = true;
+		remove_edge[ei_i1_idx] = 1;
+		remove_vertex[vi_idx] = 1;
 		vi_idx = ei_i1.get_v2_idx();
 	}
-	assert(!v_inner[vi_idx]);
-	assert(new_seq_len == seq_idx);
+	assert(new_seq.size() == new_seq_len);
+	e.get_label().set_seq(new_seq);
 	e.set_v2_idx(vi_idx);
+	e.set_num_inner_vertices(num_inner_vertices);
+
+	// The twin of the collapsed path is the path followed from the twin of
+	// its last edge, which is kept and will be (or was) collapsed the same
+	// way.
+	e.set_twin_idx(_edges[last_edge_idx].get_twin_idx());
 }
 
+//
+// Collapse the unbranched paths of a directed string graph.
+//
+// A vertex is inner iff it has indegree 1 and outdegree 1.  Each maximal path
+// through inner vertices that begins and ends at non-inner vertices is replaced
+// by a single edge labeled with the concatenation of the labels of the path.
+// A smooth ring--- a cycle of inner vertices only, as made by a circular
+// chromosome or plasmid with no branches--- is replaced by a single loop on one
+// of its vertices.
+//
+// The paths are found by pointer jumping (list ranking) over the inner
+// vertices, in parallel: each inner vertex v starts out pointing to the head of
+// its out-edge, and in each round it jumps to where that vertex points,
+// accumulating the number of edges and the label length jumped over and the
+// smallest vertex index seen.  After enough rounds, each inner vertex on a path
+// points to the end of the path, and each vertex on a smooth ring has seen the
+// whole ring.  The paths are then concatenated in parallel.
+//
 void DirectedStringGraph::collapse_unbranched_paths()
 {
 	const v_idx_t n_verts = num_vertices();
-	const edge_idx_t n_edges = num_edges();
+	const size_t n_edges = num_edges();
+	const v_idx_t NONE = std::numeric_limits<v_idx_t>::max();
 
 	info("Collapsing unbranched paths in directed string graph");
 	info("Original graph has %zu vertices and %zu edges", n_verts, n_edges);
 
+	// Find whether each vertex is inner or not.
+	std::vector<unsigned char> v_inner(n_verts, 0);
 	size_t num_inner_vertices = 0;
-	// Find whether each vertex is inner or not.  A vertex is inner iff it
-	// has indegree 1 and outdegree 1.
-	std::vector<bool> v_inner(n_verts, false);
 	{
-		std::vector<unsigned char> v_in_degrees(n_verts, 0);
-		std::vector<unsigned char> v_out_degrees(n_verts, 0);
-
-		foreach (const DirectedStringGraphEdge & e, _edges) {
-			v_idx_t v1_idx, v2_idx;
-			e.get_v_indices(v1_idx, v2_idx);
-			if (v_out_degrees[v1_idx] < 2)
-				v_out_degrees[v1_idx]++;
-			if (v_in_degrees[v2_idx] < 2)
-				v_in_degrees[v2_idx]++;
-		}
-		for (v_idx_t v_idx = 0; v_idx < n_verts; v_idx++) {
-			if (v_in_degrees[v_idx] == 1 && v_out_degrees[v_idx] == 1) {
-				v_inner[v_idx] = true;
+		std::vector<v_idx_t> v_in_degrees(n_verts, 0);
+		foreach (const DirectedStringGraphEdge & e, _edges)
+			v_in_degrees[e.get_v2_idx()]++;
+		#pragma omp parallel for schedule(static, 65536) \
+			reduction(+:num_inner_vertices)
+		for (size_t v_idx = 0; v_idx < n_verts; v_idx++) {
+			if (v_in_degrees[v_idx] == 1 && out_degree(v_idx) == 1) {
+				v_inner[v_idx] = 1;
 				num_inner_vertices++;
 			}
 		}
@@ -301,111 +305,469 @@ void DirectedStringGraph::collapse_unbranched_paths()
 	info("Found %zu inner vertices (%.2f%% of all vertices)",
 	     num_inner_vertices, TO_PERCENT(num_inner_vertices, n_verts));
 
-	// Go through each non-inner vertex and look for any neighboring inner
-	// vertices.  These are the starts of unbranched paths that will be
-	// collapsed.  For each such path, follow it until its end and determine
-	// the total length of the edges.  Then, set the first edge's label to
-	// the concatenation of the labels of all the edges in the unbranched
-	// path, then make the first edge point directly to the last vertex in
-	// the path and mark the other edges for deletion.
-	//
-	// Note: smooth rings are not collapsed yet.
-	//
-	size_t num_unbranched_paths = 0;
-	std::vector<bool> remove_edge(n_edges, false);
-	std::vector<bool> remove_vertex(n_verts, false);
-	for (v_idx_t v_idx = 0; v_idx < n_verts; v_idx++) {
-		if (!v_inner[v_idx]) {
-			const DirectedStringGraphVertex & v = _vertices[v_idx];
-			foreach(edge_idx_t edge_idx, v.edge_indices()) {
-				DirectedStringGraphEdge & e = _edges[edge_idx];
-				v_idx_t v2_idx = e.get_v2_idx();
-				if (v_inner[v2_idx] && !remove_vertex[v2_idx]) {
-					num_unbranched_paths++;
-					follow_unbranched_path(e, remove_edge,
-							       remove_vertex, v_inner);
+	// For each inner vertex: the vertex it currently points to, the number
+	// of edges and total label length between it and that vertex, and the
+	// smallest index of the vertices from it up to (but not including)
+	// that vertex.  Non-inner vertices point nowhere.
+	std::vector<v_idx_t> jump(n_verts, NONE);
+	std::vector<v_idx_t> dist(n_verts, 0);
+	std::vector<uint64_t> len(n_verts, 0);
+	std::vector<v_idx_t> min_v(n_verts, NONE);
+
+	#pragma omp parallel for schedule(static, 65536)
+	for (size_t v_idx = 0; v_idx < n_verts; v_idx++) {
+		if (v_inner[v_idx]) {
+			const DirectedStringGraphEdge & e =
+				_edges[first_edge_idx(v_idx)];
+			jump[v_idx] = e.get_v2_idx();
+			dist[v_idx] = 1;
+			len[v_idx] = e.length();
+			min_v[v_idx] = v_idx;
+		}
+	}
+
+	// Jump until every inner vertex points to a non-inner vertex, or until
+	// each has jumped over more vertices than there are inner vertices, in
+	// which case those still pointing to inner vertices are on smooth rings.
+	{
+		std::vector<v_idx_t> new_jump(n_verts);
+		std::vector<v_idx_t> new_dist(n_verts);
+		std::vector<uint64_t> new_len(n_verts);
+		std::vector<v_idx_t> new_min_v(n_verts);
+		size_t num_rounds = 0;
+		size_t num_active;
+		uint64_t max_jumped = 1;
+		do {
+			num_active = 0;
+			#pragma omp parallel for schedule(static, 65536) \
+				reduction(+:num_active)
+			for (size_t v_idx = 0; v_idx < n_verts; v_idx++) {
+				const v_idx_t w_idx = jump[v_idx];
+				if (w_idx != NONE && v_inner[w_idx]) {
+					new_jump[v_idx] = jump[w_idx];
+					new_dist[v_idx] = dist[v_idx] + dist[w_idx];
+					new_len[v_idx] = len[v_idx] + len[w_idx];
+					new_min_v[v_idx] = std::min(min_v[v_idx], min_v[w_idx]);
+					num_active++;
+				} else {
+					new_jump[v_idx] = jump[v_idx];
+					new_dist[v_idx] = dist[v_idx];
+					new_len[v_idx] = len[v_idx];
+					new_min_v[v_idx] = min_v[v_idx];
 				}
 			}
-		}
+			jump.swap(new_jump);
+			dist.swap(new_dist);
+			len.swap(new_len);
+			min_v.swap(new_min_v);
+			num_rounds++;
+			max_jumped *= 2;
+		} while (num_active != 0 && max_jumped <= num_inner_vertices);
+		info("Ranked unbranched paths in %zu rounds of pointer jumping",
+		     num_rounds);
 	}
 
-	for (v_idx_t v_idx = 0; v_idx < n_verts; v_idx++) {
-		if (v_inner[v_idx] && !remove_vertex[v_idx]) {
-			std::cerr << "Graph contains a smooth ring!" << std::endl;
-			unimplemented();
+	// Collapse each path that starts with an edge from a non-inner vertex
+	// to an inner vertex.  Each such edge starts a different path.
+	std::vector<unsigned char> remove_edge(n_edges, 0);
+	std::vector<unsigned char> remove_vertex(n_verts, 0);
+	size_t num_unbranched_paths = 0;
+	#pragma omp parallel for schedule(dynamic, 1024) \
+		reduction(+:num_unbranched_paths)
+	for (size_t v_idx = 0; v_idx < n_verts; v_idx++) {
+		if (v_inner[v_idx])
+			continue;
+		foreach (const edge_idx_t edge_idx, edge_indices(v_idx)) {
+			const v_idx_t w_idx = _edges[edge_idx].get_v2_idx();
+			if (!v_inner[w_idx])
+				continue;
+			assert(!v_inner[jump[w_idx]]);
+			const uint64_t new_seq_len = _edges[edge_idx].length() +
+						     len[w_idx];
+			if (new_seq_len > std::numeric_limits<BaseVec::size_type>::max())
+				fatal_error("Edge too long");
+			follow_unbranched_path(edge_idx, dist[w_idx], new_seq_len,
+					       remove_edge, remove_vertex);
+			num_unbranched_paths++;
 		}
 	}
-
 	info("Found %zu unbranched paths", num_unbranched_paths);
 
-	// Compute the new vertex indices.
-	std::vector<v_idx_t> old_to_new_v_indices(n_verts,
-						  std::numeric_limits<v_idx_t>::max());
-	v_idx_t new_v_idx = 0;
-	for (v_idx_t old_v_idx = 0; old_v_idx < n_verts; old_v_idx++)
-		if (!remove_vertex[old_v_idx])
-			old_to_new_v_indices[old_v_idx] = new_v_idx++;
-
-	info("Updated vertices are indexed [0, %lu)", new_v_idx);
-
-	info("Updating edges");
-	// Compute the new edge indices, set the new vertex indices in each edge,
-	// and move the edges
-	std::vector<edge_idx_t> old_to_new_edge_indices(n_edges,
-							std::numeric_limits<edge_idx_t>::max());
-	edge_idx_t new_edge_idx = 0;
-	for (edge_idx_t old_edge_idx = 0; old_edge_idx < n_edges; old_edge_idx++) {
-		if (!remove_edge[old_edge_idx]) {
-			DirectedStringGraphEdge & e = _edges[old_edge_idx];
-			old_to_new_edge_indices[old_edge_idx] = new_edge_idx;
-			v_idx_t v1_idx, v2_idx;
-			e.get_v_indices(v1_idx, v2_idx);
-			e.set_v_indices(old_to_new_v_indices[v1_idx],
-					old_to_new_v_indices[v2_idx]);
-			assert2(e.get_v1_idx() != std::numeric_limits<v_idx_t>::max() &&
-				e.get_v2_idx() != std::numeric_limits<v_idx_t>::max());
-			_edges[new_edge_idx++] = _edges[old_edge_idx];
+	// Collapse each smooth ring into a loop on its smallest vertex.  The
+	// twin of a ring is the ring through the twins of its vertices, whose
+	// smallest vertex is the twin of this ring's smallest vertex, so the
+	// loops are twins of each other.  A ring that is its own twin passes
+	// through both ends of a read and is left alone.
+	size_t num_smooth_rings = 0;
+	size_t num_self_twin_rings = 0;
+	#pragma omp parallel for schedule(dynamic, 1024) \
+		reduction(+:num_smooth_rings, num_self_twin_rings)
+	for (size_t v_idx = 0; v_idx < n_verts; v_idx++) {
+		if (!v_inner[v_idx] || !v_inner[jump[v_idx]] ||
+		    min_v[v_idx] != v_idx)
+			continue;
+		if (v_inner[v_idx ^ 1] && v_inner[jump[v_idx ^ 1]] &&
+		    min_v[v_idx ^ 1] == v_idx) {
+			num_self_twin_rings++;
+			continue;
+		}
+		const edge_idx_t edge_idx = first_edge_idx(v_idx);
+		v_idx_t ring_inner_vertices = 0;
+		uint64_t new_seq_len = _edges[edge_idx].length();
+		for (v_idx_t vi_idx = _edges[edge_idx].get_v2_idx();
+		     vi_idx != v_idx;
+		     vi_idx = _edges[first_edge_idx(vi_idx)].get_v2_idx())
+		{
+			ring_inner_vertices++;
+			new_seq_len += _edges[first_edge_idx(vi_idx)].length();
 		}
+		if (new_seq_len > std::numeric_limits<BaseVec::size_type>::max())
+			fatal_error("Edge too long");
+		follow_unbranched_path(edge_idx, ring_inner_vertices, new_seq_len,
+				       remove_edge, remove_vertex);
+		num_smooth_rings++;
 	}
-	info("Updated edges are indexed [0, %lu)", new_edge_idx);
+	info("Found %zu smooth rings", num_smooth_rings);
+	if (num_self_twin_rings != 0)
+		info("WARNING: Left %zu smooth rings that are their own twins "
+		     "uncollapsed", num_self_twin_rings);
+
+	// The labels of the collapsed paths were materialized as they were
+	// concatenated.  Materialize the remaining labels too, so that they no
+	// longer refer to the reads.  Only the reads of the remaining vertices
+	// are kept, as the first bases of the paths that start at them.
+	#pragma omp parallel for schedule(dynamic, 4096)
+	for (size_t edge_idx = 0; edge_idx < n_edges; edge_idx++)
+		if (!remove_edge[edge_idx])
+			_edges[edge_idx].get_label().materialize(_reads);
+
+	// Remove the edges and inner vertices of the collapsed paths, and the
+	// reads of the inner vertices.  This drops the adjacency lists' entries
+	// for the edges leaving the removed inner vertices.
+	info("Updating edges and vertices");
+	const size_t num_removed_edges = remove_edges_and_vertices(remove_edge,
+								   remove_vertex);
 	info("%zu edges were removed (%f%% of total)",
-	     _edges.size() - new_edge_idx,
-	     TO_PERCENT(_edges.size() - new_edge_idx, _edges.size()));
-
-	_edges.resize(new_edge_idx);
-
-	info("Updating vertices");
-	// Set new edge indices in each vertex and move the vertices
-	new_v_idx = 0;
-	for (v_idx_t old_v_idx = 0; old_v_idx < n_verts; old_v_idx++) {
-		if (!v_inner[old_v_idx]) {
-			DirectedStringGraphVertex & v = _vertices[old_v_idx];
-			std::vector<edge_idx_t> & edge_indices = v.edge_indices();
-			for (size_t i = 0; i < v.out_degree(); i++) {
-				edge_indices[i] = old_to_new_edge_indices[edge_indices[i]];
-				assert2(edge_indices[i] != std::numeric_limits<edge_idx_t>::max());
+	     num_removed_edges, TO_PERCENT(num_removed_edges, n_edges));
+	info("Updated graph has %zu vertices and %zu edges",
+	     num_vertices(), num_edges());
+	info("Done collapsing unbranched paths in directed string graph");
+}
+
+//
+// Remove the edges for which @remove_edge is nonzero, which must include the
+// twin of each of them, then the vertices for which @remove_vertex is nonzero,
+// which must have no edges left, along with their reads.  The twin indices,
+// vertex indices and read slices in the remaining edges are renumbered.
+// Returns the number of edges removed.
+//
+size_t DirectedStringGraph::remove_edges_and_vertices(const std::vector<unsigned char> & remove_edge,
+						      const std::vector<unsigned char> & remove_vertex)
+{
+	const v_idx_t n_verts = num_vertices();
+	const v_idx_t NONE = std::numeric_limits<v_idx_t>::max();
+
+	std::vector<v_idx_t> old_to_new_v_indices(n_verts);
+	const size_t new_n_verts =
+		parallel_compact_indices(n_verts,
+			[&](size_t i) { return !remove_vertex[i]; },
+			[&](size_t i, size_t new_idx) {
+				old_to_new_v_indices[i] =
+					(new_idx == ~size_t(0)) ? NONE : new_idx;
+			});
+
+	std::vector<edge_idx_t> old_to_new_edge_indices;
+	const size_t num_removed_edges = remove_edges(remove_edge,
+						      old_to_new_edge_indices);
+	renumber_twins(old_to_new_edge_indices);
+	#pragma omp parallel for schedule(static, 65536)
+	for (size_t i = 0; i < num_edges(); i++) {
+		DirectedStringGraphEdge & e = _edges[i];
+		e.set_v_indices(old_to_new_v_indices[e.get_v1_idx()],
+				old_to_new_v_indices[e.get_v2_idx()]);
+		assert2(e.get_v1_idx() != NONE && e.get_v2_idx() != NONE);
+	}
+
+	// Drop the reads of the removed vertices and renumber the others, and
+	// the read slices that refer to them, so that read r stays the read of
+	// vertices 2r and 2r + 1.  Any special vertices come after those of the
+	// reads and have none.
+	if (!_reads.empty()) {
+		assert(_reads.size() * 2 <= n_verts);
+		const std::vector<uint32_t> old_to_new_read_indices =
+			compact_reads([&](size_t i) {
+				assert2(remove_vertex[i * 2] ==
+					remove_vertex[i * 2 + 1]);
+				return !remove_vertex[i * 2];
+			});
+		#pragma omp parallel for schedule(static, 65536)
+		for (size_t i = 0; i < num_edges(); i++)
+			_edges[i].get_label().renumber_read(old_to_new_read_indices);
+	}
+
+	remove_vertices(remove_vertex);
+	assert(num_vertices() == new_n_verts);
+	return num_removed_edges;
+}
+
+//
+// Clip the tips of a directed string graph: remove each edge u -> v that leads
+// into a dead end--- v has no other edges--- from a vertex u with other edges
+// leaving it, if the edge's label is at most @max_tip_len bases long and at
+// most @max_tip_mapped_reads reads were mapped to it.  Such edges are mostly
+// made by sequencing errors near the ends of reads.  The twin of each tip,
+// which leads out of a dead end, is removed with it, and so are the two
+// vertices left isolated.
+//
+// If every edge leaving u is a tip, the one with the most mapped reads is kept,
+// so that clipping never makes a new dead end.  Tips at different vertices
+// share nothing, so the vertices are processed in parallel.
+//
+// Returns the number of tips clipped, counting each twin pair once.
+//
+size_t DirectedStringGraph::clip_tips(const BaseVec::size_type max_tip_len,
+				      const float max_tip_mapped_reads)
+{
+	const v_idx_t n_verts = num_vertices();
+	const size_t n_edges = num_edges();
+
+	info("Clipping tips of at most %u bases and %g mapped reads",
+	     max_tip_len, max_tip_mapped_reads);
+
+	std::vector<v_idx_t> v_in_degrees(n_verts, 0);
+	foreach (const DirectedStringGraphEdge & e, _edges)
+		v_in_degrees[e.get_v2_idx()]++;
+
+	auto is_tip = [&](const edge_idx_t edge_idx) {
+		const DirectedStringGraphEdge & e = _edges[edge_idx];
+		const v_idx_t v_idx = e.get_v2_idx();
+		return !e.is_special() &&
+		       (v_idx >> 1) != (e.get_v1_idx() >> 1) &&
+		       out_degree(v_idx) == 0 && v_in_degrees[v_idx] == 1 &&
+		       e.length() <= max_tip_len &&
+		       e.get_mapped_read_count() <= max_tip_mapped_reads;
+	};
+
+	std::vector<unsigned char> remove_edge(n_edges, 0);
+	std::vector<unsigned char> remove_vertex(n_verts, 0);
+	size_t num_tips = 0;
+	#pragma omp parallel for schedule(dynamic, 4096) reduction(+:num_tips)
+	for (size_t u_idx = 0; u_idx < n_verts; u_idx++) {
+		if (out_degree(u_idx) < 2)
+			continue;
+		edge_idx_t keep_idx = std::numeric_limits<edge_idx_t>::max();
+		foreach (const edge_idx_t edge_idx, edge_indices(u_idx)) {
+			if (!is_tip(edge_idx)) {
+				keep_idx = std::numeric_limits<edge_idx_t>::max();
+				break;
 			}
-			_vertices[new_v_idx++] = _vertices[old_v_idx];
+			if (keep_idx == std::numeric_limits<edge_idx_t>::max() ||
+			    _edges[edge_idx].get_mapped_read_count() >
+			    _edges[keep_idx].get_mapped_read_count())
+				keep_idx = edge_idx;
+		}
+		foreach (const edge_idx_t edge_idx, edge_indices(u_idx)) {
+			if (edge_idx == keep_idx || !is_tip(edge_idx))
+				continue;
+			const DirectedStringGraphEdge & e = _edges[edge_idx];
+			remove_edge[edge_idx] = 1;
+			remove_edge[e.get_twin_idx()] = 1;
+			remove_vertex[e.get_v2_idx()] = 1;
+			remove_vertex[e.get_v2_idx() ^ 1] = 1;
+			num_tips++;
 		}
 	}
-	assert(new_v_idx == n_verts - num_inner_vertices);
-	_vertices.resize(new_v_idx);
-	info("Done collapsing unbranched paths in directed string graph");
+
+	remove_edges_and_vertices(remove_edge, remove_vertex);
+	info("Clipped %zu tips", num_tips);
+	return num_tips;
 }
 
-void DirectedStringGraph::mark_component(const v_idx_t v_idx,
-					 std::vector<bool> & visited,
-					 v_idx_t & component_size) const
+// Return whether the sequences @a and @b are within @max_edits edits
+// (substitutions, insertions and deletions) of each other.  Only the band of
+// the dynamic programming matrix within @max_edits of its diagonal is filled.
+static bool within_edit_distance(const BaseVec & a, const BaseVec & b,
+				 const unsigned max_edits)
 {
-	assert(!visited[v_idx]);
-	visited[v_idx] = true;
-	component_size++;
-	foreach (edge_idx_t edge_idx, _vertices[v_idx].edge_indices()) {
-		const v_idx_t w_idx = _edges[edge_idx].get_v2_idx();
-		if (!visited[w_idx]) {
-			mark_component(w_idx, visited, component_size);
+	const size_t m = a.size();
+	const size_t n = b.size();
+	if ((m > n ? m - n : n - m) > max_edits)
+		return false;
+
+	const unsigned INF = max_edits + 1;
+	std::vector<unsigned> prev(n + 2, INF);
+	std::vector<unsigned> cur(n + 2, INF);
+	for (size_t j = 0; j <= std::min<size_t>(n, max_edits); j++)
+		prev[j] = j;
+	for (size_t i = 1; i <= m; i++) {
+		const size_t lo = (i > max_edits) ? i - max_edits : 0;
+		const size_t hi = std::min<size_t>(n, i + max_edits);
+		unsigned row_min = INF;
+		if (lo > 0)
+			cur[lo - 1] = INF;
+		for (size_t j = lo; j <= hi; j++) {
+			unsigned d = i;
+			if (j > 0) {
+				d = prev[j - 1] + (a[i - 1] != b[j - 1]);
+				d = std::min(d, prev[j] + 1);
+				d = std::min(d, cur[j - 1] + 1);
+			}
+			cur[j] = std::min(d, INF);
+			row_min = std::min(row_min, cur[j]);
 		}
+		cur[hi + 1] = INF;
+		if (row_min > max_edits)
+			return false;
+		prev.swap(cur);
 	}
+	return prev[n] <= max_edits;
+}
+
+// The rank of an edge when popping bubbles: edges with more mapped reads rank
+// higher, with ties broken by index.  An edge and its twin have the same rank.
+typedef std::pair<float, DirectedStringGraphEdge::edge_idx_t> bubble_rank;
+
+static bubble_rank get_bubble_rank(const DirectedStringGraph & graph,
+				   const DirectedStringGraphEdge::edge_idx_t edge_idx)
+{
+	const DirectedStringGraphEdge & e = graph.edges()[edge_idx];
+	const DirectedStringGraphEdge & e_X = graph.edges()[e.get_twin_idx()];
+	return bubble_rank(e.get_mapped_read_count() + e_X.get_mapped_read_count(),
+			   std::min(edge_idx, e.get_twin_idx()));
+}
+
+// Search for a path of at most @depth edges from the vertex @v_idx to
+// @target_idx whose edges all rank above @min_rank and whose sequence, appended
+// to @seq, is within @max_edits edits of @arm_seq.  @seq is restored before
+// returning.
+static bool find_bubble_path(const DirectedStringGraph & graph,
+			     const DirectedStringGraphEdge::v_idx_t v_idx,
+			     const DirectedStringGraphEdge::v_idx_t target_idx,
+			     const unsigned depth,
+			     const bubble_rank & min_rank,
+			     const BaseVec & arm_seq,
+			     const unsigned max_edits,
+			     BaseVec & seq)
+{
+	const BaseVec::size_type seq_len = seq.size();
+	foreach (const DirectedStringGraphEdge::edge_idx_t edge_idx,
+		 graph.edge_indices(v_idx))
+	{
+		const DirectedStringGraphEdge & e = graph.edges()[edge_idx];
+		if (e.is_special() ||
+		    seq_len + e.length() > arm_seq.size() + max_edits ||
+		    !(min_rank < get_bubble_rank(graph, edge_idx)))
+			continue;
+		e.get_label().append_to(graph.reads(), seq);
+		bool found;
+		if (e.get_v2_idx() == target_idx)
+			found = within_edit_distance(seq, arm_seq, max_edits);
+		else
+			found = depth > 1 &&
+				find_bubble_path(graph, e.get_v2_idx(), target_idx,
+						 depth - 1, min_rank, arm_seq,
+						 max_edits, seq);
+		seq.resize(seq_len);
+		if (found)
+			return true;
+	}
+	return false;
+}
+
+//
+// Pop the bubbles of a directed string graph: remove each edge u -> w whose
+// sequence is also spelled, with at most a few edits, by another path from u to
+// w of at most @max_depth edges.  Such pairs of paths are mostly made by
+// sequencing errors in the middle of reads.  Only edges at most
+// @max_bubble_len bases long are removed, and the two sequences must have an
+// identity of at least @min_identity: the edit distance between them may be
+// at most (1 - @min_identity) times the length of the edge.
+//
+// The edge is only removed if every edge of the other path ranks above it (see
+// get_bubble_rank()).  Then, by induction from the highest-ranked edges down, u
+// and w remain connected by the edges that are not removed, however many
+// bubbles are popped at once, so whether each edge is removed is decided from
+// the graph before popping, in parallel.  An edge and its twin are decided
+// together, since the twin of the other path is a path of the same ranks around
+// the twin.
+//
+// After collapse_unbranched_paths(), most bubbles are two parallel edges, but
+// searching deeper also pops bubbles whose other path branches, such as those
+// with a tip on the other path.
+//
+// Returns the number of bubbles popped, counting each twin pair once.
+//
+size_t DirectedStringGraph::pop_bubbles(const BaseVec::size_type max_bubble_len,
+					const unsigned max_depth,
+					const float min_identity)
+{
+	const size_t n_edges = num_edges();
+
+	info("Popping bubbles of at most %u bases and %u edges deep, "
+	     "with at least %g%% identity", max_bubble_len, max_depth,
+	     min_identity * 100);
+
+	std::vector<unsigned char> remove_edge(n_edges, 0);
+	std::vector<unsigned char> remove_vertex(num_vertices(), 0);
+	size_t num_bubbles = 0;
+	#pragma omp parallel reduction(+:num_bubbles)
+	{
+		BaseVec arm_seq;
+		BaseVec seq;
+		#pragma omp for schedule(dynamic, 1024)
+		for (size_t edge_idx = 0; edge_idx < n_edges; edge_idx++) {
+			const DirectedStringGraphEdge & e = _edges[edge_idx];
+			if (e.get_twin_idx() < edge_idx || e.is_special() ||
+			    e.length() > max_bubble_len ||
+			    e.get_v1_idx() == e.get_v2_idx() ||
+			    out_degree(e.get_v1_idx()) < 2)
+				continue;
+			const unsigned max_edits = (1 - min_identity) * e.length();
+			arm_seq.clear();
+			e.get_label().append_to(_reads, arm_seq);
+			seq.clear();
+			if (find_bubble_path(*this, e.get_v1_idx(), e.get_v2_idx(),
+					     max_depth,
+					     get_bubble_rank(*this, edge_idx),
+					     arm_seq, max_edits, seq))
+			{
+				remove_edge[edge_idx] = 1;
+				remove_edge[e.get_twin_idx()] = 1;
+				num_bubbles++;
+			}
+		}
+	}
+
+	remove_edges_and_vertices(remove_edge, remove_vertex);
+	info("Popped %zu bubbles", num_bubbles);
+	return num_bubbles;
+}
+
+//
+// Simplify a directed string graph by clipping tips and popping bubbles with
+// the parameters @params, then collapsing the unbranched paths that this
+// leaves.  Clipping a tip can expose another one behind it, and collapsing can
+// turn a bubble with a popped bubble inside it into a pair of parallel edges,
+// so this is repeated until a round changes nothing, or for at most
+// @params.max_rounds rounds.
+//
+void DirectedStringGraph::simplify(const simplify_params & params)
+{
+	info("Simplifying directed string graph with %zu vertices and %zu edges",
+	     num_vertices(), num_edges());
+	for (unsigned round = 1; round <= params.max_rounds; round++) {
+		info("Simplification round %u", round);
+		const size_t num_tips = clip_tips(params.max_tip_len,
+						  params.max_tip_mapped_reads);
+		const size_t num_bubbles = pop_bubbles(params.max_bubble_len,
+						       params.max_bubble_depth,
+						       params.min_bubble_identity);
+		if (num_tips == 0 && num_bubbles == 0)
+			break;
+		collapse_unbranched_paths();
+	}
+	info("Simplified graph has %zu vertices and %zu edges",
+	     num_vertices(), num_edges());
 }
 
 void DirectedStringGraph::print_stats(std::ostream & os) const
@@ -414,84 +776,30 @@ void DirectedStringGraph::print_stats(std::ostream & os) const
 	os << "    Number of vertices: " << num_vertices() << std::endl;
 	os << "    Number of edges: " << num_edges() << std::endl;
 
-	std::vector<unsigned char> out_degrees(num_vertices(), 0);
-	std::vector<unsigned char> in_degrees(num_vertices(), 0);
+	GraphStats stats(num_vertices());
 	double total_mapped_count = 0.0;
 	size_t more_than_one_mapped_count = 0;
-	foreach(const DirectedStringGraphEdge & e, _edges) {
-		if (out_degrees[e.get_v1_idx()] + 1 != 0) {
-			out_degrees[e.get_v1_idx()]++;
-		}
-		if (in_degrees[e.get_v2_idx()] + 1 != 0) {
-			in_degrees[e.get_v2_idx()]++;
-		}
+	#pragma omp parallel for \
+		reduction(+: total_mapped_count, more_than_one_mapped_count)
+	for (edge_idx_t edge_idx = 0; edge_idx < num_edges(); edge_idx++) {
+		const DirectedStringGraphEdge & e = _edges[edge_idx];
+		stats.count_out(e.get_v1_idx());
+		stats.count_in(e.get_v2_idx());
+		stats.add_edge(e.get_v1_idx(), e.get_v2_idx(), e.length());
 		assert(e.get_mapped_read_count() >= 1.0);
 		total_mapped_count += e.get_mapped_read_count();
 		if (e.get_mapped_read_count() > 1.0)
 			more_than_one_mapped_count++;
 	}
-	std::vector<v_idx_t> out_degree_hist(0xff, 0);
-	std::vector<v_idx_t> in_degree_hist(0xff, 0);
-	std::vector<v_idx_t> in_out_degree_hist(0xffff, 0);
-	v_idx_t v_in_neq_out = 0;
-	for (v_idx_t v_idx = 0; v_idx < num_vertices(); v_idx++) {
-		out_degree_hist[out_degrees[v_idx]]++;
-		in_degree_hist[in_degrees[v_idx]]++;
-		if (out_degrees[v_idx] != in_degrees[v_idx])
-			v_in_neq_out++;
-		in_out_degree_hist[(v_idx_t(in_degrees[v_idx]) << 8) + out_degrees[v_idx]]++;
-	}
-	v_idx_t max_out_degree = 0, max_in_degree = 0;
-	for (size_t i = 0; i < out_degree_hist.size(); i++)
-		if (out_degree_hist[i] != 0)
-			max_out_degree = i;
-	for (size_t i = 0; i < in_degree_hist.size(); i++)
-		if (in_degree_hist[i] != 0)
-			max_in_degree = i;
-	os << "    Number of isolated vertices: "
-	   << in_out_degree_hist[0x000] << std::endl;
-	os << "    Number of inner vertices: "
-	   << in_out_degree_hist[0x101] << std::endl;
-	os << "    Number of branch beginning vertices: "
-	   << in_out_degree_hist[0x001] << std::endl;
-	os << "    Number of branch ending vertices: "
-	   << in_out_degree_hist[0x100] << std::endl;
-	os << "    Number of vertices with unequal in degree and out degree: "
-	   << v_in_neq_out << std::endl;
-	os << "    Max in degree: " << max_in_degree
-	   << (max_in_degree == 0xff ? '+' : ' ') << std::endl;
-	os << "    Max out degree: " << max_out_degree
-	   << (max_in_degree == 0xff ? '+' : ' ') << std::endl;
+	stats.finish();
+	stats.print_degrees(os);
 
 	os << "    Number of edges that one or more contained reads map onto: "
 	   << more_than_one_mapped_count << std::endl;
 	os << "    Average number of contained reads that map onto each edge: "
 	   << (num_edges() ? total_mapped_count / num_edges() : 0) << std::endl;
 
-	std::vector<bool> visited(num_vertices(), false);
-	std::vector<v_idx_t> component_sizes;
-
-	for (v_idx_t v_idx = 0; v_idx < num_vertices(); v_idx++) {
-		if (!visited[v_idx] && in_degrees[v_idx] == 0) {
-			v_idx_t component_size = 0;
-			mark_component(v_idx, visited, component_size);
-			component_sizes.push_back(component_size);
-		}
-	}
-	for (v_idx_t v_idx = 0; v_idx < num_vertices(); v_idx++) {
-		if (!visited[v_idx]) {
-			v_idx_t component_size = 0;
-			mark_component(v_idx, visited, component_size);
-			component_sizes.push_back(component_size);
-		}
-	}
-	std::sort(component_sizes.begin(), component_sizes.end());
-	os << "    Number of components: " << component_sizes.size() << std::endl;
-	os << "    Component sizes:" << std::endl;
-	foreach (v_idx_t component_size, component_sizes) {
-		os << "        " << component_size << ' '
-		   << (component_size == 1 ? "vertex" : "vertices") << std::endl;
-	}
+	stats.print_components(os);
 	os << "}" << std::endl;
 }
 
@@ -520,115 +828,214 @@ void DirectedStringGraph::print_stats(std::ostream & os) const
 // backwards (e.g. towards the v?.? shown above) to find all possible edges into
 // which the f.E vertex would be located, so that the number of reads that map
 // onto those edges can be incremented.  Ideally, there would be only 1 such
-// edge--- but due to branching, there may be many.  At most 100 mapped edges
-// are considered before throwing away this contained read.
-//
-// @v_idx:
-// 	Next branchpoint vertex.  (initially: g.E for forward case; g.B for
-// 	reverse-complement case).
-//
-// @overhang_len:
-// 	Number of bp of uncontained read remaining after threading the contained
-// 	read all the way to the vertex of index @v_idx.
+// edge--- but due to branching, there may be many.  At most MAX_MAPPED_EDGES
+// mapped edges are considered before throwing away this contained read.
 //
-// @mapped_edges:
-// 	Array of indices of edges onto which the contained read would map.
+// Returns the edges onto which the end of the contained read maps, walking back
+// from the vertex @v_idx with @overhang_len bases of the uncontained read still
+// to be threaded back.  Initially, @v_idx is g.E for the forward case or g.B for
+// the reverse-complement case.
 //
-// @num_mapped_edges:
-// 	Number of filled members of @mapped_edges.
+// Results are memoized in @memo, keyed by (@v_idx, @overhang_len), so that ends
+// of contained reads with the same downstream vertex and overhang, and walks
+// that converge on the same vertex with the same remaining overhang, are only
+// computed once.  References into @memo remain valid as entries are added.
 //
-// @max_mapped_edges:
-// 	Size of max_mapped_edges.  The search is terminated when
-// 	@num_mapped_edges reaches @max_mapped_edges.
-//
-void DirectedStringGraph::walk_back_edges(const v_idx_t v_idx,
-					  size_t overhang_len,
-					  edge_idx_t mapped_edges[],
-					  size_t & num_mapped_edges,
-					  size_t max_mapped_edges)
+const DirectedStringGraph::back_walk_result &
+DirectedStringGraph::walk_back_edges(const v_idx_t v_idx,
+				     const BaseVec::size_type overhang_len,
+				     back_walk_memo & memo) const
 {
-	assert(_back_edges.size() == _vertices.size());
+	const uint64_t key = (uint64_t(v_idx) << 32) | overhang_len;
+	back_walk_memo::const_iterator it = memo.find(key);
+	if (it != memo.end())
+		return it->second;
+
+	const edge_idx_t begin = _back_edge_offsets[v_idx];
+	const edge_idx_t end = _back_edge_offsets[v_idx + 1];
+	back_walk_result res;
+	res.overflowed = false;
 
 	// Map the read onto any edges that go into the current vertex with
-	// length less than the remaining read length.
-	foreach (edge_idx_t edge_idx, _back_edges[v_idx]) {
-		const DirectedStringGraphEdge & e = _edges[edge_idx];
-		assert(e.get_v2_idx() == v_idx);
+	// length greater than the remaining read length.
+	for (edge_idx_t i = begin; i < end && !res.overflowed; i++) {
+		const DirectedStringGraphEdge & e = _edges[_back_edges[i]];
+		assert2(e.get_v2_idx() == v_idx);
 		if (overhang_len < e.length()) {
-			mapped_edges[num_mapped_edges++] = edge_idx;
-			if (num_mapped_edges == max_mapped_edges)
-				return;
+			res.edges.push_back(_back_edges[i]);
+			if (res.edges.size() == MAX_MAPPED_EDGES)
+				res.overflowed = true;
 		}
 	}
 
-	// For each edge going into the current vertex with length greater than
-	// or equal to the remaining read length, recursively call this
-	// procedure on them with the remaining read length decremented by the
-	// legnth of the edge.
-	//
-	// If upon return of the recursive call, the number of mapped edges has
-	// reached the maximum, return early.
-	foreach (edge_idx_t edge_idx, _back_edges[v_idx]) {
-		const DirectedStringGraphEdge & e = _edges[edge_idx];
+	// For each edge going into the current vertex with length less than or
+	// equal to the remaining read length, continue the walk from the tail
+	// of the edge with the remaining read length decremented by the length
+	// of the edge.
+	for (edge_idx_t i = begin; i < end && !res.overflowed; i++) {
+		const DirectedStringGraphEdge & e = _edges[_back_edges[i]];
 		if (overhang_len >= e.length()) {
-			walk_back_edges(e.get_v1_idx(),
-					overhang_len - e.length(),
-					mapped_edges,
-					num_mapped_edges,
-					max_mapped_edges);
-			if (num_mapped_edges == max_mapped_edges)
-				return;
+			const back_walk_result & sub =
+				walk_back_edges(e.get_v1_idx(),
+						overhang_len - e.length(), memo);
+			if (sub.overflowed ||
+			    res.edges.size() + sub.edges.size() >= MAX_MAPPED_EDGES)
+				res.overflowed = true;
+			else
+				res.edges.insert(res.edges.end(),
+						 sub.edges.begin(), sub.edges.end());
 		}
 	}
+	if (res.overflowed)
+		std::vector<edge_idx_t>().swap(res.edges);
+	return memo.emplace(key, std::move(res)).first->second;
+}
+
+// Index the edges entering each vertex, so that it's possible to walk the graph
+// in the opposite direction that the edges are going.
+void DirectedStringGraph::index_back_edges()
+{
+	info("Indexing back edges (num_vertices = %zu, num_edges = %zu)",
+	     num_vertices(), num_edges());
+	_back_edge_offsets.assign(num_vertices() + 1, 0);
+	foreach (const DirectedStringGraphEdge & e, _edges)
+		_back_edge_offsets[e.get_v2_idx() + 1]++;
+	for (v_idx_t v_idx = 0; v_idx < num_vertices(); v_idx++)
+		_back_edge_offsets[v_idx + 1] += _back_edge_offsets[v_idx];
+
+	// Fill in the edges in order of their tail vertices, which is the order
+	// the edges were visited in before.
+	std::vector<edge_idx_t> next(_back_edge_offsets.begin(),
+				     _back_edge_offsets.end() - 1);
+	_back_edges.resize(num_edges());
+	for (v_idx_t v_idx = 0; v_idx < num_vertices(); v_idx++)
+		foreach (const edge_idx_t edge_idx, edge_indices(v_idx))
+			_back_edges[next[_edges[edge_idx].get_v2_idx()]++] = edge_idx;
 }
 
 //
+// Map the ends of contained reads, @ends, into the graph by incrementing the
+// mapped read count of each edge onto which each end maps.  An end that maps
+// onto n edges adds 1/n to each of them; an end that maps onto no edges, or
+// onto MAX_MAPPED_EDGES or more edges, is thrown away.
+//
+// The ends are sorted and grouped by downstream vertex and overhang length, so
+// that each distinct walk is done once.  Groups are mapped in parallel, each
+// thread with its own memo of walk results; because groups with the same
+// downstream vertex are adjacent, most walks a thread repeats hit its memo.
 //
-void DirectedStringGraph::map_contained_read(const v_idx_t downstream_read_idx,
-					     const v_idx_t downstream_read_dir,
-					     const BaseVec::size_type overhang_len)
+void DirectedStringGraph::map_contained_reads(const std::vector<ContainedReadEnd> & ends)
 {
-	assert(downstream_read_idx < num_vertices() / 2);
-	assert(downstream_read_dir < 2);
-
-	const v_idx_t downstream_v_idx = downstream_read_idx * 2 + downstream_read_dir;
-
-	// We need to be able to walk the graph in the opposite direction that
-	// the edges are going--- so index the back edges, so that it's possible
-	// to get a list of edges entering a vertex, given the vertex index.
-	if (_back_edges.size() == 0) {
-		info("Indexing back edges (num_vertices = %zu, num_edges = %zu)",
-				num_vertices(), num_edges());
-		_back_edges.resize(num_vertices());
-		foreach (const DirectedStringGraphVertex & v, _vertices)
-			foreach (const edge_idx_t edge_idx, v.edge_indices())
-				_back_edges[_edges[edge_idx].get_v2_idx()].push_back(edge_idx);
+	// The key of each end, with its weight.
+	std::vector<std::pair<uint64_t, float> > keys(ends.size());
+	for (size_t i = 0; i < ends.size(); i++) {
+		const ContainedReadEnd & end = ends[i];
+		assert(end.downstream_read_idx < num_vertices() / 2);
+		assert(end.downstream_read_dir < 2);
+		const v_idx_t v_idx = end.downstream_read_idx * 2 +
+				      end.downstream_read_dir;
+		keys[i] = std::make_pair((uint64_t(v_idx) << 32) | end.overhang_len,
+					 end.weight);
 	}
+	std::sort(keys.begin(), keys.end());
 
-	// Walk the tree backwards starting at vertex @downstream_v_idx to get a
-	// list of edge indices into which the end of the contained read maps.
-	edge_idx_t mapped_edges[100];
-	size_t num_mapped_edges = 0;
-	walk_back_edges(downstream_v_idx, overhang_len,
-			mapped_edges, num_mapped_edges, 100);
-
-	// If there was at least one mapped edge but the maximum was not
-	// reached, increment the mapped read count on the corresponding edges,
-	// but divide by the number of mapped locations to weight the mapping
-	// appropriately.
-	if (num_mapped_edges < 100 && num_mapped_edges > 0) {
-		double div = 1.0f / double(num_mapped_edges);
-		for (size_t i = 0; i < num_mapped_edges; i++) {
-			assert(mapped_edges[i] < num_edges());
-			_edges[mapped_edges[i]].increment_mapped_read_count(div);
+	// Start of each group of identical keys, plus a sentinel.
+	std::vector<size_t> group_starts;
+	for (size_t i = 0; i < keys.size(); i++)
+		if (i == 0 || keys[i].first != keys[i - 1].first)
+			group_starts.push_back(i);
+	group_starts.push_back(keys.size());
+	const size_t num_groups = group_starts.size() - 1;
+
+	info("Mapping %zu ends of contained reads (%zu distinct) into the graph",
+	     ends.size(), num_groups);
+
+	index_back_edges();
+
+	// Amount to add to the mapped read count of each edge.
+	std::vector<double> mapped_read_counts(num_edges(), 0.0);
+
+	size_t num_mapped = 0;
+	size_t num_unmapped = 0;
+	size_t num_ambiguous = 0;
+
+	#pragma omp parallel reduction(+:num_mapped, num_unmapped, num_ambiguous)
+	{
+		back_walk_memo memo;
+
+		#pragma omp for schedule(dynamic, 256)
+		for (size_t g = 0; g < num_groups; g++) {
+			const uint64_t key = keys[group_starts[g]].first;
+			const size_t count = group_starts[g + 1] - group_starts[g];
+			double group_weight = 0;
+			for (size_t i = group_starts[g]; i < group_starts[g + 1]; i++)
+				group_weight += keys[i].second;
+
+			// Keep the memo from growing without bound.  It is only
+			// safe to clear between walks.
+			if (memo.size() > (1 << 20))
+				memo.clear();
+
+			const back_walk_result & res =
+				walk_back_edges(v_idx_t(key >> 32),
+						BaseVec::size_type(key), memo);
+			if (res.overflowed) {
+				num_ambiguous += count;
+			} else if (res.edges.size() == 0) {
+				num_unmapped += count;
+			} else {
+				// Split the weight of the ends evenly among
+				// the mapped locations.
+				const double weight = group_weight /
+						      double(res.edges.size());
+				foreach (const edge_idx_t edge_idx, res.edges) {
+					assert2(edge_idx < num_edges());
+					atomic_add(&mapped_read_counts[edge_idx],
+						   weight);
+				}
+				num_mapped += count;
+			}
 		}
 	}
+
+	for (edge_idx_t edge_idx = 0; edge_idx < num_edges(); edge_idx++)
+		if (mapped_read_counts[edge_idx] != 0.0)
+			_edges[edge_idx].increment_mapped_read_count(
+						mapped_read_counts[edge_idx]);
+
+	std::vector<edge_idx_t>().swap(_back_edge_offsets);
+	std::vector<edge_idx_t>().swap(_back_edges);
+
+	info("Mapped %zu ends; %zu mapped nowhere, %zu mapped ambiguously",
+	     num_mapped, num_unmapped, num_ambiguous);
 }
 
 //
 // Given a bidirected string graph, build the corresponding directed string
 // graph.
 //
+//
+// Weight the reads of a directed string graph whose reads have not been
+// collapsed, where @read_weights[i] is the number of original reads that read i
+// stands for, as written by normalize-reads.  Each edge counts the read at its
+// head as mapped to it, so its mapped read count becomes that read's weight,
+// and the number of reads used by calculate_A_statistics() becomes the total
+// weight.
+//
+void DirectedStringGraph::set_read_weights(const std::vector<float> & read_weights)
+{
+	assert(read_weights.size() * 2 == num_vertices());
+	#pragma omp parallel for schedule(static, 65536)
+	for (size_t i = 0; i < num_edges(); i++) {
+		DirectedStringGraphEdge & e = _edges[i];
+		e.set_mapped_read_count(read_weights[e.get_v2_idx() / 2]);
+	}
+	double total_weight = 0;
+	foreach (const float w, read_weights)
+		total_weight += w;
+	_orig_num_reads = llround(total_weight);
+}
+
 void DirectedStringGraph::build_from_bidigraph(const BidirectedStringGraph & bidigraph)
 {
 	assert(num_vertices() == bidigraph.num_vertices() * 2);
@@ -639,9 +1046,11 @@ void DirectedStringGraph::build_from_bidigraph(const BidirectedStringGraph & bid
 		add_edge_pair(e.get_v1_idx(),
 			      e.get_v2_idx(),
 			      e.get_dirs(),
-			      e.get_seq_1_to_2(), 0, e.length() - 1, false,
-			      e.get_seq_2_to_1(), 0, e.length() - 1, false);
+			      e.get_label_1_to_2(),
+			      e.get_label_2_to_1());
 	}
+	rebuild_adjacency();
+	copy_reads(bidigraph);
 	_orig_num_reads = bidigraph._orig_num_reads;
 }
 
@@ -704,14 +1113,21 @@ void DirectedStringGraph::calculate_A_statistics()
 	}
 }
 
-void DirectedStringGraph::min_cost_circulation()
+//
+// Solve a minimum-cost circulation problem on this directed string graph,
+// setting the traversal count of each edge.
+//
+// Two special vertices are added, with edges to and from them from every
+// other vertex.  The problem is then solved separately, and in parallel, on
+// each weakly connected component of the graph without the special vertices;
+// see component_min_cost_circulation().
+//
+void DirectedStringGraph::min_cost_circulation(const circulation_solver solver)
 {
-	static const int INFINITE_FLOW = 1000000;
-	static const int HUGE_COST = 1000000;
-	static const float SINGLE_COPY_THRESHOLD = 17.0;
-
 	info("Adding special vertex and edges");
 	v_idx_t n_verts = num_vertices();
+	const edge_idx_t first_special_edge_idx = num_edges();
+	assert(n_verts % 2 == 0);
 	_vertices.resize(n_verts + 2);
 	_vertices[n_verts].set_special();
 	_vertices[n_verts + 1].set_special();
@@ -732,26 +1148,79 @@ void DirectedStringGraph::min_cost_circulation()
 		}
 	}
 
-	n_verts += 2;
-	edge_idx_t n_edges = num_edges();
-
-	info("Creating lemon::SmartDigraph with %zu nodes and %zu arcs "
-	     "and initializing network flow parameters",
-	     n_verts, n_edges);
-	lemon::SmartDigraph G;
-	G.reserveNode(n_verts);
-	G.reserveArc(n_edges);
-	lemon::SmartDigraph::ArcMap<int> lower_map(G);
-	lemon::SmartDigraph::ArcMap<int> upper_map(G);
-	lemon::SmartDigraph::ArcMap<int> cost_map(G);
-	lemon::SmartDigraph::NodeMap<int> supply_map(G);
-	for (v_idx_t i = 0; i < n_verts; i++) {
-		supply_map[G.addNode()] = 0;
+	// The edges v -> s and s -> v to and from special vertex s were added
+	// at indices 4 * v + 2 * (s - n_verts) and one more than that, relative
+	// to the first special edge.  The twin of v -> s is (s ^ 1) -> (v ^ 1).
+	for (v_idx_t v_idx = 0; v_idx < n_verts; v_idx++) {
+		for (v_idx_t k = 0; k < 2; k++) {
+			const edge_idx_t to_special_idx =
+				first_special_edge_idx + 4 * v_idx + 2 * k;
+			const edge_idx_t twin_idx =
+				first_special_edge_idx + 4 * (v_idx ^ 1) + 2 * (k ^ 1) + 1;
+			assert2(_edges[twin_idx].get_v1_idx() == ((n_verts + k) ^ 1));
+			assert2(_edges[twin_idx].get_v2_idx() == (v_idx ^ 1));
+			set_twins(to_special_idx, twin_idx);
+		}
 	}
-	foreach (DirectedStringGraphEdge & e, _edges) {
-		lemon::SmartDigraph::Node node1 = G.nodeFromId(e.get_v1_idx());
-		lemon::SmartDigraph::Node node2 = G.nodeFromId(e.get_v2_idx());
-		lemon::SmartDigraph::Arc arc = G.addArc(node1, node2);
+
+	index_new_edges(first_special_edge_idx);
+
+	info("Finding weakly connected components");
+	component_index ci;
+	index_components(ci);
+	const size_t n_comps = ci.num_components();
+
+	// Network simplex takes superlinear time, so solving the components
+	// separately is faster even on one thread.  The largest components are
+	// started first so that they don't hold up the end of the loop.
+	std::vector<size_t> order(n_comps);
+	for (size_t c = 0; c < n_comps; c++)
+		order[c] = c;
+	std::stable_sort(order.begin(), order.end(),
+			 [&](size_t c1, size_t c2) {
+				 return ci.edge_indices(c1).size() >
+					ci.edge_indices(c2).size();
+			 });
+
+	info("Solving min-cost circulation on %zu components", n_comps);
+	int64_t total_cost = 0;
+	#pragma omp parallel for schedule(dynamic, 1) reduction(+: total_cost)
+	for (size_t i = 0; i < n_comps; i++)
+		total_cost += component_min_cost_circulation(ci, order[i], n_verts,
+							     solver);
+	info("Done (total cost: %lld)", (long long)total_cost);
+}
+
+// Solve the min-cost circulation problem on the component @c of @ci, setting
+// the traversal counts of its edges, and return the cost of the solution.
+//
+// The network has a node for each vertex of the component and a local copy of
+// each of the two special vertices, whose indices are @first_special_v_idx and
+// one more than that.  No flow can pass from one component to another through
+// the special vertices in a circulation of the whole graph without coming back
+// the same way, so solving the components separately gives a solution to the
+// whole problem.
+int64_t DirectedStringGraph::component_min_cost_circulation(const component_index & ci,
+							     const size_t c,
+							     const v_idx_t first_special_v_idx,
+							     const circulation_solver solver)
+{
+	static const int INFINITE_FLOW = 1000000;
+	static const int HUGE_COST = 1000000;
+	static const float SINGLE_COPY_THRESHOLD = 17.0;
+
+	const v_idx_t n_local_verts = ci.num_vertices(c);
+	const EdgeIdxRange<const edge_idx_t> comp_edges = ci.edge_indices(c);
+	CirculationNetwork network(n_local_verts + 2, comp_edges.size());
+
+	auto node = [&](const v_idx_t v_idx) {
+		if (v_idx >= first_special_v_idx)
+			return n_local_verts + (v_idx - first_special_v_idx);
+		else
+			return ci.local_v_indices[v_idx];
+	};
+	foreach (const edge_idx_t edge_idx, comp_edges) {
+		const DirectedStringGraphEdge & e = _edges[edge_idx];
 		int flow_lower_bound;
 		int flow_upper_bound;
 		int cost_per_unit_flow;
@@ -772,30 +1241,13 @@ void DirectedStringGraph::min_cost_circulation()
 			}
 			cost_per_unit_flow = 1;
 		}
-		lower_map[arc] = flow_lower_bound;
-		upper_map[arc] = flow_upper_bound;
-		cost_map[arc] = cost_per_unit_flow;
-	}
-	info("Initializing lemon::NetworkSimplex<lemon::SmartDigraph>");
-
-	typedef lemon::NetworkSimplex<lemon::SmartDigraph> simplex_t;
-	simplex_t simplex(G);
-	simplex.lowerMap(lower_map);
-	simplex.upperMap(upper_map);
-	simplex.supplyMap(supply_map);
-	simplex.costMap(cost_map);
-	info("Running network simplex algorithm");
-	simplex_t::ProblemType res = simplex.run();
-	if (res == simplex_t::INFEASIBLE) {
-		fatal_error("No feasible solution to min-cost circulation");
-	} else if (res == simplex_t::UNBOUNDED) {
-		fatal_error("Objective function unbounded");
+		network.add_arc(node(e.get_v1_idx()), node(e.get_v2_idx()),
+				flow_lower_bound, flow_upper_bound,
+				cost_per_unit_flow);
 	}
-	info("Extracting network flow solution (total cost: %zu)",
-	     simplex.totalCost());
-	for (edge_idx_t edge_idx = 0; edge_idx < n_edges; edge_idx++) {
-		lemon::SmartDigraph::Arc arc = G.arcFromId(edge_idx);
-		_edges[edge_idx].set_traversal_count(simplex.flow(arc));
-	}
-	info("Done");
+
+	const int64_t cost = network.solve(solver);
+	for (size_t i = 0; i < comp_edges.size(); i++)
+		_edges[comp_edges[i]].set_traversal_count(network.flow(i));
+	return cost;
 }
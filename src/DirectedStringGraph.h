@@ -2,6 +2,8 @@
 
 #include "StringGraph.h"
 #include "BaseVec.h"
+#include "Circulation.h"
+#include "EdgeLabel.h"
 #include <ostream>
 #include <inttypes.h>
 #include <boost/serialization/base_object.hpp>
@@ -18,11 +20,6 @@ private:
 		ar & boost::serialization::base_object<StringGraphVertex>(*this);
 	}
 public:
-	size_t out_degree() const
-	{
-		return _edge_indices.size();
-	}
-
 	// Print a directed string graph vertex in DOT format.
 	void print_dot(std::ostream & os, size_t v_idx) const
 	{
@@ -39,10 +36,16 @@ public:
 class DirectedStringGraphEdge : public StringGraphEdge {
 public:
 	typedef unsigned int v_idx_t;
+	typedef StringGraphVertex::edge_idx_t edge_idx_t;
 private:
-	v_idx_t  _v1_idx;
-	v_idx_t  _v2_idx;
-	BaseVec  _seq;
+	v_idx_t   _v1_idx;
+	v_idx_t   _v2_idx;
+
+	// Index of the twin of this edge: the edge that is the reverse
+	// complement of this one, going from (v2 ^ 1) to (v1 ^ 1).
+	edge_idx_t _twin_idx;
+
+	EdgeLabel _label;
 
 	// Serialize or deserialize the directed string graph edge to/from a
 	// stream.
@@ -53,17 +56,26 @@ private:
 		ar & boost::serialization::base_object<StringGraphEdge>(*this);
 		ar & _v1_idx;
 		ar & _v2_idx;
-		ar & _seq;
+		ar & _twin_idx;
+		ar & _label;
 	}
 public:
-	// Return a reference to the sequence associated with this edge of the
+	// Return a reference to the sequence label of this edge of the
 	// directed string graph.
-	BaseVec & get_seq() { return _seq; }
-	const BaseVec & get_seq() const { return _seq; }
+	EdgeLabel & get_label() { return _label; }
+	const EdgeLabel & get_label() const { return _label; }
 
 	// Return the length of the sequence associated with this edge of the
 	// directed string graph.
-	BaseVec::size_type length() const { return _seq.size(); }
+	BaseVec::size_type length() const { return _label.length(); }
+
+	// Return the length of this edge when traversed away from the vertex
+	// @v_idx, which can only be its tail.
+	BaseVec::size_type length_from(const v_idx_t v_idx) const
+	{
+		assert2(v_idx == _v1_idx);
+		return length();
+	}
 
 	// Return the index of the vertex at the tail of this edge in the
 	// directed string graph.
@@ -89,13 +101,29 @@ public:
 		_v2_idx = v2_idx;
 	}
 
+	// Get the indices of the vertices in whose adjacency lists this edge
+	// appears, and return how many there are.  A directed edge appears only
+	// in the list of the vertex at its tail.
+	unsigned get_adj_v_indices(v_idx_t v_indices[2]) const
+	{
+		v_indices[0] = _v1_idx;
+		return 1;
+	}
+
 	void set_v1_idx(const v_idx_t v1_idx) { _v1_idx = v1_idx; }
 
 	void set_v2_idx(const v_idx_t v2_idx) { _v2_idx = v2_idx; }
 
-	// Print this directed string graph edge.
+	// Return the index of the reverse-complement twin of this edge.
+	edge_idx_t get_twin_idx() const { return _twin_idx; }
+
+	void set_twin_idx(const edge_idx_t twin_idx) { _twin_idx = twin_idx; }
+
+	// Print this directed string graph edge.  @reads is the read store of
+	// the graph, used to print sequence labels that refer to it.
 	void print(std::ostream & os = std::cout, const v_idx_t v_idx = 0,
-		   const bool print_seqs = true) const
+		   const bool print_seqs = true,
+		   const BaseVecVec * reads = NULL) const
 	{
 		const v_idx_t read_1_idx = get_v1_idx() / 2 + 1;
 		const v_idx_t read_2_idx = get_v2_idx() / 2 + 1;
@@ -108,9 +136,9 @@ public:
 		   << '\t';
 		StringGraphEdge::print(os);
 		if (print_seqs)
-			os << _seq;
+			_label.print(os, reads);
 		else
-			os << _seq.length();
+			os << length();
 	}
 
 	friend std::ostream & operator<<(std::ostream & os,
@@ -122,15 +150,16 @@ public:
 
 	// Print this directed string graph edge in DOT format.
 	void print_dot(std::ostream & os, const v_idx_t v_idx,
-		       const bool print_seqs) const
+		       const bool print_seqs,
+		       const BaseVecVec * reads = NULL) const
 	{
 		os << "\tv" << get_v1_idx() << " -> "
 		   << "v" << get_v2_idx()
 		   << " [ label=\"";
 		if (print_seqs)
-			os << _seq;
+			_label.print(os, reads);
 		else
-			os << _seq.length();
+			os << length();
 		os << "\" ";
 		if (_traversal_count != 0) {
 			os << "color=red ";
@@ -139,29 +168,63 @@ public:
 	}
 };
 
+// Parameters of DirectedStringGraph::simplify().  See clip_tips() and
+// pop_bubbles() for what each one means.
+struct simplify_params {
+	BaseVec::size_type max_tip_len;
+	float max_tip_mapped_reads;
+	BaseVec::size_type max_bubble_len;
+	unsigned max_bubble_depth;
+	float min_bubble_identity;
+	unsigned max_rounds;
+
+	simplify_params()
+		: max_tip_len(100), max_tip_mapped_reads(3),
+		  max_bubble_len(200), max_bubble_depth(3),
+		  min_bubble_identity(0.9), max_rounds(5)
+	{ }
+};
+
 // A directed string graph.
 class DirectedStringGraph : public StringGraph<DirectedStringGraphVertex,
 					       DirectedStringGraphEdge,
 					       DirectedStringGraph>
 {
 private:
-	std::vector<std::vector<edge_idx_t> > _back_edges;
-
-	// Add an edge to this directed string graph.
-	void add_edge(const v_idx_t v1_idx,
-		      const v_idx_t v2_idx,
-		      const BaseVec & bv,
-		      const BaseVec::size_type beg,
-		      const BaseVec::size_type end,
-		      const bool rc)
+	// Add an edge to this directed string graph and return its index.
+	edge_idx_t add_edge(const v_idx_t v1_idx,
+			    const v_idx_t v2_idx,
+			    const EdgeLabel & label)
 	{
 		DirectedStringGraphEdge e;
 
 		e.set_v_indices(v1_idx, v2_idx);
-		bv.extract_seq(beg, end, rc, e.get_seq());
+		e.get_label() = label;
 
-		edge_idx_t edge_idx = this->push_back_edge(e);
-		_vertices[v1_idx].add_edge_idx(edge_idx);
+		return this->push_back_edge(e);
+	}
+
+	// Make the edges with indices @edge_idx_1 and @edge_idx_2 each other's
+	// twins.
+	void set_twins(const edge_idx_t edge_idx_1, const edge_idx_t edge_idx_2)
+	{
+		_edges[edge_idx_1].set_twin_idx(edge_idx_2);
+		_edges[edge_idx_2].set_twin_idx(edge_idx_1);
+	}
+
+	// After the edges have been compacted, renumber the twin indices of the
+	// remaining edges according to @old_to_new_edge_indices.  The twin of
+	// every remaining edge must also remain.
+	void renumber_twins(const std::vector<edge_idx_t> & old_to_new_edge_indices)
+	{
+		#pragma omp parallel for schedule(static, 65536)
+		for (size_t i = 0; i < num_edges(); i++) {
+			DirectedStringGraphEdge & e = _edges[i];
+			const edge_idx_t twin_idx =
+				old_to_new_edge_indices[e.get_twin_idx()];
+			assert(twin_idx != std::numeric_limits<edge_idx_t>::max());
+			e.set_twin_idx(twin_idx);
+		}
 	}
 
 	DirectedStringGraphEdge &
@@ -171,11 +234,9 @@ private:
 		DirectedStringGraphEdge e;
 		e.set_v_indices(v1_idx, v2_idx);
 		edge_idx_t edge_idx = this->push_back_edge(e);
-		_vertices[v1_idx].add_edge_idx(edge_idx);
 		return _edges[edge_idx];
 	}
 
-				
 public:
 	// Initialize this directed string graph with enough space for
 	// @num_reads reads to be inserted.
@@ -202,14 +263,22 @@ public:
 	}
 
 	void transitive_reduction();
-	void min_cost_circulation();
+	void min_cost_circulation(const circulation_solver solver);
 	void collapse_unbranched_paths();
+	size_t clip_tips(const BaseVec::size_type max_tip_len,
+			 const float max_tip_mapped_reads);
+	size_t pop_bubbles(const BaseVec::size_type max_bubble_len,
+			   const unsigned max_depth,
+			   const float min_identity);
+	void simplify(const simplify_params & params);
 	void calculate_A_statistics();
 	void print_stats(std::ostream & os) const;
 
-	void map_contained_read(const v_idx_t downstream_read_idx,
-				const v_idx_t downstream_read_dir,
-				const BaseVec::size_type overhang_len);
+	void map_contained_reads(const std::vector<ContainedReadEnd> & ends);
+	void set_read_weights(const std::vector<float> & read_weights);
+
+	// Return the number of edges leaving the vertex with index @v_idx.
+	size_t out_degree(const v_idx_t v_idx) const { return degree(v_idx); }
 
 	void build_from_bidigraph(const BidirectedStringGraph & bidigraph);
 
@@ -218,14 +287,8 @@ public:
 	void add_edge_pair(const v_idx_t read_1_idx,
 			   const v_idx_t read_2_idx,
 			   const v_idx_t dirs,
-			   const BaseVec & bv1,
-			   const BaseVec::size_type beg_1,
-			   const BaseVec::size_type end_1,
-			   const bool bv1_rc,
-			   const BaseVec & bv2,
-			   const BaseVec::size_type beg_2,
-			   const BaseVec::size_type end_2,
-			   const bool bv2_rc)
+			   const EdgeLabel & label_1,
+			   const EdgeLabel & label_2)
 	{
 		const v_idx_t v1_idx = read_1_idx * 2;
 		const v_idx_t v2_idx = read_2_idx * 2;
@@ -234,27 +297,34 @@ public:
 
 		assert((dirs & 3) == dirs);
 
-		add_edge(v1_idx ^ f_dir, v2_idx ^ g_dir,
-			 bv1, beg_1, end_1, bv1_rc);
+		const edge_idx_t edge_idx_1 =
+			add_edge(v1_idx ^ f_dir, v2_idx ^ g_dir, label_1);
+
+		const edge_idx_t edge_idx_2 =
+			add_edge(v2_idx ^ g_dir ^ 1, v1_idx ^ f_dir ^ 1, label_2);
 
-		add_edge(v2_idx ^ g_dir ^ 1, v1_idx ^ f_dir ^ 1,
-			 bv2, beg_2, end_2, bv2_rc);
+		set_twins(edge_idx_1, edge_idx_2);
 	}
 
 private:
-	void follow_unbranched_path(DirectedStringGraphEdge & e,
-				    std::vector<bool> & remove_edge,
-				    std::vector<bool> & remove_vertex,
-				    const std::vector<bool> & v_inner);
-	void mark_component(const v_idx_t v_idx,
-			    std::vector<bool> & visited,
-			    v_idx_t & component_size) const;
-
-	void walk_back_edges(const v_idx_t v_idx,
-			     size_t overhang_len,
-			     edge_idx_t mapped_edges[],
-			     size_t & num_mapped_edges,
-			     size_t max_mapped_edges);
+	void follow_unbranched_path(const edge_idx_t edge_idx,
+				    const v_idx_t num_inner_vertices,
+				    const BaseVec::size_type new_seq_len,
+				    std::vector<unsigned char> & remove_edge,
+				    std::vector<unsigned char> & remove_vertex);
+
+	size_t remove_edges_and_vertices(const std::vector<unsigned char> & remove_edge,
+					 const std::vector<unsigned char> & remove_vertex);
+
+	int64_t component_min_cost_circulation(const component_index & ci,
+						       const size_t c,
+						       const v_idx_t first_special_v_idx,
+						       const circulation_solver solver);
+
+	void index_back_edges();
+	const back_walk_result & walk_back_edges(const v_idx_t v_idx,
+						 const BaseVec::size_type overhang_len,
+						 back_walk_memo & memo) const;
 
 public:
 	void assert_graph_valid() const
@@ -263,9 +333,10 @@ public:
 			const DirectedStringGraphEdge & e = _edges[i];
 			assert(e.get_v1_idx() < num_vertices());
 			assert(e.get_v2_idx() < num_vertices());
-			edge_idx_t j = locate_edge(e.get_v2_idx() ^ 1, e.get_v1_idx() ^ 1);
+			const edge_idx_t j = e.get_twin_idx();
 			assert(j < num_edges());
 			const DirectedStringGraphEdge & e_X = _edges[j];
+			assert(e_X.get_twin_idx() == i);
 			assert((e_X.get_v1_idx() ^ 1) == e.get_v2_idx());
 			assert((e_X.get_v2_idx() ^ 1) == e.get_v1_idx());
 			//assert(e_X.get_num_inner_vertices() == e.get_num_inner_vertices());
@@ -275,7 +346,9 @@ public:
 	void extract_edge_seqs(BaseVecVec & bvv)
 	{
 		foreach (DirectedStringGraphEdge & e, _edges) {
-			bvv.push_back(e.get_seq());
+			BaseVec bv;
+			e.get_label().extract(_reads, bv);
+			bvv.push_back(bv);
 		}
 	}
 };
@@ -0,0 +1,279 @@
+#pragma once
+
+#include "BaseVecVec.h"
+#include <boost/serialization/split_member.hpp>
+#include <ostream>
+#include <vector>
+#include <stdint.h>
+
+//
+// The sequence label of an edge of a string graph.
+//
+// When a string graph is built from overlaps, every edge label is a
+// subsequence of one read, possibly reverse-complemented.  So rather than
+// copying the bases, the label is stored as a reference to a slice of a read in
+// the read store owned by the graph, and the bases are decoded from the read on
+// demand.
+//
+// A label is only materialized--- given a BaseVec of its own--- when it stops
+// being a slice of a single read, as when the edges of an unbranched path are
+// concatenated.  A materialized label owns its BaseVec.
+//
+class EdgeLabel {
+private:
+	// Value of _read_idx for a materialized label.
+	static const uint32_t MATERIALIZED = ~uint32_t(0);
+
+	// Index of the read of which this label is a slice, or MATERIALIZED.
+	uint32_t _read_idx;
+
+	// Position of the first base of the slice in the read.
+	uint32_t _beg;
+
+	// Number of bases in this label.
+	BaseVec::size_type _len;
+
+	// %true iff the slice is reverse-complemented.
+	bool _rc;
+
+	// The bases of a materialized label.  Empty for a read slice.
+	BaseVec _seq;
+
+	// Serialize this label.  Only the fields that are in use for the kind
+	// of label are written; the reverse-complement flag of a read slice is
+	// packed into the high bit of its starting position.
+	friend class boost::serialization::access;
+	template <class Archive>
+	void save(Archive & ar, unsigned version) const
+	{
+		ar << _read_idx;
+		if (is_materialized()) {
+			ar << _seq;
+		} else {
+			const uint32_t beg_rc = _beg | (uint32_t(_rc) << 31);
+			ar << beg_rc;
+			ar << _len;
+		}
+	}
+
+	// Deserialize this label.
+	template <class Archive>
+	void load(Archive & ar, unsigned version)
+	{
+		ar >> _read_idx;
+		if (is_materialized()) {
+			ar >> _seq;
+			_len = _seq.size();
+			_beg = 0;
+			_rc = false;
+		} else {
+			uint32_t beg_rc;
+			ar >> beg_rc;
+			ar >> _len;
+			_beg = beg_rc & 0x7fffffff;
+			_rc = (beg_rc >> 31) != 0;
+		}
+	}
+	BOOST_SERIALIZATION_SPLIT_MEMBER()
+public:
+	// An empty, materialized label, as on special edges.
+	EdgeLabel()
+		: _read_idx(MATERIALIZED), _beg(0), _len(0), _rc(false)
+	{ }
+
+	// The bases [@beg, @end] of the read with index @read_idx,
+	// reverse-complemented if @rc is %true.
+	EdgeLabel(const size_t read_idx,
+		  const BaseVec::size_type beg,
+		  const BaseVec::size_type end,
+		  const bool rc)
+		: _read_idx(read_idx), _beg(beg), _len(end - beg + 1), _rc(rc)
+	{
+		assert(end >= beg);
+		assert(read_idx < MATERIALIZED);
+	}
+
+	BaseVec::size_type length() const { return _len; }
+
+	bool is_materialized() const { return _read_idx == MATERIALIZED; }
+
+	// Return base @i of this label.  @reads is the read store to which the
+	// label refers.
+	unsigned char base(const BaseVec::size_type i, const BaseVecVec & reads) const
+	{
+		assert2(i < _len);
+		if (is_materialized())
+			return _seq[i];
+		const BaseVec & bv = reads[_read_idx];
+		if (_rc)
+			return 3 ^ bv[_beg + _len - 1 - i];
+		else
+			return bv[_beg + i];
+	}
+
+	//
+	// Labels are hashed with a polynomial hash: the hash of the n bases
+	// b[0], ..., b[n - 1] is the sum of (b[i] + 1) * HASH_MULTIPLIER^(n - 1 - i),
+	// modulo 2^64.  So the hash of the concatenation of two labels can be
+	// computed from their hashes (see hash_concat()), and whether one label
+	// is the concatenation of two others can usually be ruled out without
+	// looking at the bases.
+	//
+	static const uint64_t HASH_MULTIPLIER = 0x9e3779b97f4a7c15ULL;
+
+	// Return the hash of the bases of this label.
+	uint64_t hash(const BaseVecVec & reads) const
+	{
+		uint64_t h = 0;
+		if (is_materialized()) {
+			for (BaseVec::size_type i = 0; i < _len; i++)
+				h = h * HASH_MULTIPLIER + _seq[i] + 1;
+		} else {
+			const BaseVec & bv = reads[_read_idx];
+			if (_rc) {
+				for (BaseVec::size_type i = _beg + _len; i-- > _beg; )
+					h = h * HASH_MULTIPLIER + (3 ^ bv[i]) + 1;
+			} else {
+				for (BaseVec::size_type i = _beg; i < _beg + _len; i++)
+					h = h * HASH_MULTIPLIER + bv[i] + 1;
+			}
+		}
+		return h;
+	}
+
+	// Set @powers[i] to HASH_MULTIPLIER^i for i in [0, @n].
+	static void hash_powers(const BaseVec::size_type n,
+				std::vector<uint64_t> & powers)
+	{
+		powers.resize(n + 1);
+		powers[0] = 1;
+		for (BaseVec::size_type i = 1; i <= n; i++)
+			powers[i] = powers[i - 1] * HASH_MULTIPLIER;
+	}
+
+	// Return the hash of the concatenation of a label with hash @hash_1 and
+	// a label with hash @hash_2, given @pow_len_2 = HASH_MULTIPLIER^n, where
+	// n is the length of the second label.
+	static uint64_t hash_concat(const uint64_t hash_1, const uint64_t hash_2,
+				    const uint64_t pow_len_2)
+	{
+		return hash_1 * pow_len_2 + hash_2;
+	}
+
+	// Return %true iff this label is the concatenation of the labels @a and
+	// @b, comparing the bases.
+	bool equals_concatenation(const EdgeLabel & a, const EdgeLabel & b,
+				  const BaseVecVec & reads) const
+	{
+		return a.length() + b.length() == _len &&
+		       range_equals(0, a, 0, a.length(), reads) &&
+		       range_equals(a.length(), b, 0, b.length(), reads);
+	}
+
+	// Decode the bases of this label into @dest.
+	void extract(const BaseVecVec & reads, BaseVec & dest) const
+	{
+		if (is_materialized()) {
+			dest.set_from_bv(_seq);
+		} else {
+			assert(_read_idx < reads.size());
+			reads[_read_idx].extract_seq(_beg, _beg + _len - 1, _rc, dest);
+		}
+	}
+
+	// Append the bases of this label to @dest.
+	void append_to(const BaseVecVec & reads, BaseVec & dest) const
+	{
+		if (is_materialized()) {
+			dest.append(_seq, 0, _len);
+		} else {
+			assert(_read_idx < reads.size());
+			if (_rc)
+				dest.append_rc(reads[_read_idx], _beg, _len);
+			else
+				dest.append(reads[_read_idx], _beg, _len);
+		}
+	}
+
+	// Make this label the sequence @seq, taking ownership of it.
+	void set_seq(const BaseVec & seq)
+	{
+		_seq.destroy();
+		_seq = seq;
+		_len = seq.size();
+		_read_idx = MATERIALIZED;
+		_beg = 0;
+		_rc = false;
+	}
+
+	// Renumber the read of which this label is a slice, after reads were
+	// removed from the read store: read i is now read
+	// @old_to_new_read_indices[i].
+	void renumber_read(const std::vector<uint32_t> & old_to_new_read_indices)
+	{
+		if (!is_materialized()) {
+			_read_idx = old_to_new_read_indices[_read_idx];
+			assert2(_read_idx != MATERIALIZED);
+		}
+	}
+
+	// Give this label its own copy of its bases, so that it no longer
+	// refers to the read store.
+	void materialize(const BaseVecVec & reads)
+	{
+		if (!is_materialized()) {
+			BaseVec seq;
+			extract(reads, seq);
+			set_seq(seq);
+		}
+	}
+
+	// Print the bases of this label.  If @reads is NULL and the label is a
+	// read slice, the slice is printed instead.
+	void print(std::ostream & os, const BaseVecVec * reads) const
+	{
+		if (is_materialized()) {
+			os << _seq;
+		} else if (reads) {
+			for (BaseVec::size_type i = 0; i < _len; i++)
+				os << BaseUtils::bin_to_ascii(base(i, *reads));
+		} else {
+			os << "read_" << (_read_idx + 1) << '[' << _beg << ','
+			   << (_beg + _len - 1) << ']' << (_rc ? "'" : "");
+		}
+	}
+private:
+	// Return the bases [@i, @i + BaseVec::BASES_PER_WORD) of this label as
+	// a 64-bit word, in the layout of BaseVec::load_word().
+	uint64_t word(const BaseVec::size_type i, const BaseVecVec & reads) const
+	{
+		assert2(i + BaseVec::BASES_PER_WORD <= _len);
+		if (is_materialized())
+			return _seq.load_word(i);
+		const BaseVec & bv = reads[_read_idx];
+		if (_rc)
+			return BaseVec::reverse_complement_word(
+				bv.load_word(_beg + _len - i - BaseVec::BASES_PER_WORD));
+		else
+			return bv.load_word(_beg + i);
+	}
+
+	// Return %true iff the @len bases of this label starting at @beg are
+	// the same as the @len bases of @other starting at @other_beg.  The
+	// bases are compared a word at a time, then one at a time.
+	bool range_equals(BaseVec::size_type beg, const EdgeLabel & other,
+			  BaseVec::size_type other_beg, BaseVec::size_type len,
+			  const BaseVecVec & reads) const
+	{
+		for (; len >= BaseVec::BASES_PER_WORD; len -= BaseVec::BASES_PER_WORD) {
+			if (word(beg, reads) != other.word(other_beg, reads))
+				return false;
+			beg += BaseVec::BASES_PER_WORD;
+			other_beg += BaseVec::BASES_PER_WORD;
+		}
+		while (len--)
+			if (base(beg++, reads) != other.base(other_beg++, reads))
+				return false;
+		return true;
+	}
+};
@@ -0,0 +1,34 @@
+#include "FastaWriter.h"
+#include "util.h"
+
+FastaWriter::FastaWriter(const char *filename)
+	: _out(filename), _filename(filename), _buf_len(0), _line_len(0),
+	  _num_records(0)
+{
+	if (!_out)
+		fatal_error_with_errno("Error opening \"%s\"", filename);
+}
+
+void FastaWriter::flush_buf()
+{
+	_out.write(_buf, _buf_len);
+	_buf_len = 0;
+}
+
+void FastaWriter::begin_record(const std::string & name)
+{
+	put('>');
+	for (size_t i = 0; i < name.size(); i++)
+		put(name[i]);
+	put('\n');
+	_line_len = 0;
+	_num_records++;
+}
+
+void FastaWriter::close()
+{
+	flush_buf();
+	_out.close();
+	if (!_out)
+		fatal_error_with_errno("Error writing to \"%s\"", _filename);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "BaseUtils.h"
+#include <fstream>
+#include <string>
+#include <stddef.h>
+
+//
+// Writes sequences to a FASTA file a base at a time, so that a sequence never
+// has to be held in memory in full.  Output goes through a fixed-size buffer,
+// and sequence lines are wrapped at the same width as in BaseVecVec::write().
+//
+class FastaWriter {
+private:
+	static const size_t LINE_LEN = 70;
+
+	std::ofstream _out;
+	const char *_filename;
+	char _buf[65536];
+	size_t _buf_len;
+	size_t _line_len;
+	size_t _num_records;
+
+	void flush_buf();
+
+	void put(char c)
+	{
+		if (_buf_len == sizeof(_buf))
+			flush_buf();
+		_buf[_buf_len++] = c;
+	}
+
+	FastaWriter(const FastaWriter &) = delete;
+	FastaWriter & operator=(const FastaWriter &) = delete;
+public:
+	FastaWriter(const char *filename);
+
+	// Start a new sequence with the header line @name.
+	void begin_record(const std::string & name);
+
+	// Append the base @base, in binary form, to the current sequence.
+	void put_base(unsigned char base)
+	{
+		if (_line_len == LINE_LEN) {
+			put('\n');
+			_line_len = 0;
+		}
+		put(BaseUtils::bin_to_ascii(base));
+		_line_len++;
+	}
+
+	// Finish the current sequence.
+	void end_record()
+	{
+		put('\n');
+	}
+
+	size_t num_records() const { return _num_records; }
+
+	// Flush the output and close the file.
+	void close();
+};
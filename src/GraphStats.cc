@@ -0,0 +1,151 @@
+#include "GraphStats.h"
+#include "compiler.h"
+#include "parallel.h"
+#include "util.h"
+#include <algorithm>
+
+GraphStats::GraphStats(v_idx_t num_vertices)
+	: _components_uf(num_vertices),
+	  _in_degrees(num_vertices, 0),
+	  _out_degrees(num_vertices, 0),
+	  _bases(num_vertices, 0),
+	  _num_isolated(0),
+	  _num_inner(0),
+	  _num_branch_beginning(0),
+	  _num_branch_ending(0),
+	  _num_in_neq_out(0)
+{ }
+
+void GraphStats::count_in(v_idx_t v_idx)
+{
+	atomic_add(&_in_degrees[v_idx], v_idx_t(1));
+}
+
+void GraphStats::count_out(v_idx_t v_idx)
+{
+	atomic_add(&_out_degrees[v_idx], v_idx_t(1));
+}
+
+void GraphStats::add_edge(v_idx_t v1_idx, v_idx_t v2_idx, uint64_t num_bases)
+{
+	atomic_add(&_bases[v1_idx], num_bases);
+	_components_uf.unite(v1_idx, v2_idx);
+}
+
+void GraphStats::finish()
+{
+	const v_idx_t n = _components_uf.size();
+	v_idx_t max_in_degree = 0, max_out_degree = 0;
+	v_idx_t num_isolated = 0, num_inner = 0;
+	v_idx_t num_branch_beginning = 0, num_branch_ending = 0;
+	v_idx_t num_in_neq_out = 0;
+
+	// Point every vertex directly at its root, and move the base counts of
+	// the vertices onto the roots.  Nothing is linked any more, so the
+	// roots are final.
+	#pragma omp parallel for \
+		reduction(max: max_in_degree, max_out_degree) \
+		reduction(+: num_isolated, num_inner, num_branch_beginning, \
+			     num_branch_ending, num_in_neq_out)
+	for (v_idx_t v_idx = 0; v_idx < n; v_idx++) {
+		const v_idx_t in = _in_degrees[v_idx];
+		const v_idx_t out = _out_degrees[v_idx];
+		max_in_degree = std::max(max_in_degree, in);
+		max_out_degree = std::max(max_out_degree, out);
+		num_isolated += (in == 0 && out == 0);
+		num_inner += (in == 1 && out == 1);
+		num_branch_beginning += (in == 0 && out == 1);
+		num_branch_ending += (in == 1 && out == 0);
+		num_in_neq_out += (in != out);
+
+		const v_idx_t root = _components_uf.flatten(v_idx);
+		if (root != v_idx) {
+			const uint64_t bases = atomic_set(&_bases[v_idx],
+							  uint64_t(0));
+			atomic_add(&_bases[root], bases);
+		}
+	}
+	_num_isolated = num_isolated;
+	_num_inner = num_inner;
+	_num_branch_beginning = num_branch_beginning;
+	_num_branch_ending = num_branch_ending;
+	_num_in_neq_out = num_in_neq_out;
+
+	_in_degree_hist.assign(n ? max_in_degree + 1 : 0, 0);
+	_out_degree_hist.assign(n ? max_out_degree + 1 : 0, 0);
+	for (v_idx_t v_idx = 0; v_idx < n; v_idx++) {
+		_in_degree_hist[_in_degrees[v_idx]]++;
+		_out_degree_hist[_out_degrees[v_idx]]++;
+	}
+
+	// Count the vertices of each component on its root, reusing the
+	// in-degree array now that the histograms are done.
+	std::vector<v_idx_t> & sizes = _in_degrees;
+	std::fill(sizes.begin(), sizes.end(), 0);
+	for (v_idx_t v_idx = 0; v_idx < n; v_idx++)
+		sizes[_components_uf.parent(v_idx)]++;
+
+	_components.clear();
+	for (v_idx_t v_idx = 0; v_idx < n; v_idx++) {
+		if (_components_uf.is_root(v_idx)) {
+			Component c;
+			c.num_vertices = sizes[v_idx];
+			c.num_bases = _bases[v_idx];
+			_components.push_back(c);
+		}
+	}
+	std::sort(_components.begin(), _components.end());
+
+	std::vector<v_idx_t>().swap(_in_degrees);
+	std::vector<v_idx_t>().swap(_out_degrees);
+	std::vector<uint64_t>().swap(_bases);
+}
+
+// Print the nonzero entries of a degree histogram.
+void GraphStats::print_hist(std::ostream & os,
+			    const std::vector<v_idx_t> & hist)
+{
+	for (size_t degree = 0; degree < hist.size(); degree++) {
+		if (hist[degree] != 0) {
+			os << "        " << degree << ": " << hist[degree]
+			   << (hist[degree] == 1 ? " vertex" : " vertices")
+			   << std::endl;
+		}
+	}
+}
+
+void GraphStats::print_degrees(std::ostream & os) const
+{
+	os << "    Number of isolated vertices: "
+	   << _num_isolated << std::endl;
+	os << "    Number of inner vertices: "
+	   << _num_inner << std::endl;
+	os << "    Number of branch beginning vertices: "
+	   << _num_branch_beginning << std::endl;
+	os << "    Number of branch ending vertices: "
+	   << _num_branch_ending << std::endl;
+	os << "    Number of vertices with unequal in degree and out degree: "
+	   << _num_in_neq_out << std::endl;
+	os << "    Max in degree: "
+	   << (_in_degree_hist.empty() ? 0 : _in_degree_hist.size() - 1)
+	   << std::endl;
+	os << "    Max out degree: "
+	   << (_out_degree_hist.empty() ? 0 : _out_degree_hist.size() - 1)
+	   << std::endl;
+	os << "    In degree histogram:" << std::endl;
+	print_hist(os, _in_degree_hist);
+	os << "    Out degree histogram:" << std::endl;
+	print_hist(os, _out_degree_hist);
+}
+
+void GraphStats::print_components(std::ostream & os) const
+{
+	os << "    Number of components: " << _components.size() << std::endl;
+	os << "    Component sizes:" << std::endl;
+	foreach (const Component & c, _components) {
+		os << "        " << c.num_vertices << ' '
+		   << (c.num_vertices == 1 ? "vertex" : "vertices") << ", "
+		   << c.num_bases << ' '
+		   << (c.num_bases == 1 ? "base" : "bases") << std::endl;
+	}
+}
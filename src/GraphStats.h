@@ -0,0 +1,80 @@
+#pragma once
+
+#include "UnionFind.h"
+#include <ostream>
+#include <vector>
+#include <stdint.h>
+
+//
+// Statistics about the vertex degrees and connected components of a string
+// graph, of either type.
+//
+// The caller streams the edges of the graph through count_in(), count_out() and
+// add_edge(), which may all be called concurrently from multiple threads, then
+// calls finish() once and prints the results.  Degrees are counted exactly, and
+// components are found with a concurrent UnionFind rather than by a graph
+// search, so no recursion or per-vertex edge lists are needed.
+//
+class GraphStats {
+public:
+	typedef unsigned int v_idx_t;
+
+	struct Component {
+		v_idx_t num_vertices;
+		uint64_t num_bases;
+
+		bool operator<(const Component & other) const
+		{
+			if (num_vertices != other.num_vertices)
+				return num_vertices < other.num_vertices;
+			return num_bases < other.num_bases;
+		}
+	};
+private:
+	UnionFind<v_idx_t> _components_uf;
+	std::vector<v_idx_t> _in_degrees;
+	std::vector<v_idx_t> _out_degrees;
+	std::vector<uint64_t> _bases;
+
+	std::vector<v_idx_t> _in_degree_hist;
+	std::vector<v_idx_t> _out_degree_hist;
+	v_idx_t _num_isolated;
+	v_idx_t _num_inner;
+	v_idx_t _num_branch_beginning;
+	v_idx_t _num_branch_ending;
+	v_idx_t _num_in_neq_out;
+	std::vector<Component> _components;
+
+	static void print_hist(std::ostream & os,
+			       const std::vector<v_idx_t> & hist);
+public:
+	GraphStats(v_idx_t num_vertices);
+
+	// Count one edge entering the vertex @v_idx.
+	void count_in(v_idx_t v_idx);
+
+	// Count one edge leaving the vertex @v_idx.
+	void count_out(v_idx_t v_idx);
+
+	// Join the components of the vertices @v1_idx and @v2_idx, and add
+	// @num_bases, the length of the edge between them, to the length of the
+	// component.  This does not count the edge in any degrees.
+	void add_edge(v_idx_t v1_idx, v_idx_t v2_idx, uint64_t num_bases);
+
+	// Compute the histograms and the list of components once all the edges
+	// have been added.
+	void finish();
+
+	// Print the degree statistics.
+	void print_degrees(std::ostream & os) const;
+
+	// Print the number of components and the size of each.
+	void print_components(std::ostream & os) const;
+
+	// The components, sorted by number of vertices and then by number of
+	// bases.
+	const std::vector<Component> & components() const
+	{
+		return _components;
+	}
+};
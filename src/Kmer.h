@@ -1,9 +1,11 @@
 #pragma once
 
 #include "BaseUtils.h"
+#include "BaseVec.h"
 #include "util.h"
 
 #include <iostream>
+#include <limits>
 #include <BaseUtils.h>
 
 //
@@ -171,5 +173,27 @@ public:
 	{
 		for (unsigned i = 0; i < _K; i++)
 			os << BaseUtils::bin_to_ascii(kmer[i]);
+		return os;
 	}
 };
+
+// Call @f(pos, kmer) for each position @pos in the sequence @bv, from first to
+// last, at which a k-mer starts, with @kmer the canonical k-mer there: the
+// lesser of the k-mer and its reverse complement.
+template <unsigned K, typename F>
+void for_each_kmer(const BaseVec & bv, F f)
+{
+	if (bv.size() < K)
+		return;
+	Kmer<K> fwd_kmer;
+	Kmer<K> rev_kmer;
+	for (size_t j = 0; j < K - 1; j++) {
+		fwd_kmer.push_back(bv[j]);
+		rev_kmer.push_front(bv[j] ^ 3);
+	}
+	for (size_t j = K - 1; j < bv.size(); j++) {
+		fwd_kmer.push_back(bv[j]);
+		rev_kmer.push_front(bv[j] ^ 3);
+		f(j - (K - 1), canonical_kmer(fwd_kmer, rev_kmer));
+	}
+}
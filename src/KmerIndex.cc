@@ -0,0 +1,126 @@
+#include "KmerIndex.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char KmerIndexFile::magic[10] =
+	{'K', 'm', 'e', 'r', 'I', 'n', 'd', 'e', 'x', '\0'};
+
+// Header at the beginning of a k-mer index file.  The sorted entries follow
+// immediately after it.
+struct kmer_index_header {
+	char magic[10];
+	uint16_t kmer_len;
+	uint32_t entry_size;
+	uint64_t num_reads;
+	uint64_t reads_checksum;
+	uint64_t num_entries;
+};
+
+void KmerIndexFile::release()
+{
+	if (_map)
+		munmap(_map, _map_len);
+	_map = NULL;
+	_map_len = 0;
+	_entries = NULL;
+	_num_entries = 0;
+	_num_reads = 0;
+	_reads_checksum = 0;
+}
+
+// Memory-map the k-mer index in the file @filename, checking that its entries
+// are of @kmer_len-mers and are @entry_size bytes each.
+void KmerIndexFile::read(const char *filename, unsigned kmer_len,
+			 size_t entry_size)
+{
+	release();
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		fatal_error_with_errno("Error opening \"%s\"", filename);
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+		fatal_error_with_errno("Error reading \"%s\"", filename);
+
+	const size_t file_len = st.st_size;
+	if (file_len < sizeof(kmer_index_header))
+		fatal_error("\"%s\" is too short to be a k-mer index", filename);
+
+	void *map = mmap(NULL, file_len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		fatal_error_with_errno("Error memory-mapping \"%s\"", filename);
+	close(fd);
+
+	kmer_index_header hdr;
+	memcpy(&hdr, map, sizeof(hdr));
+	if (memcmp(hdr.magic, magic, sizeof(magic)) != 0)
+		fatal_error("\"%s\" is not a k-mer index", filename);
+	if (hdr.kmer_len != kmer_len)
+		fatal_error("\"%s\" is an index of %u-mers, but %u-mers are "
+			    "needed", filename, unsigned(hdr.kmer_len), kmer_len);
+	if (hdr.entry_size != entry_size)
+		fatal_error("\"%s\": invalid entry size (%u)", filename,
+			    unsigned(hdr.entry_size));
+	if ((file_len - sizeof(hdr)) / entry_size < hdr.num_entries)
+		fatal_error("\"%s\" is truncated", filename);
+
+	_map = map;
+	_map_len = file_len;
+	_entries = (const char*)map + sizeof(hdr);
+	_num_entries = hdr.num_entries;
+	_num_reads = hdr.num_reads;
+	_reads_checksum = hdr.reads_checksum;
+}
+
+// Check that this index, read from the file @filename, is of the first
+// @num_reads reads of @bvv.
+void KmerIndexFile::check_reads(const char *filename, const BaseVecVec & bvv,
+				size_t num_reads) const
+{
+	if (_num_reads != num_reads)
+		fatal_error("\"%s\" is an index of %zu reads, but there are %zu",
+			    filename, _num_reads, num_reads);
+	if (bvv.checksum(num_reads) != _reads_checksum)
+		fatal_error("\"%s\" is an index of different reads", filename);
+}
+
+// Return the length of the k-mers in the index in the file @filename.
+unsigned KmerIndexFile::read_kmer_len(const char *filename)
+{
+	std::ifstream in(filename);
+	if (!in)
+		fatal_error_with_errno("Error opening \"%s\"", filename);
+	kmer_index_header hdr;
+	in.read((char*)&hdr, sizeof(hdr));
+	if (!in || memcmp(hdr.magic, magic, sizeof(magic)) != 0)
+		fatal_error("\"%s\" is not a k-mer index", filename);
+	return hdr.kmer_len;
+}
+
+void KmerIndexFile::write_header(std::ostream & out, unsigned kmer_len,
+				 size_t entry_size, size_t num_reads,
+				 uint64_t reads_checksum, size_t num_entries)
+{
+	kmer_index_header hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, magic, sizeof(magic));
+	hdr.kmer_len = kmer_len;
+	hdr.entry_size = entry_size;
+	hdr.num_reads = num_reads;
+	hdr.reads_checksum = reads_checksum;
+	hdr.num_entries = num_entries;
+	out.write((const char*)&hdr, sizeof(hdr));
+}
+
+// Close @out, to which an index was written as the file @filename.
+void KmerIndexFile::finish_write(std::ofstream & out, const char *filename)
+{
+	out.close();
+	if (!out)
+		fatal_error_with_errno("Error writing to \"%s\"", filename);
+}
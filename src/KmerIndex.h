@@ -0,0 +1,242 @@
+#pragma once
+
+#include "BaseVecVec.h"
+#include "Kmer.h"
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+// Stores the location of a k-mer in the read set.
+class KmerOccurrence {
+private:
+	// Index of the read containing the k-mer sequence
+	unsigned long _read_id	: 32;
+
+	// Position of the k-mer within the read (0-indexed)
+	unsigned long _read_pos	: 31;
+
+	// Whether the canonical k-mer is reverse-complement
+	unsigned long _rc	: 1;
+public:
+
+	static const unsigned long long MAX_READ_IDX = ((1ULL << 32) - 1);
+	static const unsigned long long MAX_READ_POS = ((1ULL << 31) - 1);
+
+	KmerOccurrence(unsigned long read_id, unsigned long read_pos, bool rc)
+		: _read_id(read_id), _read_pos(read_pos), _rc(rc)
+	{ }
+
+	unsigned long get_read_id() const { return _read_id; }
+
+	void swap_reads(KmerOccurrence & other) {
+		unsigned long tmp;
+		tmp = _read_id;
+		_read_id = other._read_id;
+		other._read_id = tmp;
+		tmp = _read_pos;
+		_read_pos = other._read_pos;
+		other._read_pos = tmp;
+	}
+
+	unsigned long get_read_pos() const { return _read_pos; }
+
+	bool is_rc() const { return _rc; }
+	void flip_rc() { _rc = !_rc; }
+
+	friend std::ostream & operator<<(std::ostream & os, const KmerOccurrence & occ)
+	{
+		return os << "KmerOccurrence { _read_id: " << occ._read_id <<
+			", _read_pos: " << occ._read_pos <<
+			", _rc: " <<occ._rc << "}";
+	}
+};
+
+//
+// Call @f(kmer, occ) for each occurrence of a k-mer in the reads of @bvv,
+// starting at read @first_read_idx: @kmer is the canonical k-mer and @occ its
+// occurrence, which is reverse-complement if @kmer is not the forward k-mer.
+//
+template <unsigned K, typename F>
+void for_each_kmer_occurrence(const BaseVecVec & bvv, const size_t first_read_idx,
+			      F f)
+{
+	for (size_t i = first_read_idx; i < bvv.size(); i++) {
+		const BaseVec &bv = bvv[i];
+		Kmer<K> fwd_kmer;
+		Kmer<K> rev_kmer;
+		if (bv.size() < K)
+			continue;
+		for (size_t j = 0; j < K - 1; j++) {
+			fwd_kmer.push_back(bv[j]);
+			rev_kmer.push_front(bv[j] ^ 3);
+		}
+		for (size_t j = K - 1; j < bv.size(); j++) {
+			fwd_kmer.push_back(bv[j]);
+			rev_kmer.push_front(bv[j] ^ 3);
+
+			for (size_t k = 0; k < K; k++) {
+				unsigned char bv_base = bv[(j - (K - 1)) + k];
+				assert2(fwd_kmer[k] == bv_base);
+				assert2(rev_kmer[(K - 1) - k] == (3 ^ bv_base));
+			}
+
+			if (fwd_kmer < rev_kmer)
+				f(fwd_kmer, KmerOccurrence(i, j - (K - 1), false));
+			else
+				f(rev_kmer, KmerOccurrence(i, j - (K - 1), true));
+		}
+	}
+}
+
+// An entry of a KmerIndex: a canonical k-mer and one of its occurrences.
+template <unsigned K>
+struct KmerIndexEntry {
+	Kmer<K> kmer;
+	KmerOccurrence occ;
+
+	KmerIndexEntry(const Kmer<K> & _kmer, const KmerOccurrence & _occ)
+		: kmer(_kmer), occ(_occ)
+	{ }
+
+	// Entries are ordered by k-mer, then by the position of the occurrence
+	// in the read set.
+	friend bool operator<(const KmerIndexEntry & e1, const KmerIndexEntry & e2)
+	{
+		if (!(e1.kmer == e2.kmer))
+			return e1.kmer < e2.kmer;
+		if (e1.occ.get_read_id() != e2.occ.get_read_id())
+			return e1.occ.get_read_id() < e2.occ.get_read_id();
+		return e1.occ.get_read_pos() < e2.occ.get_read_pos();
+	}
+};
+
+//
+// The part of a KmerIndex that does not depend on K: the file format.
+//
+// A k-mer index file is a short header followed by the entries, sorted, exactly
+// as they are laid out in memory.  So, as with PackedIntVec, the file is simply
+// memory-mapped when it is read, and the entries are used in place.  The header
+// records K and the size of an entry, which are checked when the file is read,
+// and the number of reads that were indexed and their checksum, so that an
+// index is not used with reads other than those it was built from.
+//
+class KmerIndexFile {
+private:
+	static const char magic[10];
+
+	void *_map;
+	size_t _map_len;
+
+	KmerIndexFile(const KmerIndexFile &) = delete;
+	KmerIndexFile & operator=(const KmerIndexFile &) = delete;
+protected:
+	const void *_entries;
+	size_t _num_entries;
+	size_t _num_reads;
+	uint64_t _reads_checksum;
+
+	KmerIndexFile()
+		: _map(NULL), _map_len(0), _entries(NULL), _num_entries(0),
+		  _num_reads(0), _reads_checksum(0)
+	{ }
+
+	~KmerIndexFile() { release(); }
+
+	void release();
+	void read(const char *filename, unsigned kmer_len, size_t entry_size);
+
+	static void write_header(std::ostream & out, unsigned kmer_len,
+				 size_t entry_size, size_t num_reads,
+				 uint64_t reads_checksum, size_t num_entries);
+	static void finish_write(std::ofstream & out, const char *filename);
+public:
+	// Number of reads that were indexed.
+	size_t num_reads() const { return _num_reads; }
+
+	// Number of k-mer occurrences in the index.
+	size_t size() const { return _num_entries; }
+
+	void check_reads(const char *filename, const BaseVecVec & bvv,
+			 size_t num_reads) const;
+
+	static unsigned read_kmer_len(const char *filename);
+};
+
+//
+// An index of all the occurrences of the k-mers of a read set, sorted by k-mer,
+// that can be written to a file and memory-mapped back in.  It is written by
+// build-kmer-index or compute-overlaps, and compute-overlaps then seeds
+// overlaps from it instead of indexing the reads again, including when reads
+// are added to the read set.
+//
+template <unsigned K>
+class KmerIndex : public KmerIndexFile {
+public:
+	typedef KmerIndexEntry<K> Entry;
+
+	// Memory-map the index from the file @filename, which must have been
+	// written with the same K.
+	KmerIndex(const char *filename)
+	{
+		read(filename, K, sizeof(Entry));
+	}
+
+	const Entry *begin() const { return (const Entry*)_entries; }
+	const Entry *end() const { return begin() + _num_entries; }
+
+	// Return the range of entries for the canonical k-mer @kmer.
+	std::pair<const Entry *, const Entry *> find(const Kmer<K> & kmer) const
+	{
+		const Entry *lo = std::lower_bound(begin(), end(), kmer,
+			[](const Entry & e, const Kmer<K> & k) { return e.kmer < k; });
+		const Entry *hi = std::upper_bound(lo, end(), kmer,
+			[](const Kmer<K> & k, const Entry & e) { return k < e.kmer; });
+		return std::make_pair(lo, hi);
+	}
+
+	// Fill in @entries with the sorted entries for the reads of @bvv,
+	// starting at read @first_read_idx.
+	static void collect_entries(const BaseVecVec & bvv,
+				    const size_t first_read_idx,
+				    std::vector<Entry> & entries)
+	{
+		entries.clear();
+		for_each_kmer_occurrence<K>(bvv, first_read_idx,
+			[&](const Kmer<K> & kmer, const KmerOccurrence & occ) {
+				entries.push_back(Entry(kmer, occ));
+			});
+		std::sort(entries.begin(), entries.end());
+	}
+
+	//
+	// Write the index of the reads @bvv, whose entries are the sorted
+	// entries [@beg_1, @end_1) merged with the sorted entries [@beg_2,
+	// @end_2), to the file @filename.
+	//
+	// @filename must not be the file that one of the ranges is mapped
+	// from; to update an index, write it to a temporary file and rename
+	// that over the old one.
+	//
+	static void write(const char *filename, const BaseVecVec & bvv,
+			  const Entry *beg_1, const Entry *end_1,
+			  const Entry *beg_2, const Entry *end_2)
+	{
+		std::ofstream out(filename);
+		if (!out)
+			fatal_error_with_errno("Error opening \"%s\"", filename);
+		write_header(out, K, sizeof(Entry), bvv.size(),
+			     bvv.checksum(bvv.size()),
+			     (end_1 - beg_1) + (end_2 - beg_2));
+		while (beg_1 != end_1 || beg_2 != end_2) {
+			const Entry *e;
+			if (beg_2 == end_2 || (beg_1 != end_1 && !(*beg_2 < *beg_1)))
+				e = beg_1++;
+			else
+				e = beg_2++;
+			out.write((const char*)e, sizeof(Entry));
+		}
+		finish_write(out, filename);
+	}
+};
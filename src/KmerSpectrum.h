@@ -0,0 +1,270 @@
+#pragma once
+
+#include "BaseVecVec.h"
+#include "Kmer.h"
+#include "parallel.h"
+#include <unordered_map>
+#include <unordered_set>
+
+//
+// The solid k-mers of a read set: the canonical k-mers that occur at least a
+// given number of times in the reads, counting both strands.  In reads with
+// enough coverage, nearly every k-mer of the genome is solid, while a k-mer
+// that contains a sequencing error is usually seen only once or twice.
+//
+// The k-mers are counted in shards, by hash value, so that each shard can be
+// counted by a different thread without locking.  The reads are split among the
+// threads, each of which routes the k-mers it finds to per-shard buffers, so
+// each k-mer occurrence is extracted and routed only once.
+//
+// Reads can then be corrected by correct_read().
+//
+template <unsigned K>
+class KmerSpectrum {
+private:
+	typedef std::unordered_set<Kmer<K>, typename Kmer<K>::hash_functor>
+		kmer_set;
+	typedef std::unordered_map<Kmer<K>, unsigned,
+				   typename Kmer<K>::hash_functor>
+		kmer_count_map;
+
+	std::vector<kmer_set> _shards;
+	size_t _num_distinct;
+
+	size_t shard_idx(const Kmer<K> & kmer) const
+	{
+		// The high bits are used so that the shard does not determine
+		// the bucket of the k-mer within the shard.
+		return (kmer.hash() >> 32) % _shards.size();
+	}
+
+	// Return whether the k-mer starting at position @pos of @bv is solid.
+	bool is_solid_at(const BaseVec & bv, const size_t pos) const
+	{
+		Kmer<K> fwd_kmer;
+		Kmer<K> rev_kmer;
+		for (size_t j = pos; j < pos + K; j++) {
+			fwd_kmer.push_back(bv[j]);
+			rev_kmer.push_front(bv[j] ^ 3);
+		}
+		return is_solid(canonical_kmer(fwd_kmer, rev_kmer));
+	}
+
+	// Return the number of solid k-mers among those of @bv that contain
+	// position @x.
+	unsigned num_solid_covering(const BaseVec & bv, const size_t x) const
+	{
+		const size_t first = (x >= K - 1) ? x - (K - 1) : 0;
+		const size_t last = std::min<size_t>(x, bv.size() - K);
+		unsigned n = 0;
+		for (size_t pos = first; pos <= last; pos++)
+			n += is_solid_at(bv, pos);
+		return n;
+	}
+public:
+	// Count the k-mers of @reads and keep those that occur at least
+	// @min_count times.
+	KmerSpectrum(const BaseVecVec & reads, const unsigned min_count)
+		: _shards(omp_get_max_threads()), _num_distinct(0)
+	{
+		const size_t num_shards = _shards.size();
+		info("Counting %u-mers in %zu reads (%zu shards)",
+		     K, reads.size(), num_shards);
+
+		// The reads are scanned in batches.  The threads split the
+		// reads of a batch and route each k-mer to the buffer for its
+		// shard, then split the shards and count the k-mers routed to
+		// them.  @buffers[t * num_shards + s] holds the k-mers of shard
+		// s found by thread t in the current batch.
+		const size_t batch_size = 16384;
+		std::vector<kmer_count_map> counts(num_shards);
+		std::vector<std::vector<Kmer<K> > > buffers(num_shards * num_shards);
+		for (size_t batch_beg = 0; batch_beg < reads.size();
+		     batch_beg += batch_size)
+		{
+			const size_t batch_end = std::min(reads.size(),
+							  batch_beg + batch_size);
+			#pragma omp parallel
+			{
+				const size_t t = omp_get_thread_num();
+				#pragma omp for schedule(dynamic, 64)
+				for (size_t i = batch_beg; i < batch_end; i++) {
+					for_each_kmer<K>(reads[i],
+						[&](size_t pos, const Kmer<K> & kmer) {
+						buffers[t * num_shards + shard_idx(kmer)]
+							.push_back(kmer);
+					});
+				}
+
+				#pragma omp for schedule(dynamic, 1)
+				for (size_t s = 0; s < num_shards; s++) {
+					for (size_t u = 0; u < num_shards; u++) {
+						std::vector<Kmer<K> > & buf =
+							buffers[u * num_shards + s];
+						foreach (const Kmer<K> & kmer, buf)
+							counts[s][kmer]++;
+						buf.clear();
+					}
+				}
+			}
+		}
+
+		size_t num_distinct = 0;
+		#pragma omp parallel for schedule(dynamic, 1) \
+			reduction(+:num_distinct)
+		for (size_t s = 0; s < num_shards; s++) {
+			num_distinct += counts[s].size();
+			for (typename kmer_count_map::const_iterator it = counts[s].begin();
+			     it != counts[s].end(); it++)
+				if (it->second >= min_count)
+					_shards[s].insert(it->first);
+			kmer_count_map().swap(counts[s]);
+		}
+		_num_distinct = num_distinct;
+		info("Found %zu distinct %u-mers, of which %zu occur at least "
+		     "%u times", _num_distinct, K, num_solid(), min_count);
+	}
+
+	// Return whether the canonical k-mer @kmer is solid.
+	bool is_solid(const Kmer<K> & kmer) const
+	{
+		const kmer_set & shard = _shards[shard_idx(kmer)];
+		return shard.find(kmer) != shard.end();
+	}
+
+	size_t num_distinct() const { return _num_distinct; }
+
+	size_t num_solid() const
+	{
+		size_t n = 0;
+		foreach (const kmer_set & shard, _shards)
+			n += shard.size();
+		return n;
+	}
+
+	//
+	// Correct the read @bv by substituting bases, at most
+	// @max_corrections of them, until all its k-mers are solid.
+	//
+	// The weak k-mers are fixed from the first one on.  If the first weak
+	// k-mer is not at the start of the read, the k-mer before it is solid,
+	// so the error is taken to be in its last base.  Otherwise, it may be
+	// in any base of the first k-mer.  Of the substitutions at the possible
+	// positions that make the first weak k-mer solid, the one that makes
+	// the most k-mers containing the substituted base solid is made, and
+	// the read is left as it is if there are several such substitutions.
+	//
+	// Returns the number of bases substituted, or -1 if the read could not
+	// be corrected, in which case it is left unchanged.  A read shorter than
+	// K has no k-mers and is never changed.
+	//
+	int correct_read(BaseVec & bv, const unsigned max_corrections) const
+	{
+		if (bv.size() < K)
+			return 0;
+		const size_t n = bv.size() - K + 1;
+		std::vector<unsigned char> solid(n);
+		for_each_kmer<K>(bv, [&](size_t pos, const Kmer<K> & kmer) {
+			solid[pos] = is_solid(kmer);
+		});
+
+		std::vector<std::pair<size_t, unsigned char> > substitutions;
+		size_t p = 0;
+		for (;;) {
+			while (p < n && solid[p])
+				p++;
+			if (p == n)
+				return substitutions.size();
+			if (substitutions.size() == max_corrections)
+				break;
+
+			const size_t first_x = (p == 0) ? 0 : p + K - 1;
+			const size_t last_x = p + K - 1;
+			size_t best_x = 0;
+			unsigned char best_base = 0;
+			unsigned best_score = 0;
+			bool ambiguous = false;
+			for (size_t x = first_x; x <= last_x; x++) {
+				const unsigned char orig_base = bv[x];
+				for (unsigned char base = 0; base < 4; base++) {
+					if (base == orig_base)
+						continue;
+					bv.set(x, base);
+					if (is_solid_at(bv, p)) {
+						const unsigned score =
+							num_solid_covering(bv, x);
+						if (score > best_score) {
+							best_x = x;
+							best_base = base;
+							best_score = score;
+							ambiguous = false;
+						} else if (score == best_score) {
+							ambiguous = true;
+						}
+					}
+				}
+				bv.set(x, orig_base);
+			}
+			if (best_score == 0 || ambiguous)
+				break;
+
+			substitutions.push_back(std::make_pair(best_x, bv[best_x]));
+			bv.set(best_x, best_base);
+			const size_t first = (best_x >= K - 1) ? best_x - (K - 1) : 0;
+			const size_t last = std::min(best_x, n - 1);
+			for (size_t pos = first; pos <= last; pos++)
+				solid[pos] = is_solid_at(bv, pos);
+		}
+
+		// Undo the substitutions.
+		while (!substitutions.empty()) {
+			bv.set(substitutions.back().first,
+			       substitutions.back().second);
+			substitutions.pop_back();
+		}
+		return -1;
+	}
+};
+
+// Statistics from correct_reads().
+struct read_correction_stats {
+	size_t num_corrected_reads;
+	size_t num_substitutions;
+	size_t num_uncorrectable_reads;
+};
+
+//
+// Correct each read of @reads in place with the solid k-mers @spectrum, making
+// at most @max_corrections substitutions in each.  The reads are corrected in
+// parallel.
+//
+template <unsigned K>
+read_correction_stats correct_reads(BaseVecVec & reads,
+				    const KmerSpectrum<K> & spectrum,
+				    const unsigned max_corrections)
+{
+	size_t num_corrected_reads = 0;
+	size_t num_substitutions = 0;
+	size_t num_uncorrectable_reads = 0;
+
+	info("Correcting %zu reads with at most %u substitutions each",
+	     reads.size(), max_corrections);
+	#pragma omp parallel for schedule(dynamic, 256) \
+		reduction(+:num_corrected_reads, num_substitutions, \
+			  num_uncorrectable_reads)
+	for (size_t i = 0; i < reads.size(); i++) {
+		const int n = spectrum.correct_read(reads[i], max_corrections);
+		if (n < 0) {
+			num_uncorrectable_reads++;
+		} else if (n > 0) {
+			num_corrected_reads++;
+			num_substitutions += n;
+		}
+	}
+
+	read_correction_stats stats;
+	stats.num_corrected_reads = num_corrected_reads;
+	stats.num_substitutions = num_substitutions;
+	stats.num_uncorrectable_reads = num_uncorrectable_reads;
+	return stats;
+}
@@ -40,14 +40,14 @@ seed_invalid:
 }
 
 //
-// Checks to make sure an overlap was correctly computed.
+// Checks to make sure the extents of an overlap are consistent with the lengths
+// of the two reads, @read_1_len and @read_2_len, without looking at the bases.
 //
-void assert_overlap_valid(const Overlap & o, const BaseVecVec & bvv,
-			  const unsigned min_overlap_len,
-			  const unsigned max_edits)
+void assert_overlap_extents_valid(const Overlap & o,
+				  const unsigned read_1_len,
+				  const unsigned read_2_len,
+				  const unsigned min_overlap_len)
 {
-	if (max_edits > 0)
-		unimplemented();
 	Overlap::read_idx_t read_1_idx;
 	Overlap::read_pos_t read_1_beg, read_1_end;
 	Overlap::read_idx_t read_2_idx;
@@ -59,15 +59,10 @@ void assert_overlap_valid(const Overlap & o, const BaseVecVec & bvv,
 	o.get(read_1_idx, read_1_beg, read_1_end,
 	      read_2_idx, read_2_beg, read_2_end, rc);
 
-	assert(read_1_idx < bvv.size());
-	assert(read_2_idx < bvv.size());
-
 	assert(read_1_idx <= read_2_idx);
 
-	const BaseVec & bv1 = bvv[read_1_idx];
-	const BaseVec & bv2 = bvv[read_2_idx];
-	assert(read_1_end < bv1.size());
-	assert(read_2_end < bv2.size());
+	assert(read_1_end < read_1_len);
+	assert(read_2_end < read_2_len);
 	assert(read_1_beg <= read_1_end);
 	assert(read_2_beg <= read_2_end);
 
@@ -75,22 +70,71 @@ void assert_overlap_valid(const Overlap & o, const BaseVecVec & bvv,
 	len_2 = read_2_end - read_2_beg + 1;
 	assert(len_1 == len_2);
 	assert(len_1 >= min_overlap_len);
-	assert_seed_valid(bv1, bv2, read_1_beg, read_2_beg, len_1,
-			  rc, "OVERLAP");
 
 	if (read_1_idx == read_2_idx)
 		assert(read_1_beg != read_2_beg || read_1_end != read_2_end);
 
 	if (rc) {
-		maybe_rc_read_2_beg = (bv2.size() - 1) - read_2_end;
-		maybe_rc_read_2_end = (bv2.size() - 1) - read_2_beg;
+		maybe_rc_read_2_beg = (read_2_len - 1) - read_2_end;
+		maybe_rc_read_2_end = (read_2_len - 1) - read_2_beg;
 	} else {
 		maybe_rc_read_2_beg = read_2_beg;
 		maybe_rc_read_2_end = read_2_end;
 	}
 	if ((read_1_beg == 0 && maybe_rc_read_2_beg == 0) ||
-	    (read_1_end == bv1.size() - 1 && maybe_rc_read_2_end == bv2.size() - 1))
+	    (read_1_end == read_1_len - 1 && maybe_rc_read_2_end == read_2_len - 1))
 	{
-		assert(len_1 == bv1.size() || len_2 == bv2.size());
+		assert(len_1 == read_1_len || len_2 == read_2_len);
+	}
+}
+
+//
+// Checks to make sure an overlap was correctly computed.
+//
+void assert_overlap_valid(const Overlap & o, const BaseVecVec & bvv,
+			  const unsigned min_overlap_len,
+			  const unsigned max_edits)
+{
+	if (max_edits > 0)
+		unimplemented();
+	Overlap::read_idx_t read_1_idx;
+	Overlap::read_pos_t read_1_beg, read_1_end;
+	Overlap::read_idx_t read_2_idx;
+	Overlap::read_pos_t read_2_beg, read_2_end;
+	bool rc;
+
+	o.get(read_1_idx, read_1_beg, read_1_end,
+	      read_2_idx, read_2_beg, read_2_end, rc);
+
+	assert(read_1_idx < bvv.size());
+	assert(read_2_idx < bvv.size());
+
+	const BaseVec & bv1 = bvv[read_1_idx];
+	const BaseVec & bv2 = bvv[read_2_idx];
+
+	assert_overlap_extents_valid(o, bv1.size(), bv2.size(), min_overlap_len);
+	assert_seed_valid(bv1, bv2, read_1_beg, read_2_beg,
+			  read_1_end - read_1_beg + 1, rc, "OVERLAP");
+}
+
+//
+// Checks an overlap as thoroughly as the verification level asks for: the
+// extents only at VERIFY_STRUCTURE, or the bases as well at VERIFY_FULL.
+//
+void verify_overlap(const Overlap & o, const BaseVecVec & bvv,
+		    const unsigned min_overlap_len,
+		    const unsigned max_edits)
+{
+	const verify_level level = get_verify_level();
+	if (level >= VERIFY_FULL) {
+		assert_overlap_valid(o, bvv, min_overlap_len, max_edits);
+	} else if (level >= VERIFY_STRUCTURE) {
+		Overlap::read_idx_t read_1_idx, read_2_idx;
+		o.get_indices(read_1_idx, read_2_idx);
+		assert(read_1_idx < bvv.size());
+		assert(read_2_idx < bvv.size());
+		assert_overlap_extents_valid(o, bvv[read_1_idx].size(),
+					     bvv[read_2_idx].size(),
+					     min_overlap_len);
 	}
 }
@@ -105,10 +105,15 @@ public:
 
 	bool is_rc() const { return (_rc != 0); }
 
+	// Return the number of bases in the overlap.
+	read_pos_t length() const
+	{
+		return _read_1_end - _read_1_beg + 1;
+	}
+
 	bool longer_than(const Overlap & other) const
 	{
-		return (_read_1_end - _read_1_beg) >
-			(other._read_1_end - other._read_1_end);
+		return length() > other.length();
 	}
 
 	friend std::ostream & operator<<(std::ostream & os, const Overlap & o)
@@ -170,6 +175,21 @@ public:
 		ar >> *this;
 	}
 
+	// Fill in @out with the overlaps that are at least @min_overlap_len
+	// bases long.  An overlap records its exact extent, so these are the
+	// overlaps that compute-overlaps finds with that minimum overlap length,
+	// as long as it is at least the one these overlaps were computed with.
+	void filter_by_length(const unsigned min_overlap_len,
+			      OverlapVecVec & out) const
+	{
+		out.clear();
+		out.resize(this->size());
+		for (size_t i = 0; i < this->size(); i++)
+			foreach(const Overlap & o, (*this)[i])
+				if (o.length() >= min_overlap_len)
+					out[i].insert(out[i].end(), o);
+	}
+
 	// Write the overlaps to a file.
 	void write(const char *filename)
 	{
@@ -190,6 +210,15 @@ extern void assert_seed_valid(const BaseVec & bv1,
 			      const bool is_rc,
 			      const char *description = "SEED");
 
+extern void assert_overlap_extents_valid(const Overlap & o,
+					 const unsigned read_1_len,
+					 const unsigned read_2_len,
+					 const unsigned min_overlap_len);
+
 extern void assert_overlap_valid(const Overlap & o, const BaseVecVec & bvv,
 				 const unsigned min_overlap_len,
 				 const unsigned max_edits);
+
+extern void verify_overlap(const Overlap & o, const BaseVecVec & bvv,
+			   const unsigned min_overlap_len,
+			   const unsigned max_edits);
@@ -0,0 +1,140 @@
+#include "PackedIntVec.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+
+const char PackedIntVec::magic[10] =
+	{'P', 'a', 'c', 'k', 'e', 'd', 'I', 'n', 't', '\0'};
+
+// Header at the beginning of a PackedIntVec file.  The packed entries follow
+// immediately after it.
+struct packed_int_vec_header {
+	char magic[10];
+	uint16_t bytes_per_entry;
+	uint32_t reserved;
+	uint64_t size;
+};
+
+void PackedIntVec::release()
+{
+	if (_map)
+		munmap(_map, _map_len);
+	else
+		free(_data);
+	_data = NULL;
+	_size = 0;
+	_map = NULL;
+	_map_len = 0;
+}
+
+void PackedIntVec::resize(size_t size, unsigned bytes_per_entry)
+{
+	assert(bytes_per_entry >= 1 && bytes_per_entry <= sizeof(value_type));
+	release();
+	_bytes_per_entry = bytes_per_entry;
+	_data = (unsigned char*)calloc(size ? size * bytes_per_entry : 1, 1);
+	if (!_data)
+		fatal_error("Out of memory");
+	_size = size;
+}
+
+// Memory-map a PackedIntVec from the file @filename, in which it begins
+// @offset bytes in.
+void PackedIntVec::read(const char *filename, size_t offset)
+{
+	release();
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		fatal_error_with_errno("Error opening \"%s\"", filename);
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+		fatal_error_with_errno("Error reading \"%s\"", filename);
+
+	const size_t file_len = st.st_size;
+	if (file_len < offset + sizeof(packed_int_vec_header))
+		fatal_error("\"%s\" is too short to be a packed integer file",
+			    filename);
+
+	void *map = mmap(NULL, file_len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		fatal_error_with_errno("Error memory-mapping \"%s\"", filename);
+	close(fd);
+
+	packed_int_vec_header hdr;
+	memcpy(&hdr, (const char*)map + offset, sizeof(hdr));
+	if (memcmp(hdr.magic, magic, sizeof(magic)) != 0)
+		fatal_error("\"%s\" is not a packed integer file", filename);
+	if (hdr.bytes_per_entry < 1 || hdr.bytes_per_entry > sizeof(value_type))
+		fatal_error("\"%s\": invalid entry size (%u)", filename,
+			    unsigned(hdr.bytes_per_entry));
+	if ((file_len - offset - sizeof(hdr)) / hdr.bytes_per_entry < hdr.size)
+		fatal_error("\"%s\" is truncated", filename);
+
+	_map = map;
+	_map_len = file_len;
+	_data = (unsigned char*)map + offset + sizeof(hdr);
+	_size = hdr.size;
+	_bytes_per_entry = hdr.bytes_per_entry;
+}
+
+void PackedIntVec::write_header(std::ostream & out, size_t size,
+				unsigned bytes_per_entry)
+{
+	packed_int_vec_header hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, magic, sizeof(magic));
+	hdr.bytes_per_entry = bytes_per_entry;
+	hdr.size = size;
+	out.write((const char*)&hdr, sizeof(hdr));
+}
+
+// Write this PackedIntVec to the file @filename.
+void PackedIntVec::write(const char *filename) const
+{
+	std::ofstream out(filename);
+	write(out);
+	out.close();
+	if (!out)
+		fatal_error_with_errno("Error writing to \"%s\"", filename);
+}
+
+void PackedIntVec::write(std::ostream & out) const
+{
+	write_header(out, _size, _bytes_per_entry);
+	out.write((const char*)_data, _size * _bytes_per_entry);
+}
+
+PackedIntVecWriter::PackedIntVecWriter(const char *filename, size_t size,
+				       unsigned bytes_per_entry)
+	: _out(filename), _filename(filename), _size(size), _num_written(0),
+	  _bytes_per_entry(bytes_per_entry), _buf_len(0)
+{
+	assert(bytes_per_entry >= 1 &&
+	       bytes_per_entry <= sizeof(PackedIntVec::value_type));
+	if (!_out)
+		fatal_error_with_errno("Error opening \"%s\"", filename);
+	PackedIntVec::write_header(_out, size, bytes_per_entry);
+}
+
+void PackedIntVecWriter::flush_buf()
+{
+	_out.write((const char*)_buf, _buf_len);
+	_buf_len = 0;
+}
+
+void PackedIntVecWriter::close()
+{
+	assert(_num_written == _size);
+	flush_buf();
+	_out.close();
+	if (!_out)
+		fatal_error_with_errno("Error writing to \"%s\"", _filename);
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "util.h"
+#include <fstream>
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// A vector of unsigned integers, each stored in a fixed number of bytes (1 to 8)
+// in little-endian order.
+//
+// On disk, a PackedIntVec is a short header followed by the packed integers
+// exactly as they are laid out in memory.  So when a PackedIntVec is read from a
+// file, the file is simply memory-mapped and the integers are used in place,
+// rather than being deserialized.
+//
+// The largest value representable in the chosen width, max_value(), is free to
+// be used by callers as a "no value" marker.
+//
+class PackedIntVec {
+public:
+	typedef uint64_t value_type;
+private:
+	static const char magic[10];
+
+	unsigned char *_data;
+	size_t _size;
+	unsigned _bytes_per_entry;
+
+	// Start and length of the memory-mapped file, if this PackedIntVec was
+	// read from a file; otherwise NULL and 0.
+	void *_map;
+	size_t _map_len;
+
+	void release();
+	static void write_header(std::ostream & out, size_t size,
+				 unsigned bytes_per_entry);
+	friend class PackedIntVecWriter;
+
+	PackedIntVec(const PackedIntVec &) = delete;
+	PackedIntVec & operator=(const PackedIntVec &) = delete;
+public:
+	PackedIntVec()
+		: _data(NULL), _size(0), _bytes_per_entry(0),
+		  _map(NULL), _map_len(0)
+	{ }
+
+	// Create a PackedIntVec of @size zeroes, each stored in
+	// @bytes_per_entry bytes.
+	PackedIntVec(size_t size, unsigned bytes_per_entry)
+		: _data(NULL), _size(0), _bytes_per_entry(0),
+		  _map(NULL), _map_len(0)
+	{
+		resize(size, bytes_per_entry);
+	}
+
+	// Memory-map a PackedIntVec from a file.
+	PackedIntVec(const char *filename)
+		: _data(NULL), _size(0), _bytes_per_entry(0),
+		  _map(NULL), _map_len(0)
+	{
+		read(filename);
+	}
+
+	~PackedIntVec() { release(); }
+
+	// Return the smallest number of bytes with which @value can be stored.
+	static unsigned bytes_needed(value_type value)
+	{
+		unsigned n = 1;
+		while (n < sizeof(value_type) && (value >> (8 * n)) != 0)
+			n++;
+		return n;
+	}
+
+	size_t size() const { return _size; }
+
+	unsigned bytes_per_entry() const { return _bytes_per_entry; }
+
+	// Return the largest value that can be stored in an entry.
+	value_type max_value() const
+	{
+		if (_bytes_per_entry == sizeof(value_type))
+			return ~value_type(0);
+		return (value_type(1) << (8 * _bytes_per_entry)) - 1;
+	}
+
+	value_type operator[](size_t idx) const
+	{
+		assert2(idx < _size);
+		const unsigned char *p = &_data[idx * _bytes_per_entry];
+		value_type v = 0;
+		for (unsigned i = 0; i < _bytes_per_entry; i++)
+			v |= value_type(p[i]) << (8 * i);
+		return v;
+	}
+
+	// Set entry @idx to @v.  Different entries may be set concurrently.
+	void set(size_t idx, value_type v)
+	{
+		assert2(idx < _size);
+		assert2(v <= max_value());
+		assert2(_map == NULL);
+		unsigned char *p = &_data[idx * _bytes_per_entry];
+		for (unsigned i = 0; i < _bytes_per_entry; i++)
+			p[i] = (unsigned char)(v >> (8 * i));
+	}
+
+	// Discard the current contents and make this a vector of @size zeroes
+	// of @bytes_per_entry bytes each.
+	void resize(size_t size, unsigned bytes_per_entry);
+
+	// Memory-map a PackedIntVec from the file @filename, in which it
+	// begins @offset bytes in, after a header of the caller's.
+	void read(const char *filename, size_t offset = 0);
+
+	void write(const char *filename) const;
+
+	// Write this PackedIntVec to the stream @out, which the caller must
+	// check for errors.
+	void write(std::ostream & out) const;
+};
+
+//
+// Writes a PackedIntVec file one entry at a time, so that a vector too large to
+// be worth holding in memory can be written as it is produced.  The number of
+// entries must be known in advance, since it goes in the header.
+//
+class PackedIntVecWriter {
+private:
+	std::ofstream _out;
+	const char *_filename;
+	size_t _size;
+	size_t _num_written;
+	unsigned _bytes_per_entry;
+	unsigned char _buf[65536];
+	size_t _buf_len;
+
+	void flush_buf();
+
+	PackedIntVecWriter(const PackedIntVecWriter &) = delete;
+	PackedIntVecWriter & operator=(const PackedIntVecWriter &) = delete;
+public:
+	// Start writing a PackedIntVec of @size entries of @bytes_per_entry
+	// bytes each to the file @filename.
+	PackedIntVecWriter(const char *filename, size_t size,
+			   unsigned bytes_per_entry);
+
+	size_t num_written() const { return _num_written; }
+
+	void push_back(PackedIntVec::value_type v)
+	{
+		assert2(_num_written < _size);
+		if (_buf_len + _bytes_per_entry > sizeof(_buf))
+			flush_buf();
+		for (unsigned i = 0; i < _bytes_per_entry; i++)
+			_buf[_buf_len++] = (unsigned char)(v >> (8 * i));
+		_num_written++;
+	}
+
+	// Finish writing the file.  All @size entries must have been written.
+	void close();
+};
@@ -1,15 +1,25 @@
 #pragma once
 
+#include <algorithm>
+#include <functional>
 #include <vector>
+#include <unordered_map>
 #include <boost/serialization/access.hpp>
+#include <boost/serialization/string.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include "util.h"
+#include "checksum.h"
+#include "parallel.h"
+#include "UnionFind.h"
 #include <fstream>
+#include <stdlib.h>
+#include <string>
 
 #include "Overlap.h"
 #include "BaseVecVec.h"
+#include "EdgeLabel.h"
 
 // Base class for edges of the string graph.
 class StringGraphEdge {
@@ -71,14 +81,15 @@ public:
 };
 
 // Base class for vertices of the string graph.
+//
+// The edges incident to each vertex are not stored in the vertex itself, but in
+// the adjacency structure of the StringGraph; see StringGraph::edge_indices().
 class StringGraphVertex {
 public:
 	// Unsigned integer type of an edge index.  This places one upper bound
 	// an the number of edges that can be in the graph.
-	typedef unsigned long edge_idx_t;
+	typedef unsigned int edge_idx_t;
 protected:
-	// vector of the indices of the edges that go out from this vertex.
-	std::vector<edge_idx_t> _edge_indices;
 	bool _is_special;
 
 	// Serialize or deserialize the vertex to/from a stream.
@@ -86,51 +97,55 @@ protected:
 	template <class Archive>
 	void serialize(Archive & ar, unsigned version)
 	{
-		ar & _edge_indices;
 		ar & _is_special;
 	}
 
 	StringGraphVertex() { _is_special = false; }
 public:
-	// Add a new edge index to the list of edge indices associated with this
-	// string graph vertex.
-	void add_edge_idx(const edge_idx_t edge_idx)
-	{
-		_edge_indices.push_back(edge_idx);
-	}
-
 	void set_special() { _is_special = true; }
 	bool is_special() const { return _is_special; }
+};
 
-	// Return a const reference to the vertex of edge indices of this string
-	// graph vertex.
-	const std::vector<edge_idx_t> & edge_indices() const
-	{
-		return _edge_indices;
-	}
+// A contiguous range of edge indices in the adjacency structure of a string
+// graph, such as the indices of the edges going out from one vertex.  It is
+// invalidated when the adjacency structure is changed.
+template <typename T>
+class EdgeIdxRange {
+private:
+	T *_begin;
+	T *_end;
+public:
+	typedef T * iterator;
+	typedef T * const_iterator;
 
-	// Return a reference to the vertex of edge indices of this string graph
-	// vertex.
-	std::vector<edge_idx_t> & edge_indices()
-	{
-		return _edge_indices;
-	}
+	EdgeIdxRange(T *begin, T *end) : _begin(begin), _end(end) { }
 
-	edge_idx_t first_edge_idx() const
-	{
-		assert2(_edge_indices.size() > 0);
-		return _edge_indices[0];
-	}
+	T * begin() const { return _begin; }
+	T * end() const { return _end; }
+	size_t size() const { return _end - _begin; }
+	bool empty() const { return _begin == _end; }
 
-	// Print the string graph vertex.
-	friend std::ostream & operator<<(std::ostream & os,
-					 const StringGraphVertex & v)
+	T & operator[](size_t i) const
 	{
-		os << "StringGraphVertex {_edge_indices = [";
-		foreach(edge_idx_t idx, v.edge_indices())
-			os << idx << ", ";
-		return os << "] }";
+		assert2(i < size());
+		return _begin[i];
 	}
+
+	T & front() const { return (*this)[0]; }
+	T & back() const { return (*this)[size() - 1]; }
+};
+
+// One end of a contained read that is to be mapped into a string graph.  The
+// end is located relative to the uncontained read that overlaps it with the
+// shortest overhang: it lies @overhang_len bases before the vertex of direction
+// @downstream_read_dir of the uncontained read @downstream_read_idx.  @weight
+// is the number of reads the contained read stands for: 1 unless the reads were
+// normalized.
+struct ContainedReadEnd {
+	unsigned downstream_read_idx;
+	unsigned downstream_read_dir;
+	BaseVec::size_type overhang_len;
+	float weight;
 };
 
 template<class VERTEX_t, class EDGE_t, class IMPL_t>
@@ -147,23 +162,144 @@ protected:
 	void add_edge_pair(const v_idx_t read_1_idx,
 			   const v_idx_t read_2_idx,
 			   const v_idx_t dirs,
-			   const BaseVec & bv1,
-			   const BaseVec::size_type beg_1,
-			   const BaseVec::size_type end_1,
-			   const bool bv1_rc,
-			   const BaseVec & bv2,
-			   const BaseVec::size_type beg_2,
-			   const BaseVec::size_type end_2,
-			   const bool bv2_rc)
+			   const EdgeLabel & label_1,
+			   const EdgeLabel & label_2)
 	{
 		static_cast<IMPL_t*>(this)->add_edge_pair(read_1_idx,
 							  read_2_idx,
 							  dirs,
-							  bv1, beg_1, end_1, bv1_rc,
-							  bv2, beg_2, end_2, bv2_rc);
+							  label_1, label_2);
 	}
 private:
 
+	// Return true iff one of the reads of the overlap @o is contained in the
+	// other.
+	static bool is_contained_overlap(const BaseVecVec & bvv, const Overlap & o)
+	{
+		Overlap::read_idx_t f_idx;
+		Overlap::read_pos_t f_beg;
+		Overlap::read_pos_t f_end;
+		Overlap::read_idx_t g_idx;
+		Overlap::read_pos_t g_beg;
+		Overlap::read_pos_t g_end;
+		bool rc;
+
+		o.get(f_idx, f_beg, f_end, g_idx, g_beg, g_end, rc);
+		return (f_beg == 0 && f_end == bvv[f_idx].size() - 1) ||
+		       (g_beg == 0 && g_end == bvv[g_idx].size() - 1);
+	}
+
+	//
+	// Select the overlaps for a best-overlap graph: for each read end, the
+	// @max_degree longest uncontained overlaps at that end.  An overlap is
+	// kept if it is among the best at either of the two read ends it joins,
+	// since its edges can only be added as a pair; so a read end may end up
+	// with more than @max_degree overlaps, but only through overlaps that
+	// the other read end chose.
+	//
+	// An uncontained overlap covers one end of each of its reads: the end,
+	// rather than the beginning, of a read exactly when it does not start at
+	// position 0 of it.  The overlaps at a read end are ranked by length,
+	// with ties broken by the index of the other read so that the ranking
+	// is total.
+	//
+	// The overlaps are scanned twice, in order.  The first pass keeps the
+	// keys of the best overlaps at each read end in a min-heap of
+	// @max_degree entries, so the memory used is proportional to the number
+	// of reads and not to the number of overlaps.  The second pass keeps
+	// each overlap whose key is at least the smallest key in the heap of
+	// either of its ends.  @keep is set for each overlap, in order.
+	//
+	void select_best_overlaps(const BaseVecVec & bvv, const OverlapVecVec & ovv,
+				  const unsigned max_degree,
+				  std::vector<bool> & keep) const
+	{
+		const size_t num_ends = bvv.size() * 2;
+		std::vector<uint64_t> best(num_ends * max_degree, 0);
+		std::vector<unsigned> num_overlaps_at_end(num_ends, 0);
+		size_t num_overlaps = 0;
+
+		foreach(const OverlapVecVec::OverlapSet & overlap_set, ovv) {
+			foreach(const Overlap & o, overlap_set) {
+				num_overlaps++;
+				if (is_contained_overlap(bvv, o))
+					continue;
+				Overlap::read_idx_t f_idx, g_idx;
+				Overlap::read_pos_t f_beg, f_end, g_beg, g_end;
+				bool rc;
+				o.get(f_idx, f_beg, f_end, g_idx, g_beg, g_end, rc);
+				const uint64_t len = f_end - f_beg + 1;
+				const size_t ends[2] = { 2 * size_t(f_idx) + (f_beg > 0),
+							 2 * size_t(g_idx) + (g_beg > 0) };
+				const uint64_t keys[2] = { (len << 32) | g_idx,
+							   (len << 32) | f_idx };
+				for (int i = 0; i < 2; i++) {
+					uint64_t *heap = &best[ends[i] * max_degree];
+					num_overlaps_at_end[ends[i]]++;
+					if (keys[i] <= heap[0])
+						continue;
+					std::pop_heap(heap, heap + max_degree,
+						      std::greater<uint64_t>());
+					heap[max_degree - 1] = keys[i];
+					std::push_heap(heap, heap + max_degree,
+						       std::greater<uint64_t>());
+				}
+			}
+		}
+
+		keep.assign(num_overlaps, false);
+		size_t num_uncontained = 0;
+		size_t num_kept = 0;
+		size_t num_kept_for_reciprocity = 0;
+		size_t i = 0;
+		foreach(const OverlapVecVec::OverlapSet & overlap_set, ovv) {
+			foreach(const Overlap & o, overlap_set) {
+				if (is_contained_overlap(bvv, o)) {
+					i++;
+					continue;
+				}
+				Overlap::read_idx_t f_idx, g_idx;
+				Overlap::read_pos_t f_beg, f_end, g_beg, g_end;
+				bool rc;
+				o.get(f_idx, f_beg, f_end, g_idx, g_beg, g_end, rc);
+				const uint64_t len = f_end - f_beg + 1;
+				const size_t f_end_idx = 2 * size_t(f_idx) + (f_beg > 0);
+				const size_t g_end_idx = 2 * size_t(g_idx) + (g_beg > 0);
+				const bool best_at_f =
+					((len << 32) | g_idx) >= best[f_end_idx * max_degree];
+				const bool best_at_g =
+					((len << 32) | f_idx) >= best[g_end_idx * max_degree];
+				num_uncontained++;
+				if (best_at_f || best_at_g) {
+					keep[i] = true;
+					num_kept++;
+					if (best_at_f != best_at_g)
+						num_kept_for_reciprocity++;
+				}
+				i++;
+			}
+		}
+
+		size_t num_pruned_ends = 0;
+		unsigned max_overlaps_at_end = 0;
+		foreach(const unsigned n, num_overlaps_at_end) {
+			if (n > max_degree)
+				num_pruned_ends++;
+			max_overlaps_at_end = std::max(max_overlaps_at_end, n);
+		}
+		info("Best-overlap mode: kept %zu of %zu uncontained overlaps "
+		     "(%.2f%%), pruned %zu", num_kept, num_uncontained,
+		     TO_PERCENT(num_kept, num_uncontained),
+		     num_uncontained - num_kept);
+		info("%zu kept overlaps were among the best %u at only one of "
+		     "their ends, and kept for reciprocity",
+		     num_kept_for_reciprocity, max_degree);
+		info("%zu of %zu read ends (%.2f%%) had more than %u overlaps "
+		     "(at most %u)", num_pruned_ends, num_ends,
+		     TO_PERCENT(num_pruned_ends, num_ends), max_degree,
+		     max_overlaps_at_end);
+	}
+
 	// Given an uncontained overlap and the read set from which it came, add
 	// the corresponding edge(s) to this string graph.
 	void add_edge_from_overlap(const BaseVecVec & bvv, const Overlap & o)
@@ -186,8 +322,7 @@ private:
 			//return;
 
 		// Skip contained overlaps
-		if ((f_beg == 0 && f_end == f.size() - 1)
-		    || (g_beg == 0 && g_end == g.size() - 1))
+		if (is_contained_overlap(bvv, o))
 			return;
 
 		//info("f_idx = %zu, g_idx = %zu, f_beg=%zu, f_end=%zu",
@@ -210,8 +345,8 @@ private:
 				assert2(f_beg > 0);
 				add_edge_pair(f_idx, g_idx,
 					      TAG_F_E | TAG_G_B,
-					      g, 0, g_beg - 1, true,
-					      f, 0, f_beg - 1, true);
+					      EdgeLabel(g_idx, 0, g_beg - 1, true),
+					      EdgeLabel(f_idx, 0, f_beg - 1, true));
 			} else {
 				/*
 				 *  f.B --------------> f.E
@@ -228,8 +363,8 @@ private:
 				assert2(f_beg > 0);
 				add_edge_pair(f_idx, g_idx,
 					      TAG_F_E | TAG_G_E,
-					      g, g_end + 1, g.size() - 1, false,
-					      f, 0, f_beg - 1, true);
+					      EdgeLabel(g_idx, g_end + 1, g.size() - 1, false),
+					      EdgeLabel(f_idx, 0, f_beg - 1, true));
 			}
 		} else {
 			if (rc) {
@@ -247,8 +382,8 @@ private:
 				assert2(f_end + 1 <= f.size() - 1);
 				add_edge_pair(f_idx, g_idx,
 					      TAG_F_B | TAG_G_E,
-					      g, g_end + 1, g.size() - 1, false,
-					      f, f_end + 1, f.size() - 1, false);
+					      EdgeLabel(g_idx, g_end + 1, g.size() - 1, false),
+					      EdgeLabel(f_idx, f_end + 1, f.size() - 1, false));
 			} else {
 
 				/*
@@ -266,8 +401,8 @@ private:
 				assert2(f_end + 1 <= f.size() - 1);
 				add_edge_pair(f_idx, g_idx,
 					      TAG_F_B | TAG_G_B,
-					      g, 0, g_beg - 1, true,
-					      f, f_end + 1, f.size() - 1, false);
+					      EdgeLabel(g_idx, 0, g_beg - 1, true),
+					      EdgeLabel(f_idx, f_end + 1, f.size() - 1, false));
 			}
 		}
 	}
@@ -279,6 +414,62 @@ protected:
 	// Vector of the graph's edges.
 	std::vector<EDGE_t> _edges;
 
+	// Adjacency lists of the vertices, in compressed sparse row form: the
+	// indices of the edges adjacent to vertex v_idx are
+	// _adj_edge_indices[_adj_offsets[v_idx]] up to (but not including)
+	// _adj_edge_indices[_adj_offsets[v_idx + 1]].  Which vertices an edge is
+	// adjacent to is decided by EDGE_t::get_adj_v_indices().
+	std::vector<edge_idx_t> _adj_offsets;
+	std::vector<edge_idx_t> _adj_edge_indices;
+
+	// The reads of the vertices, to which the edge labels that are read
+	// slices refer: read i is that of vertex i in a bidirected graph, or of
+	// vertices 2i and 2i + 1 in a directed graph.  When vertices are
+	// removed, so are their reads.  Once unbranched paths have been
+	// collapsed, no label refers to the reads, but those of the remaining
+	// vertices are kept as the first bases of the paths that start there.
+	//
+	// The reads are not written with the graph, but loaded again from the
+	// reads file the graph was built from.
+	BaseVecVec _reads;
+
+	// Absolute path of the reads file the graph was built from, or empty if
+	// the graph has no reads.
+	std::string _reads_file;
+
+	// Checksum of all the reads in the reads file, as computed by
+	// BaseVecVec::checksum(), to check that the file has not changed.
+	uint64_t _reads_checksum;
+
+	// Index in the reads file of each read in _reads, in increasing order.
+	std::vector<uint32_t> _read_file_indices;
+
+	// Index of the edges entering each vertex, in compressed sparse row
+	// form: the edges entering vertex v_idx are
+	// _back_edges[_back_edge_offsets[v_idx]] up to (but not including)
+	// _back_edges[_back_edge_offsets[v_idx + 1]].  Only built while
+	// contained reads are being mapped.  In a bidirected graph, the
+	// "vertices" are the ends of the vertices and the "edges" are the
+	// half-edges, as in the directed graph that it represents.
+	std::vector<edge_idx_t> _back_edge_offsets;
+	std::vector<edge_idx_t> _back_edges;
+
+	// Number of edges onto which an end of a contained read may map before
+	// it is thrown away as too ambiguous.
+	static const size_t MAX_MAPPED_EDGES = 100;
+
+	// Edges found by walking back from a vertex with a given overhang
+	// length.  An edge appears once for each path by which it was reached.
+	// If too many edges were found, @overflowed is set and @edges is empty.
+	struct back_walk_result {
+		std::vector<edge_idx_t> edges;
+		bool overflowed;
+	};
+
+	// Map from (vertex index, overhang length) to the result of walking back
+	// from that vertex with that overhang length.
+	typedef std::unordered_map<uint64_t, back_walk_result> back_walk_memo;
+
 public:
 	size_t _orig_num_reads;
 protected:
@@ -291,11 +482,45 @@ protected:
 		ar & _vertices;
 		ar & _edges;
 		ar & _orig_num_reads;
+		ar & _adj_offsets;
+		ar & _adj_edge_indices;
+		ar & _reads_file;
+		ar & _reads_checksum;
+		ar & _read_file_indices;
+	}
+
+	// Load _reads from the reads file, keeping only the reads listed in
+	// _read_file_indices.  The reads are streamed, so the reads of the
+	// vertices removed since the graph was built are never held in memory.
+	void load_reads()
+	{
+		release_reads();
+		if (_reads_file.empty())
+			return;
+		BaseVecVecReader reader(_reads_file.c_str());
+		_reads.reserve(_read_file_indices.size());
+		uint64_t sum = CHECKSUM_INIT;
+		size_t next = 0;
+		BaseVec bv;
+		for (size_t i = 0; reader.next(bv); i++) {
+			sum = bv.update_checksum(sum);
+			if (next < _read_file_indices.size() &&
+			    _read_file_indices[next] == i) {
+				_reads.push_back(bv);
+				next++;
+			} else {
+				bv.destroy();
+			}
+		}
+		if (sum != _reads_checksum || next != _read_file_indices.size())
+			fatal_error("Reads file \"%s\" has changed since the "
+				    "string graph was built from it",
+				    _reads_file.c_str());
 	}
 
 	// Constructor is protected--- use DirectedStringGraph or
 	// BidirectedStringGraph instead.
-	StringGraph() : _vertices(), _edges()
+	StringGraph() : _vertices(), _edges(), _reads_checksum(0)
 	{ }
 
 	// Return %true iff the edge structures are large enough to hold indices
@@ -306,36 +531,358 @@ protected:
 	}
 
 	// Add an edge to the vector of edges of this string graph and return
-	// its index.
+	// its index.  The edge is not added to the adjacency lists until
+	// index_new_edges() is called.
+	//
+	// An edge may appear twice in the adjacency lists, so the number of
+	// edges is limited to half of what an edge_idx_t can hold.
 	edge_idx_t push_back_edge(const EDGE_t & e)
 	{
-		if (_edges.size() >= std::numeric_limits<edge_idx_t>::max())
+		if (_edges.size() >= std::numeric_limits<edge_idx_t>::max() / 2)
 			fatal_error("Too many edges");
 		edge_idx_t edge_idx = _edges.size();
 		_edges.push_back(e);
 		return edge_idx;
 	}
 
+	// Add the edges with indices [@first_new_edge_idx, num_edges()) to the
+	// adjacency lists, after the edges already in each list, and extend the
+	// adjacency lists to any vertices that were added.
+	//
+	// This is done in two passes: first the new degree of each vertex is
+	// counted, then the new adjacency arrays are filled in.
+	void index_new_edges(const edge_idx_t first_new_edge_idx)
+	{
+		const size_t n_verts = num_vertices();
+		const size_t n_old_verts = (_adj_offsets.empty() ?
+					    0 : _adj_offsets.size() - 1);
+		std::vector<edge_idx_t> new_offsets(n_verts + 1, 0);
+		v_idx_t v_indices[2];
+
+		assert(n_old_verts <= n_verts);
+		for (v_idx_t v_idx = 0; v_idx < n_old_verts; v_idx++)
+			new_offsets[v_idx + 1] = degree(v_idx);
+		for (edge_idx_t i = first_new_edge_idx; i < num_edges(); i++) {
+			const unsigned n = _edges[i].get_adj_v_indices(v_indices);
+			for (unsigned j = 0; j < n; j++)
+				new_offsets[v_indices[j] + 1]++;
+		}
+		for (size_t v_idx = 0; v_idx < n_verts; v_idx++)
+			new_offsets[v_idx + 1] += new_offsets[v_idx];
+
+		std::vector<edge_idx_t> new_edge_indices(new_offsets[n_verts]);
+		std::vector<edge_idx_t> next(new_offsets.begin(),
+					     new_offsets.end() - 1);
+		for (v_idx_t v_idx = 0; v_idx < n_old_verts; v_idx++)
+			foreach (const edge_idx_t edge_idx, edge_indices(v_idx))
+				new_edge_indices[next[v_idx]++] = edge_idx;
+		for (edge_idx_t i = first_new_edge_idx; i < num_edges(); i++) {
+			const unsigned n = _edges[i].get_adj_v_indices(v_indices);
+			for (unsigned j = 0; j < n; j++)
+				new_edge_indices[next[v_indices[j]]++] = i;
+		}
+		_adj_offsets.swap(new_offsets);
+		_adj_edge_indices.swap(new_edge_indices);
+	}
+
+	// Set the read store of this string graph to a copy of that of
+	// @graph, along with the reads file it refers to.
+	template <class GRAPH_t>
+	void copy_reads(const GRAPH_t & graph)
+	{
+		const BaseVecVec & reads = graph.reads();
+		release_reads();
+		_reads.resize(reads.size());
+		for (size_t i = 0; i < reads.size(); i++)
+			_reads[i].set_from_bv(reads[i]);
+		_reads_file = graph.reads_file();
+		_reads_checksum = graph.reads_checksum();
+		_read_file_indices = graph.read_file_indices();
+	}
+
+	// Keep only the reads for which @keep_read(i) is %true, renumbering
+	// them in order.  Returns the map from old to new read indices, in
+	// which the removed reads map to ~0.
+	template <class KEEP_t>
+	std::vector<uint32_t> compact_reads(KEEP_t keep_read)
+	{
+		std::vector<uint32_t> old_to_new_read_indices(_reads.size(),
+							      ~uint32_t(0));
+		size_t new_n_reads = 0;
+		for (size_t i = 0; i < _reads.size(); i++) {
+			if (keep_read(i)) {
+				old_to_new_read_indices[i] = new_n_reads;
+				_reads[new_n_reads] = _reads[i];
+				_read_file_indices[new_n_reads++] =
+					_read_file_indices[i];
+			} else {
+				_reads[i].destroy();
+			}
+		}
+		_reads.resize(new_n_reads);
+		_read_file_indices.resize(new_n_reads);
+		return old_to_new_read_indices;
+	}
+
+	// Free the read store of this string graph.  All edge labels must have
+	// been materialized.
+	void release_reads()
+	{
+		BaseVecVec reads;
+		reads.swap(_reads);
+	}
+
+	// Build the adjacency lists from scratch.  Each vertex's edges are listed
+	// in order of edge index.
+	void rebuild_adjacency()
+	{
+		_adj_offsets.clear();
+		_adj_edge_indices.clear();
+		index_new_edges(0);
+	}
+
+	// After the edges have been compacted, renumber the adjacency lists
+	// according to @old_to_new_edge_indices, dropping the entries of edges
+	// that were removed (those that map to the maximum edge_idx_t).  The
+	// order of each list is preserved.
+	//
+	// This is done in parallel, in two passes like index_new_edges(): first
+	// the remaining degree of each vertex is counted, then the remaining
+	// entries are copied into new adjacency arrays.
+	void renumber_adjacency(const std::vector<edge_idx_t> & old_to_new_edge_indices)
+	{
+		const edge_idx_t NONE = std::numeric_limits<edge_idx_t>::max();
+		const size_t n_verts = _adj_offsets.size() - 1;
+		std::vector<edge_idx_t> new_offsets(n_verts + 1, 0);
+
+		#pragma omp parallel for schedule(dynamic, 4096)
+		for (size_t v_idx = 0; v_idx < n_verts; v_idx++) {
+			edge_idx_t n = 0;
+			foreach (const edge_idx_t edge_idx, edge_indices(v_idx))
+				if (old_to_new_edge_indices[edge_idx] != NONE)
+					n++;
+			new_offsets[v_idx + 1] = n;
+		}
+		for (size_t v_idx = 0; v_idx < n_verts; v_idx++)
+			new_offsets[v_idx + 1] += new_offsets[v_idx];
+
+		std::vector<edge_idx_t> new_edge_indices(new_offsets[n_verts]);
+		#pragma omp parallel for schedule(dynamic, 4096)
+		for (size_t v_idx = 0; v_idx < n_verts; v_idx++) {
+			edge_idx_t j = new_offsets[v_idx];
+			foreach (const edge_idx_t edge_idx, edge_indices(v_idx)) {
+				const edge_idx_t new_edge_idx =
+					old_to_new_edge_indices[edge_idx];
+				if (new_edge_idx != NONE)
+					new_edge_indices[j++] = new_edge_idx;
+			}
+		}
+		_adj_offsets.swap(new_offsets);
+		_adj_edge_indices.swap(new_edge_indices);
+	}
+
+	// Remove the vertices for which @remove_vertex is nonzero, which must
+	// have no edges left in their adjacency lists, and move the remaining
+	// vertices down so they are numbered in their original order.  The
+	// vertex indices stored in the edges are left for the caller to update.
+	void remove_vertices(const std::vector<unsigned char> & remove_vertex)
+	{
+		const size_t n_verts = num_vertices();
+		v_idx_t new_v_idx = 0;
+		for (v_idx_t v_idx = 0; v_idx < n_verts; v_idx++) {
+			if (remove_vertex[v_idx]) {
+				assert(degree(v_idx) == 0);
+			} else {
+				_adj_offsets[new_v_idx] = _adj_offsets[v_idx];
+				_vertices[new_v_idx++] = _vertices[v_idx];
+			}
+		}
+		_adj_offsets[new_v_idx] = _adj_offsets[n_verts];
+		_adj_offsets.resize(new_v_idx + 1);
+		_vertices.resize(new_v_idx);
+	}
+
 private:
+	// Compares edges by the length of their labels when traversed away
+	// from the vertex @v_idx.
 	class cmp_by_edge_length {
 	private:
 		const std::vector<EDGE_t> & _edges;
+		const v_idx_t _v_idx;
 	public:
-		cmp_by_edge_length(const std::vector<EDGE_t> & edges)
-			: _edges(edges) { }
+		cmp_by_edge_length(const std::vector<EDGE_t> & edges,
+				   const v_idx_t v_idx)
+			: _edges(edges), _v_idx(v_idx) { }
 
 		template <typename edge_idx_t>
 		bool operator()(edge_idx_t edge_idx_1, edge_idx_t edge_idx_2) const
 		{
-			return _edges[edge_idx_1].length() < _edges[edge_idx_2].length();
+			return _edges[edge_idx_1].length_from(_v_idx) <
+			       _edges[edge_idx_2].length_from(_v_idx);
 		}
 	};
 protected:
+	// Sort the adjacency list of each vertex by the length of the edges'
+	// labels when traversed away from the vertex.
 	void sort_adjlists_by_edge_len()
 	{
-		cmp_by_edge_length cmp(_edges);
-		foreach(VERTEX_t & v, _vertices)
-			std::sort(v.edge_indices().begin(), v.edge_indices().end(), cmp);
+		#pragma omp parallel for schedule(dynamic, 4096)
+		for (size_t v_idx = 0; v_idx < num_vertices(); v_idx++) {
+			cmp_by_edge_length cmp(_edges, v_idx);
+			EdgeIdxRange<edge_idx_t> r = edge_indices(v_idx);
+			std::sort(r.begin(), r.end(), cmp);
+		}
+	}
+
+	// Remove the edges for which @remove_edge is nonzero from this string
+	// graph, keeping the remaining edges in their original order, and
+	// update the adjacency lists.  @old_to_new_edge_indices is set to the
+	// map from old to new edge indices, in which removed edges map to the
+	// maximum edge_idx_t.  Returns the number of edges removed.
+	//
+	// The remaining edges are copied to a new vector in parallel.  Only the
+	// remaining edges are copied, and after a reduction they are usually a
+	// small fraction of the edges.
+	size_t remove_edges(const std::vector<unsigned char> & remove_edge,
+			    std::vector<edge_idx_t> & old_to_new_edge_indices)
+	{
+		const size_t n_edges = num_edges();
+		assert(remove_edge.size() == n_edges);
+		old_to_new_edge_indices.resize(n_edges);
+		const size_t num_remaining_edges =
+			parallel_compact_indices(n_edges,
+				[&](size_t i) { return !remove_edge[i]; },
+				[&](size_t i, size_t new_idx) {
+					old_to_new_edge_indices[i] =
+						(new_idx == ~size_t(0)) ?
+						std::numeric_limits<edge_idx_t>::max() :
+						new_idx;
+				});
+		{
+			std::vector<EDGE_t> new_edges(num_remaining_edges);
+			#pragma omp parallel for schedule(static, 65536)
+			for (size_t i = 0; i < n_edges; i++)
+				if (!remove_edge[i])
+					new_edges[old_to_new_edge_indices[i]] = _edges[i];
+			_edges.swap(new_edges);
+		}
+		renumber_adjacency(old_to_new_edge_indices);
+		return n_edges - num_remaining_edges;
+	}
+
+	// The weakly connected components of a string graph, ignoring its
+	// special vertices, in compressed sparse row form: the vertices of
+	// component c are vertices[vertex_offsets[c]] up to (but not including)
+	// vertices[vertex_offsets[c + 1]], in increasing order, and likewise
+	// for its edges.  A special edge belongs to the component of its
+	// non-special vertex.  local_v_indices[v_idx] is the position of the
+	// non-special vertex v_idx among the vertices of its component.
+	struct component_index {
+		std::vector<v_idx_t> vertex_offsets;
+		std::vector<v_idx_t> vertices;
+		std::vector<edge_idx_t> edge_offsets;
+		std::vector<edge_idx_t> edges;
+		std::vector<v_idx_t> local_v_indices;
+
+		size_t num_components() const { return vertex_offsets.size() - 1; }
+
+		v_idx_t num_vertices(size_t c) const
+		{
+			return vertex_offsets[c + 1] - vertex_offsets[c];
+		}
+
+		EdgeIdxRange<const edge_idx_t> edge_indices(size_t c) const
+		{
+			return EdgeIdxRange<const edge_idx_t>(&edges[edge_offsets[c]],
+							      &edges[edge_offsets[c + 1]]);
+		}
+	};
+
+	// Find the weakly connected components of this string graph, not
+	// counting the special vertices, which would join everything into one
+	// component.  The non-special edges are joined in a UnionFind in
+	// parallel; the components are then numbered in order of their lowest
+	// vertex, and their vertices and edges listed in index order.
+	void index_components(component_index & ci) const
+	{
+		const v_idx_t n_verts = num_vertices();
+		const edge_idx_t n_edges = num_edges();
+		UnionFind<v_idx_t> uf(n_verts);
+
+		#pragma omp parallel for schedule(static, 65536)
+		for (edge_idx_t edge_idx = 0; edge_idx < n_edges; edge_idx++) {
+			const EDGE_t & e = _edges[edge_idx];
+			if (!e.is_special()) {
+				v_idx_t v1_idx, v2_idx;
+				e.get_v_indices(v1_idx, v2_idx);
+				uf.unite(v1_idx, v2_idx);
+			}
+		}
+		#pragma omp parallel for schedule(static, 65536)
+		for (v_idx_t v_idx = 0; v_idx < n_verts; v_idx++)
+			uf.flatten(v_idx);
+
+		// Number the components by their roots, then give every vertex
+		// the number of its root's component.
+		std::vector<v_idx_t> & comp = ci.local_v_indices;
+		comp.assign(n_verts, 0);
+		const size_t n_comps = parallel_compact_indices(n_verts,
+			[&](size_t v_idx) {
+				return !_vertices[v_idx].is_special() &&
+				       uf.is_root(v_idx);
+			},
+			[&](size_t v_idx, size_t c) { comp[v_idx] = c; });
+		#pragma omp parallel for schedule(static, 65536)
+		for (v_idx_t v_idx = 0; v_idx < n_verts; v_idx++)
+			if (!uf.is_root(v_idx))
+				comp[v_idx] = comp[uf.parent(v_idx)];
+
+		ci.vertex_offsets.assign(n_comps + 1, 0);
+		ci.edge_offsets.assign(n_comps + 1, 0);
+		for (v_idx_t v_idx = 0; v_idx < n_verts; v_idx++)
+			if (!_vertices[v_idx].is_special())
+				ci.vertex_offsets[comp[v_idx] + 1]++;
+		for (edge_idx_t edge_idx = 0; edge_idx < n_edges; edge_idx++)
+			ci.edge_offsets[edge_component(comp, edge_idx) + 1]++;
+		for (size_t c = 0; c < n_comps; c++) {
+			ci.vertex_offsets[c + 1] += ci.vertex_offsets[c];
+			ci.edge_offsets[c + 1] += ci.edge_offsets[c];
+		}
+
+		ci.vertices.resize(ci.vertex_offsets[n_comps]);
+		ci.edges.resize(ci.edge_offsets[n_comps]);
+		{
+			std::vector<edge_idx_t> next(ci.edge_offsets.begin(),
+						     ci.edge_offsets.end() - 1);
+			for (edge_idx_t edge_idx = 0; edge_idx < n_edges; edge_idx++)
+				ci.edges[next[edge_component(comp, edge_idx)]++] = edge_idx;
+		}
+		{
+			// Overwrite each vertex's component number with its
+			// position in the component, now that it's no longer
+			// needed.
+			std::vector<v_idx_t> next(ci.vertex_offsets.begin(),
+						  ci.vertex_offsets.end() - 1);
+			for (v_idx_t v_idx = 0; v_idx < n_verts; v_idx++) {
+				if (!_vertices[v_idx].is_special()) {
+					const v_idx_t i = next[comp[v_idx]]++;
+					ci.vertices[i] = v_idx;
+					comp[v_idx] = i - ci.vertex_offsets[comp[v_idx]];
+				}
+			}
+		}
+	}
+private:
+	// Return the component, according to @comp, of the edge @edge_idx: that
+	// of its first non-special vertex.
+	v_idx_t edge_component(const std::vector<v_idx_t> & comp,
+			       const edge_idx_t edge_idx) const
+	{
+		v_idx_t v1_idx, v2_idx;
+		_edges[edge_idx].get_v_indices(v1_idx, v2_idx);
+		if (_vertices[v1_idx].is_special())
+			return comp[v2_idx];
+		return comp[v1_idx];
 	}
 public:
 
@@ -343,21 +890,64 @@ public:
 	std::vector<EDGE_t> & edges() { return _edges; }
 	const std::vector<EDGE_t> & edges() const { return _edges; }
 
+	// Return the read store of this string graph.
+	const BaseVecVec & reads() const { return _reads; }
+
+	// Return the reads file the read store was loaded from, the checksum
+	// of the reads in it, and the index in it of each read in the store.
+	const std::string & reads_file() const { return _reads_file; }
+	uint64_t reads_checksum() const { return _reads_checksum; }
+	const std::vector<uint32_t> & read_file_indices() const
+	{
+		return _read_file_indices;
+	}
+
 	// Return a reference to a vector of this string graph's vertices.
 	std::vector<VERTEX_t> & vertices() { return _vertices; }
 	const std::vector<VERTEX_t> & vertices() const { return _vertices; }
 
 	// Return the number of edges in this string graph.
-	edge_idx_t num_edges() const { return _edges.size(); }
+	size_t num_edges() const { return _edges.size(); }
 
 	// Return the number of vertices in this string graph.
-	v_idx_t num_vertices() const { return _vertices.size(); }
+	size_t num_vertices() const { return _vertices.size(); }
+
+	// Return the range of the indices of the edges adjacent to the vertex
+	// with index @v_idx.
+	EdgeIdxRange<const edge_idx_t> edge_indices(const v_idx_t v_idx) const
+	{
+		assert2(v_idx + 1 < _adj_offsets.size());
+		const edge_idx_t *p = _adj_edge_indices.data();
+		return EdgeIdxRange<const edge_idx_t>(p + _adj_offsets[v_idx],
+						      p + _adj_offsets[v_idx + 1]);
+	}
+
+	EdgeIdxRange<edge_idx_t> edge_indices(const v_idx_t v_idx)
+	{
+		assert2(v_idx + 1 < _adj_offsets.size());
+		edge_idx_t *p = _adj_edge_indices.data();
+		return EdgeIdxRange<edge_idx_t>(p + _adj_offsets[v_idx],
+						p + _adj_offsets[v_idx + 1]);
+	}
+
+	// Return the number of edges adjacent to the vertex with index @v_idx.
+	size_t degree(const v_idx_t v_idx) const
+	{
+		assert2(v_idx + 1 < _adj_offsets.size());
+		return _adj_offsets[v_idx + 1] - _adj_offsets[v_idx];
+	}
+
+	edge_idx_t first_edge_idx(const v_idx_t v_idx) const
+	{
+		assert2(degree(v_idx) > 0);
+		return _adj_edge_indices[_adj_offsets[v_idx]];
+	}
 
 	// Return the index of the edge f -> g, which must exist */
 	edge_idx_t locate_edge(const v_idx_t f_idx, const v_idx_t g_idx) const
 	{
 		assert(f_idx < num_vertices() && g_idx < num_vertices());
-		foreach(edge_idx_t edge_idx, _vertices[f_idx].edge_indices()) {
+		foreach(edge_idx_t edge_idx, edge_indices(f_idx)) {
 			assert(edge_idx < num_edges());
 			if (_edges[edge_idx].get_v2_idx() == g_idx)
 				return edge_idx;
@@ -370,9 +960,21 @@ public:
 	{
 		_edges.resize(0);
 		_vertices.resize(0);
+		_adj_offsets.resize(0);
+		_adj_edge_indices.resize(0);
+		release_reads();
+		_reads_file.clear();
+		_reads_checksum = 0;
+		_read_file_indices.clear();
 	}
 
 	// Read this string graph from a file.
+	//
+	// The file begins with 10 magic characters, followed by the checksum
+	// of the rest of the file.  If the verification level is
+	// VERIFY_CHECKSUM or higher, the checksum is computed as the graph is
+	// deserialized, so the file is only read once, and is checked before
+	// the graph is used.  The reads are then loaded from the reads file.
 	void read(const char *filename)
 	{
 		this->clear();
@@ -386,19 +988,60 @@ public:
 			// Need to throw exception because of AnyStringGraph.h
 			throw std::runtime_error("Invalid magic characters in graph file");
 		}
-		boost::archive::binary_iarchive ar(in);
-		ar >> *this;
-		static_cast<const IMPL_t*>(this)->assert_graph_valid();
+		uint64_t stored_sum;
+		in.read(reinterpret_cast<char*>(&stored_sum), sizeof(stored_sum));
+		if (!in)
+			fatal_error("Graph file \"%s\" is truncated", filename);
+		if (get_verify_level() >= VERIFY_CHECKSUM) {
+			// A corrupted file may fail to deserialize at all, in
+			// which case the checksum mismatch is reported instead.
+			checksum_istreambuf sum_buf(in.rdbuf());
+			std::istream sum_in(&sum_buf);
+			try {
+				boost::archive::binary_iarchive ar(sum_in);
+				ar >> *this;
+			} catch (...) {
+				if (sum_buf.checksum_to_end() != stored_sum)
+					fatal_error("Checksum mismatch in graph "
+						    "file \"%s\"", filename);
+				throw;
+			}
+			if (sum_buf.checksum_to_end() != stored_sum)
+				fatal_error("Checksum mismatch in graph file \"%s\"",
+					    filename);
+		} else {
+			boost::archive::binary_iarchive ar(in);
+			ar >> *this;
+		}
+		load_reads();
+		if (get_verify_level() >= VERIFY_STRUCTURE)
+			static_cast<const IMPL_t*>(this)->assert_graph_valid();
 	}
 
-	// Write this string graph to a file.
+	// Write this string graph to a file.  The checksum in the header is
+	// always filled in, so that the file can be checked when it is read.
 	void write(const char *filename) const
 	{
-		static_cast<const IMPL_t*>(this)->assert_graph_valid();
+		if (get_verify_level() >= VERIFY_STRUCTURE)
+			static_cast<const IMPL_t*>(this)->assert_graph_valid();
 		std::ofstream out(filename);
 		out.write(static_cast<const IMPL_t*>(this)->magic, 10);
-		boost::archive::binary_oarchive ar(out);
-		ar << *this;
+		uint64_t sum = 0;
+		out.write(reinterpret_cast<const char*>(&sum), sizeof(sum));
+		{
+			checksum_ostreambuf sum_buf(out.rdbuf());
+			std::ostream sum_out(&sum_buf);
+			{
+				boost::archive::binary_oarchive ar(sum_out);
+				ar << *this;
+			}
+			sum_out.flush();
+			if (!sum_out)
+				out.setstate(std::ios::badbit);
+			sum = sum_buf.checksum();
+		}
+		out.seekp(10);
+		out.write(reinterpret_cast<const char*>(&sum), sizeof(sum));
 		out.close();
 		if (!out)
 			fatal_error_with_errno("Error writing to \"%s\"", filename);
@@ -408,9 +1051,8 @@ public:
 	void print(std::ostream & os, const bool print_seqs) const
 	{
 		for (v_idx_t v_idx = 0; v_idx < _vertices.size(); v_idx++) {
-			const VERTEX_t & v = _vertices[v_idx];
-			foreach(const edge_idx_t edge_idx, v.edge_indices()) {
-				_edges[edge_idx].print(os, v_idx, print_seqs);
+			foreach(const edge_idx_t edge_idx, edge_indices(v_idx)) {
+				_edges[edge_idx].print(os, v_idx, print_seqs, &_reads);
 				os << '\n';
 			}
 		}
@@ -433,21 +1075,49 @@ public:
 			_vertices[v_idx].print_dot(os, v_idx);
 
 		for (v_idx_t v_idx = 0; v_idx < _vertices.size(); v_idx++)
-			foreach(edge_idx_t edge_idx, _vertices[v_idx].edge_indices())
-				_edges[edge_idx].print_dot(os, v_idx, print_seqs);
+			foreach(edge_idx_t edge_idx, edge_indices(v_idx))
+				_edges[edge_idx].print_dot(os, v_idx, print_seqs, &_reads);
 		os << "}" << std::endl;
 	}
 
 	// Builds this string graph from a set of reads and their overlaps.
-	void build(const BaseVecVec & bvv, const OverlapVecVec & ovv)
+	//
+	// If @max_degree is nonzero, a best-overlap graph is built instead,
+	// from only the overlaps chosen by select_best_overlaps(), which bounds
+	// the degree of the vertices of repeats.
+	//
+	// The edge labels refer to the reads, so the reads are moved into the
+	// graph, leaving @bvv empty.  They must be those of the reads file
+	// @reads_file, which the graph refers to in order to load them again
+	// when it is read from a file.
+	void build(BaseVecVec & bvv, const OverlapVecVec & ovv,
+		   const char *reads_file, const unsigned max_degree = 0)
 	{
 		assert(bvv.size() == ovv.size());
+		std::vector<bool> keep;
+		if (max_degree != 0)
+			select_best_overlaps(bvv, ovv, max_degree, keep);
+		size_t i = 0;
 		foreach(const OverlapVecVec::OverlapSet & overlap_set, ovv) {
 			foreach(const Overlap & o, overlap_set) {
-				assert_overlap_valid(o, bvv, 1, 0);
-				add_edge_from_overlap(bvv, o);
+				verify_overlap(o, bvv, 1, 0);
+				if (max_degree == 0 || keep[i])
+					add_edge_from_overlap(bvv, o);
+				i++;
 			}
 		}
+		rebuild_adjacency();
+		release_reads();
+		_reads.swap(bvv);
+		char *path = realpath(reads_file, NULL);
+		if (!path)
+			fatal_error_with_errno("Error resolving \"%s\"", reads_file);
+		_reads_file = path;
+		free(path);
+		_reads_checksum = _reads.checksum(_reads.size());
+		_read_file_indices.resize(_reads.size());
+		for (size_t i = 0; i < _reads.size(); i++)
+			_read_file_indices[i] = i;
 		info("String graph has %zu vertices and %zu edges",
 		     num_vertices(), num_edges());
 		info("Average of %.2f edges per vertex",
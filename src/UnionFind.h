@@ -0,0 +1,79 @@
+#pragma once
+
+#include "compiler.h"
+#include <algorithm>
+#include <vector>
+
+//
+// A union-find (disjoint-set) structure over the integers [0, n) whose
+// operations may all be called concurrently from multiple threads.
+//
+// Roots are always linked under the root with the smaller index, so no cycle
+// can be formed however the links made by different threads interleave, and
+// find() halves the path it walks.  A stale parent read by another thread only
+// makes its walk longer, since parents only ever move towards the root.
+//
+template <typename T>
+class UnionFind {
+private:
+	std::vector<T> _parent;
+public:
+	UnionFind(T n) : _parent(n)
+	{
+		#pragma omp parallel for
+		for (T i = 0; i < n; i++)
+			_parent[i] = i;
+	}
+
+	T size() const { return _parent.size(); }
+
+	// Return the root of the set containing @i.
+	T find(T i)
+	{
+		for (;;) {
+			const T parent = __atomic_load_n(&_parent[i],
+							 __ATOMIC_RELAXED);
+			if (parent == i)
+				return i;
+			const T grandparent = __atomic_load_n(&_parent[parent],
+							      __ATOMIC_RELAXED);
+			if (grandparent != parent)
+				cas(&_parent[i], parent, grandparent);
+			i = grandparent;
+		}
+	}
+
+	// Join the sets containing @i and @j.  A failed compare-and-swap means
+	// the root was linked by another thread, so the roots are looked up
+	// again.
+	void unite(T i, T j)
+	{
+		for (;;) {
+			i = find(i);
+			j = find(j);
+			if (i == j)
+				return;
+			if (i < j)
+				std::swap(i, j);
+			if (cas_bool(&_parent[i], i, j))
+				return;
+		}
+	}
+
+	// Point @i directly at its root and return the root.  Once no more sets
+	// are being joined, this may be called for every element in parallel so
+	// that each parent is its root.
+	T flatten(T i)
+	{
+		const T root = find(i);
+		__atomic_store_n(&_parent[i], root, __ATOMIC_RELAXED);
+		return root;
+	}
+
+	// Return %true iff @i is the root of its set.
+	bool is_root(T i) const { return _parent[i] == i; }
+
+	// Return the parent of @i, which is its root once it has been
+	// flattened.
+	T parent(T i) const { return _parent[i]; }
+};
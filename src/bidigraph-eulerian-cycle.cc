@@ -1,7 +1,9 @@
 #include "BidirectedStringGraph.h"
+#include <getopt.h>
 
 DEFINE_USAGE(
-"Usage: bidigraph-eulerian-cycle BIDIGRAPH_FILE OUT_CYCLE_FILE\n"
+"Usage: bidigraph-eulerian-cycle [--verify=LEVEL]\n"
+"                                BIDIGRAPH_FILE OUT_CYCLE_FILE\n"
 "\n"
 "Finds an Eulerian cycle in a bidirected graph.\n"
 "\n"
@@ -9,27 +11,40 @@ DEFINE_USAGE(
 "      BIDIGRAPH_FILE:   A bidirected string graph in binary format.\n"
 "\n"
 "Output:\n"
-"      OUT_CYCLE_FILE:  The resulting Eulerian cycle as a vector of edge\n"
-"                       indices (in binary format)\n"
+"      OUT_CYCLE_FILE:  The resulting Eulerian cycle as a packed vector of\n"
+"                       half-edge indices, written as the cycle is found.\n"
+"                       Half-edge 2i traverses edge i from its first\n"
+"                       vertex to its second, and half-edge 2i + 1 the\n"
+"                       other way.\n"
+"\n"
+"Options:\n"
+VERIFY_USAGE
 );
 
+static const char *optstring = "h";
+static const struct option longopts[] = {
+	END_LONGOPTS
+};
+
 int main(int argc, char *argv[])
 {
-	USAGE_IF(argc != 3);
-	info("Loading bidirected graph graph from \"%s\"", argv[1]);
-	BidirectedStringGraph graph(argv[1]);
-
-	std::vector<size_t> cycle;
+	int c;
+	for_opt(c) {
+		switch (c) {
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 2);
+	info("Loading bidirected graph graph from \"%s\"", argv[0]);
+	BidirectedStringGraph graph(argv[0]);
 
-	graph.eulerian_cycle(cycle);
+	info("Writing Eulerian cycle to \"%s\"", argv[1]);
+	graph.eulerian_cycle(argv[1]);
 
-	info("Writing Eulerian cycle to \"%s\"", argv[2]);
-	{
-		std::ofstream out(argv[2]);
-		boost::archive::binary_oarchive ar(out);
-		ar << cycle;
-		out.close();
-		if (!out)
-			fatal_error_with_errno("Error writing to \"%s\"", argv[2]);
+	if (get_verify_level() >= VERIFY_STRUCTURE) {
+		const PackedIntVec cycle(argv[1]);
+		graph.assert_eulerian_cycle_valid(cycle);
 	}
 }
@@ -1,9 +1,10 @@
 #include "BidirectedStringGraph.h"
 #include "DirectedStringGraph.h"
 #include "util.h"
+#include <getopt.h>
 
 DEFINE_USAGE(
-"Usage: bidigraph-to-digraph BIDIGRAPH_FILE OUT_DIGRAPH_FILE\n"
+"Usage: bidigraph-to-digraph [--verify=LEVEL] BIDIGRAPH_FILE OUT_DIGRAPH_FILE\n"
 "\n"
 "Turns a bidirected string graph into a directed string graph.\n"
 "\n"
@@ -12,18 +13,34 @@ DEFINE_USAGE(
 "\n"
 "Output:\n"
 "      OUT_DIGRAPH_FILE:  A directed string graph in binary format.\n"
+"\n"
+"Options:\n"
+VERIFY_USAGE
 );
 
+static const char *optstring = "h";
+static const struct option longopts[] = {
+	END_LONGOPTS
+};
+
 int main(int argc, char *argv[])
 {
-	USAGE_IF(argc != 3);
-	info("Loading bidirected string graph from \"%s\"", argv[1]);
-	BidirectedStringGraph bidigraph(argv[1]);
+	int c;
+	for_opt(c) {
+		switch (c) {
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 2);
+	info("Loading bidirected string graph from \"%s\"", argv[0]);
+	BidirectedStringGraph bidigraph(argv[0]);
 
 	DirectedStringGraph digraph(bidigraph.num_vertices());
 
 	digraph.build_from_bidigraph(bidigraph);
 
-	info("Writing directed string graph to \"%s\"", argv[2]);
-	digraph.write(argv[2]);
+	info("Writing directed string graph to \"%s\"", argv[1]);
+	digraph.write(argv[1]);
 }
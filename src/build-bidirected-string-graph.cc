@@ -1,28 +1,59 @@
 #include "Overlap.h"
 #include "BaseVecVec.h"
 #include "BidirectedStringGraph.h"
+#include <getopt.h>
 
 DEFINE_USAGE(
-"Usage: build-bidirected-string-graph READS_FILE OVERLAPS_FILE BIDIGRAPH_FILE\n"
+"Usage: build-bidirected-string-graph [--max-degree=N] [--verify=LEVEL]\n"
+"                                     READS_FILE OVERLAPS_FILE BIDIGRAPH_FILE\n"
 "\n"
 "Builds a bidirected string graph.\n"
 "\n"
 "Input:\n"
 "      READS_FILE:      The set of reads from which the overlaps were\n"
-"                       computed.\n"
+"                       computed.  The graph refers to this file rather\n"
+"                       than storing the reads, so it must be kept, and\n"
+"                       not changed, for as long as the graph and the\n"
+"                       graphs made from it are used.\n"
 "      OVERLAPS_FILE:   The overlaps between the reads.\n"
 "\n"
 "Output:\n"
 "      BIDIGRAPH_FILE:  File containing the bidirected string graph\n"
 "                       in binary format.\n"
+"\n"
+"Options:\n"
+"   --max-degree=N     Build a best-overlap graph: keep only the N longest\n"
+"                      overlaps at each end of each read, plus the overlaps\n"
+"                      that the read at their other end kept.  This bounds\n"
+"                      the number of edges at the vertices of repeats.\n"
+"                      Default: 0 (keep all overlaps).\n"
+VERIFY_USAGE
 );
 
+static const char *optstring = "h";
+static const struct option longopts[] = {
+	{"max-degree", required_argument, NULL, 'd'},
+	END_LONGOPTS
+};
+
 int main(int argc, char *argv[])
 {
-	USAGE_IF(argc != 4);
-	const char *reads_file = argv[1];
-	const char *overlaps_file = argv[2];
-	const char *graph_file = argv[3];
+	int c;
+	unsigned max_degree = 0;
+	for_opt(c) {
+		switch (c) {
+		case 'd':
+			max_degree = parse_long(optarg, "--max-degree", 0, 1000);
+			break;
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 3);
+	const char *reads_file = argv[0];
+	const char *overlaps_file = argv[1];
+	const char *graph_file = argv[2];
 
 	info("Reading reads from \"%s\"", reads_file);
 	BaseVecVec bvv(reads_file);
@@ -32,15 +63,15 @@ int main(int argc, char *argv[])
 	OverlapVecVec ovv(overlaps_file);
 	info("Done loading overlaps");
 
+	assert(ovv.size() == bvv.size());
+
 	BidirectedStringGraph graph(bvv.size());
 
 	info("Building bidirected string graph from overlaps");
-	graph.build(bvv, ovv);
+	graph.build(bvv, ovv, reads_file, max_degree);
 
 	info("Writing bidirected string graph to \"%s\"", graph_file);
 	graph.write(graph_file);
 
-	assert(ovv.size() == bvv.size());
-
 	info("Done");
 }
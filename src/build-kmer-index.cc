@@ -0,0 +1,102 @@
+#include "KmerIndex.h"
+#include <getopt.h>
+
+DEFINE_USAGE(
+"Usage: build-kmer-index [OPTIONS] READS_FILE INDEX_FILE\n"
+"\n"
+"Builds the index of every occurrence of every k-mer in a set of reads, sorted\n"
+"by k-mer, from which compute-overlaps --kmer-index seeds overlaps without\n"
+"indexing the reads itself.  The index can be reused for any minimum overlap\n"
+"length of at least K, and is memory-mapped when it is used.\n"
+"\n"
+"Input:\n"
+"      READS_FILE:  FASTQ, FASTA, or binary reads (BaseVecVec) file.  The\n"
+"                   index records its checksum, and can only be used with\n"
+"                   these same reads.\n"
+"\n"
+"Output:\n"
+"      INDEX_FILE:  File to write the k-mer index to.\n"
+"\n"
+"Options:\n"
+"   -k, --kmer-len=K   Length of the k-mers: 4, 8, 16, 24, 32, 40, 48, 64, 96\n"
+"                      or 128.  Default: 24.\n"
+"   -h, --help\n"
+VERIFY_USAGE
+);
+
+static const char *optstring = "k:h";
+static const struct option longopts[] = {
+	{"kmer-len", required_argument, NULL, 'k'},
+	END_LONGOPTS
+};
+
+template <unsigned K>
+static void build_kmer_index(const BaseVecVec & bvv, const char *index_file)
+{
+	info("Indexing the %u-mers of %zu reads", K, bvv.size());
+	std::vector<KmerIndexEntry<K> > entries;
+	KmerIndex<K>::collect_entries(bvv, 0, entries);
+	info("Indexed %zu %u-mer occurrences", entries.size(), K);
+
+	info("Writing %u-mer index to \"%s\"", K, index_file);
+	KmerIndex<K>::write(index_file, bvv,
+			    entries.data(), entries.data() + entries.size(),
+			    NULL, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	int c;
+	unsigned kmer_len = 24;
+	for_opt(c) {
+		switch (c) {
+		case 'k':
+			kmer_len = parse_long(optarg, "--kmer-len", 4, 128);
+			break;
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 2);
+
+	info("Loading reads from \"%s\"", argv[0]);
+	const BaseVecVec bvv(argv[0]);
+	info("Loaded %zu reads from \"%s\"", bvv.size(), argv[0]);
+
+	switch (kmer_len) {
+	case 4:
+		build_kmer_index<4>(bvv, argv[1]);
+		break;
+	case 8:
+		build_kmer_index<8>(bvv, argv[1]);
+		break;
+	case 16:
+		build_kmer_index<16>(bvv, argv[1]);
+		break;
+	case 24:
+		build_kmer_index<24>(bvv, argv[1]);
+		break;
+	case 32:
+		build_kmer_index<32>(bvv, argv[1]);
+		break;
+	case 40:
+		build_kmer_index<40>(bvv, argv[1]);
+		break;
+	case 48:
+		build_kmer_index<48>(bvv, argv[1]);
+		break;
+	case 64:
+		build_kmer_index<64>(bvv, argv[1]);
+		break;
+	case 96:
+		build_kmer_index<96>(bvv, argv[1]);
+		break;
+	case 128:
+		build_kmer_index<128>(bvv, argv[1]);
+		break;
+	default:
+		fatal_error("Unsupported k-mer length %u (expected 4, 8, 16, 24, "
+			    "32, 40, 48, 64, 96 or 128)", kmer_len);
+	}
+}
@@ -1,7 +1,8 @@
 #include "AnyStringGraph.h"
+#include <getopt.h>
 
 DEFINE_USAGE(
-"calculate-A-statistics GRAPH_FILE OUT_GRAPH_FILE\n"
+"calculate-A-statistics [--verify=LEVEL] GRAPH_FILE OUT_GRAPH_FILE\n"
 "\n"
 "Calculate the A-statistic (arrival rate statistic) on each edge in\n"
 "a string graph.\n"
@@ -11,13 +12,29 @@ DEFINE_USAGE(
 "\n"
 "Output:\n"
 "      OUT_GRAPH_FILE:  The string graph with the A-statistics calculated.\n"
+"\n"
+"Options:\n"
+VERIFY_USAGE
 );
 
+static const char *optstring = "h";
+static const struct option longopts[] = {
+	END_LONGOPTS
+};
+
 int main(int argc, char **argv)
 {
-	USAGE_IF(argc != 3);
-	const char *graph_file = argv[1];
-	const char *out_graph_file = argv[2];
+	int c;
+	for_opt(c) {
+		switch (c) {
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 2);
+	const char *graph_file = argv[0];
+	const char *out_graph_file = argv[1];
 
 	info("Loading \"%s\"", graph_file);
 	AnyStringGraph graph(graph_file);
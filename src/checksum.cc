@@ -0,0 +1,52 @@
+#include "checksum.h"
+
+/* Passes the buffered data through to the destination, adding it to the
+ * checksum.  Returns false on error. */
+bool checksum_ostreambuf::flush_buf()
+{
+	const std::streamsize n = pptr() - pbase();
+	if (n == 0)
+		return true;
+	_sum = checksum_update(_sum, pbase(), n);
+	setp(_buf, _buf + sizeof(_buf));
+	return _dest->sputn(_buf, n) == n;
+}
+
+checksum_ostreambuf::int_type checksum_ostreambuf::overflow(int_type c)
+{
+	if (!flush_buf())
+		return traits_type::eof();
+	if (!traits_type::eq_int_type(c, traits_type::eof())) {
+		*pptr() = traits_type::to_char_type(c);
+		pbump(1);
+	}
+	return traits_type::not_eof(c);
+}
+
+int checksum_ostreambuf::sync()
+{
+	if (!flush_buf())
+		return -1;
+	return _dest->pubsync();
+}
+
+/* Reads the next block of data from the source, adding it to the checksum. */
+checksum_istreambuf::int_type checksum_istreambuf::underflow()
+{
+	if (gptr() < egptr())
+		return traits_type::to_int_type(*gptr());
+	const std::streamsize n = _src->sgetn(_buf, sizeof(_buf));
+	if (n <= 0)
+		return traits_type::eof();
+	_sum = checksum_update(_sum, _buf, n);
+	setg(_buf, _buf, _buf + n);
+	return traits_type::to_int_type(*gptr());
+}
+
+uint64_t checksum_istreambuf::checksum_to_end()
+{
+	setg(_buf, egptr(), egptr());
+	while (!traits_type::eq_int_type(underflow(), traits_type::eof()))
+		setg(_buf, egptr(), egptr());
+	return _sum;
+}
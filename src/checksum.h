@@ -0,0 +1,73 @@
+#pragma once
+
+#include <streambuf>
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// 64-bit FNV-1a checksums of files, or of the data written or read through a
+// stream.
+//
+
+static const uint64_t CHECKSUM_INIT = 0xcbf29ce484222325ULL;
+
+// Update the checksum @sum with the @n bytes at @p.
+static inline uint64_t checksum_update(uint64_t sum, const void *p, size_t n)
+{
+	const unsigned char *bytes = static_cast<const unsigned char *>(p);
+	for (size_t i = 0; i < n; i++) {
+		sum ^= bytes[i];
+		sum *= 0x100000001b3ULL;
+	}
+	return sum;
+}
+
+//
+// A stream buffer that passes the data written to it through to another stream
+// buffer, keeping a checksum of it.
+//
+class checksum_ostreambuf : public std::streambuf {
+private:
+	std::streambuf *_dest;
+	uint64_t _sum;
+	char _buf[65536];
+
+	bool flush_buf();
+protected:
+	virtual int_type overflow(int_type c);
+	virtual int sync();
+public:
+	checksum_ostreambuf(std::streambuf *dest)
+		: _dest(dest), _sum(CHECKSUM_INIT)
+	{
+		setp(_buf, _buf + sizeof(_buf));
+	}
+
+	~checksum_ostreambuf() { sync(); }
+
+	// Return the checksum of all the data written so far.  The data must
+	// have been flushed first.
+	uint64_t checksum() const { return _sum; }
+};
+
+//
+// A stream buffer that passes the data read from another stream buffer through
+// to its reader, keeping a checksum of it.
+//
+class checksum_istreambuf : public std::streambuf {
+private:
+	std::streambuf *_src;
+	uint64_t _sum;
+	char _buf[65536];
+protected:
+	virtual int_type underflow();
+public:
+	checksum_istreambuf(std::streambuf *src)
+		: _src(src), _sum(CHECKSUM_INIT)
+	{
+		setg(_buf, _buf, _buf);
+	}
+
+	// Read the rest of the data, and return the checksum of all of it.
+	uint64_t checksum_to_end();
+};
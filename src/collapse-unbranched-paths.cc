@@ -1,7 +1,8 @@
 #include "AnyStringGraph.h"
+#include <getopt.h>
 
 DEFINE_USAGE(
-"Usage: collapse-unbranched-paths GRAPH_FILE OUT_GRAPH_FILE\n"
+"Usage: collapse-unbranched-paths [--verify=LEVEL] GRAPH_FILE OUT_GRAPH_FILE\n"
 "\n"
 "Collapse unbranched paths in a string graph.\n"
 "\n"
@@ -10,14 +11,30 @@ DEFINE_USAGE(
 "\n"
 "Output:\n"
 "      OUT_GRAPH_FILE:  The graph with unbranched paths collapsed.\n"
+"\n"
+"Options:\n"
+VERIFY_USAGE
 );
 
+static const char *optstring = "h";
+static const struct option longopts[] = {
+	END_LONGOPTS
+};
+
 int main(int argc, char *argv[])
 {
-	USAGE_IF(argc != 3);
-	info("Loading string graph from \"%s\"", argv[1]);
-	AnyStringGraph graph(argv[1]);
+	int c;
+	for_opt(c) {
+		switch (c) {
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 2);
+	info("Loading string graph from \"%s\"", argv[0]);
+	AnyStringGraph graph(argv[0]);
 	graph.collapse_unbranched_paths();
-	info("Writing string graph to \"%s\"", argv[2]);
-	graph.write(argv[2]);
+	info("Writing string graph to \"%s\"", argv[1]);
+	graph.write(argv[1]);
 }
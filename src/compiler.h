@@ -47,3 +47,18 @@ static inline T atomic_set(volatile T *ptr, T nval) {
 	/* gcc builtin */
 	return __sync_lock_test_and_set(ptr, nval);
 }
+
+/*
+ * Atomically adds @val to the value at @ptr, which need not be an integer (for
+ * example, it may be a float or double).
+ */
+template<typename T>
+static inline void atomic_add(T *ptr, T val) {
+	T oval, nval;
+	/* gcc builtins */
+	__atomic_load(ptr, &oval, __ATOMIC_RELAXED);
+	do {
+		nval = oval + val;
+	} while (!__atomic_compare_exchange(ptr, &oval, &nval, true,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
@@ -1,7 +1,7 @@
 #include "BaseVecVec.h"
 #include "Overlap.h"
 #include <getopt.h>
-#include "Kmer.h"
+#include "KmerIndex.h"
 
 #if __cplusplus >= 201103L
 #include <unordered_map>
@@ -12,53 +12,9 @@
 #endif
 
 #include <ostream>
-
-// Stores the location of a k-mer in the read set.
-class KmerOccurrence {
-private:
-	// Index of the read containing the k-mer sequence
-	unsigned long _read_id	: 32;
-
-	// Position of the k-mer within the read (0-indexed)
-	unsigned long _read_pos	: 31;
-
-	// Whether the canonical k-mer is reverse-complement
-	unsigned long _rc	: 1;
-public:
-
-	static const unsigned long long MAX_READ_IDX = ((1ULL << 32) - 1);
-	static const unsigned long long MAX_READ_POS = ((1ULL << 31) - 1);
-
-	KmerOccurrence(unsigned long read_id, unsigned long read_pos, bool rc)
-		: _read_id(read_id), _read_pos(read_pos), _rc(rc)
-	{ }
-
-	unsigned long get_read_id() const { return _read_id; }
-
-	void swap_reads(KmerOccurrence & other) {
-		unsigned long tmp;
-		tmp = _read_id;
-		_read_id = other._read_id;
-		other._read_id = tmp;
-		tmp = _read_pos;
-		_read_pos = other._read_pos;
-		other._read_pos = tmp;
-	}
-
-	unsigned long get_read_pos() const { return _read_pos; }
-
-	bool is_rc() const { return _rc; }
-	void flip_rc() { _rc = !_rc; }
-
-	friend std::ostream & operator<<(std::ostream & os, const KmerOccurrence & occ)
-	{
-		return os << "KmerOccurrence { _read_id: " << occ._read_id <<
-			", _read_pos: " << occ._read_pos <<
-			", _rc: " <<occ._rc << "}";
-	}
-};
-
-
+#include <stdio.h>
+#include <string>
+#include <unistd.h>
 
 //
 // Given a seed (an exactly matching sequence of bases of length @len, allowing
@@ -72,7 +28,8 @@ static void extend_seed(const BaseVec & bv1,
 			unsigned & len,
 			const bool is_rc)
 {
-	assert_seed_valid(bv1, bv2, pos1, pos2, len, is_rc);
+	if (get_verify_level() >= VERIFY_FULL)
+		assert_seed_valid(bv1, bv2, pos1, pos2, len, is_rc);
 	if (is_rc) {
 		unsigned max_left_extend = std::min(pos1, bv2.size() - (pos2 + len));
 		unsigned left_extend = 0;
@@ -229,24 +186,36 @@ static bool find_overlap(const BaseVecVec & bvv,
 // k-mer that has occurrences in the vector @occs.  Non-duplicate overlaps are
 // added to the vector @ovv.
 //
+// Pairs of occurrences that are both in reads before @first_new_read_idx are
+// skipped, since their overlaps are already in @ovv.  If @max_kmer_occs is
+// nonzero and the k-mer occurs more often than that, it is a repeat and is not
+// used as a seed at all.
+//
 template <unsigned K>
 static void
 overlaps_from_kmer_seed(const std::vector<KmerOccurrence> & occs,
 			const BaseVecVec &bvv,
 			const unsigned min_overlap_len,
 			const unsigned max_edits,
+			const size_t first_new_read_idx,
+			const size_t max_kmer_occs,
 			OverlapVecVec &ovv,
 			unsigned long & num_overlaps,
 			unsigned long & num_pairs_considered)
 {
 	Overlap o;
+	if (max_kmer_occs != 0 && occs.size() > max_kmer_occs)
+		return;
 	// Consider each pair of k-mer occurrences only one time
 	// (i.e. start j at i + 1, not 0)
 	for (size_t i = 0; i < occs.size(); i++) {
 		for (size_t j = i + 1; j < occs.size(); j++) {
-			num_pairs_considered++;
 			KmerOccurrence occ1 = occs[i];
 			KmerOccurrence occ2 = occs[j];
+			if (occ1.get_read_id() < first_new_read_idx &&
+			    occ2.get_read_id() < first_new_read_idx)
+				continue;
+			num_pairs_considered++;
 
 			// The first occurrence is always set to the one with
 			// lower read ID.
@@ -272,8 +241,7 @@ overlaps_from_kmer_seed(const std::vector<KmerOccurrence> & occs,
 				          min_overlap_len, max_edits, K, o))
 				continue;
 
-			assert_overlap_valid(o, bvv,
-					     min_overlap_len, max_edits);
+			verify_overlap(o, bvv, min_overlap_len, max_edits);
 
 			OverlapVecVec::OverlapSet & os = ovv[occ1.get_read_id()];
 			OverlapVecVec::OverlapSet::iterator it;
@@ -303,64 +271,105 @@ static void load_kmer_occurrences(const BaseVecVec &bvv,
 	info("Finding all occurrences of %u-mers in the reads", K);
 	occ_map.clear();
 	unsigned long num_kmer_occurrences = 0;
-	for (size_t i = 0; i < bvv.size(); i++) {
-		const BaseVec &bv = bvv[i];
-		Kmer<K> fwd_kmer;
-		Kmer<K> rev_kmer;
-		Kmer<K> *kmer;
-		bool is_rc;
-		if (bv.size() < K)
-			continue;
-		for (size_t j = 0; j < K - 1; j++) {
-			fwd_kmer.push_back(bv[j]);
-			rev_kmer.push_front(bv[j] ^ 3);
-		}
-		for (size_t j = K - 1; j < bv.size(); j++) {
-			fwd_kmer.push_back(bv[j]);
-			rev_kmer.push_front(bv[j] ^ 3);
-
-			for (size_t k = 0; k < K; k++) {
-				unsigned char bv_base = bv[(j - (K - 1)) + k];
-				assert2(fwd_kmer[k] == bv_base);
-				assert2(rev_kmer[(K - 1) - k] == (3 ^ bv_base));
-			}
-
-			if (fwd_kmer < rev_kmer) {
-				kmer = &fwd_kmer;
-				is_rc = false;
-			} else {
-				kmer = &rev_kmer;
-				is_rc = true;
-			}
-			occ_map[*kmer].push_back(KmerOccurrence(i, j - (K - 1), is_rc));
+	for_each_kmer_occurrence<K>(bvv, 0,
+		[&](const Kmer<K> & kmer, const KmerOccurrence & occ) {
+			occ_map[kmer].push_back(occ);
 			num_kmer_occurrences++;
-		}
-	}
+		});
 	info("Loaded %lu %u-mer occurrences into hash map",
 	     num_kmer_occurrences, K);
 }
 
+//
+// Finds the overlaps seeded at the k-mers of the sorted index entries
+// [@new_beg, @new_end), which are those of the reads from @first_new_read_idx
+// on, paired with each other and with the occurrences of the same k-mers in
+// @old_index, if given, which indexes the reads before @first_new_read_idx.
+//
+template <unsigned K>
+static void
+overlaps_from_index_entries(const KmerIndexEntry<K> *new_beg,
+			    const KmerIndexEntry<K> *new_end,
+			    const KmerIndex<K> *old_index,
+			    const BaseVecVec &bvv,
+			    const unsigned min_overlap_len,
+			    const unsigned max_edits,
+			    const size_t first_new_read_idx,
+			    const size_t max_kmer_occs,
+			    OverlapVecVec &ovv,
+			    unsigned long & num_overlaps,
+			    unsigned long & num_pairs_considered)
+{
+	std::vector<KmerOccurrence> occs;
+	const KmerIndexEntry<K> *p = new_beg;
+	while (p != new_end) {
+		const KmerIndexEntry<K> *run_end = p + 1;
+		while (run_end != new_end && run_end->kmer == p->kmer)
+			run_end++;
+		occs.clear();
+		if (old_index) {
+			std::pair<const KmerIndexEntry<K> *,
+				  const KmerIndexEntry<K> *> old_range =
+				old_index->find(p->kmer);
+			for (const KmerIndexEntry<K> *e = old_range.first;
+			     e != old_range.second; e++)
+				occs.push_back(e->occ);
+		}
+		for (; p != run_end; p++)
+			occs.push_back(p->occ);
+		overlaps_from_kmer_seed<K>(occs, bvv, min_overlap_len, max_edits,
+					   first_new_read_idx, max_kmer_occs, ovv,
+					   num_overlaps, num_pairs_considered);
+	}
+}
+
 //
 // Compute overlaps.
 //
 // @bvv:
 // 	Vector of reads.
 //
+// @num_old_reads:
+// 	Number of reads at the beginning of @bvv whose overlaps with each other
+// 	are already in @ovv, and whose k-mers are indexed in @index_file.  If
+// 	nonzero, only the overlaps that involve the new reads are computed.
+//
 // @min_overlap_len:
 // 	Minimum length for each overlap.
 //
 // @max_edits:
 // 	(Unimplemented)
 //
+// @max_kmer_occs:
+// 	If nonzero, k-mers that occur more often than this are not used as
+// 	seeds.
+//
+// @index_file:
+// 	If not NULL, the file of the k-mer index of the reads.  If
+// 	@index_exists, the index is loaded from it: in place of indexing the
+// 	reads if there are no old reads, or as the index of the old reads.
+//
+// @index_out_file:
+// 	The file to write the k-mer index of all the reads to, if @index_file
+// 	is not NULL and either it does not exist or there are old reads, so
+// 	that it can be reused.  This is a temporary file that the caller
+// 	renames to @index_file.
+//
 // @ovv:
 // 	Vector, indexed by read-id, into which a set of Overlaps for each read
-// 	will be stored.
+// 	will be stored.  It must hold the overlaps of the @num_old_reads old
+// 	reads.
 //
 // Templatized by K, the length of the k-mer seed used to find overlaps.
 template <unsigned K>
 static void compute_overlaps(const BaseVecVec &bvv,
+			     const size_t num_old_reads,
 			     const unsigned min_overlap_len,
 			     const unsigned max_edits,
+			     const size_t max_kmer_occs,
+			     const char *index_file,
+			     const bool index_exists,
+			     const char *index_out_file,
 			     OverlapVecVec &ovv)
 {
 	typedef std_unordered_map<Kmer<K>, std::vector<KmerOccurrence>,
@@ -391,41 +400,153 @@ static void compute_overlaps(const BaseVecVec &bvv,
 		}
 	}
 
-	assert(ovv.size() == 0);
+	assert(ovv.size() == num_old_reads);
 
 	ovv.resize(bvv.size());
 
-	KmerOccurrenceMap occ_map;
-
-	load_kmer_occurrences(bvv, occ_map);
-
-	info("Finding overlaps from %u-mer seeds", K);
 	unsigned long num_overlaps = 0;
 	unsigned long num_pairs_considered = 0;
 
-	typename KmerOccurrenceMap::const_iterator it;
-	for (it = occ_map.begin(); it != occ_map.end(); it++) {
-		overlaps_from_kmer_seed<K>(it->second, bvv,
-					   min_overlap_len, max_edits,
-					   ovv, num_overlaps,
-					   num_pairs_considered);
+	if (index_file && index_exists && num_old_reads == 0) {
+		info("Loading %u-mer index from \"%s\"", K, index_file);
+		const KmerIndex<K> index(index_file);
+		index.check_reads(index_file, bvv, bvv.size());
+		info("Loaded %zu %u-mer occurrences", index.size(), K);
+
+		info("Finding overlaps from %u-mer seeds", K);
+		overlaps_from_index_entries<K>(index.begin(), index.end(), NULL,
+					       bvv, min_overlap_len, max_edits,
+					       0, max_kmer_occs, ovv,
+					       num_overlaps, num_pairs_considered);
+	} else if (index_file) {
+		// Index the k-mers of the new reads (all of them if there are
+		// no old reads), find the overlaps from the sorted index, and
+		// write it out merged with the index of the old reads.
+		const KmerIndex<K> *old_index = NULL;
+		if (num_old_reads != 0) {
+			assert(index_exists);
+			info("Loading %u-mer index from \"%s\"", K, index_file);
+			old_index = new KmerIndex<K>(index_file);
+			old_index->check_reads(index_file, bvv, num_old_reads);
+		}
+
+		info("Indexing the %u-mers of %zu reads", K,
+		     bvv.size() - num_old_reads);
+		std::vector<KmerIndexEntry<K> > entries;
+		KmerIndex<K>::collect_entries(bvv, num_old_reads, entries);
+		info("Indexed %zu %u-mer occurrences", entries.size(), K);
+
+		info("Finding overlaps from %u-mer seeds", K);
+		overlaps_from_index_entries<K>(entries.data(),
+					       entries.data() + entries.size(),
+					       old_index, bvv, min_overlap_len,
+					       max_edits, num_old_reads,
+					       max_kmer_occs, ovv,
+					       num_overlaps, num_pairs_considered);
+
+		info("Writing %u-mer index of %zu reads to \"%s\"",
+		     K, bvv.size(), index_out_file);
+		if (old_index) {
+			KmerIndex<K>::write(index_out_file, bvv,
+					    old_index->begin(), old_index->end(),
+					    entries.data(),
+					    entries.data() + entries.size());
+			delete old_index;
+		} else {
+			KmerIndex<K>::write(index_out_file, bvv,
+					    entries.data(),
+					    entries.data() + entries.size(),
+					    NULL, NULL);
+		}
+	} else {
+		KmerOccurrenceMap occ_map;
+
+		load_kmer_occurrences(bvv, occ_map);
+
+		info("Finding overlaps from %u-mer seeds", K);
+
+		typename KmerOccurrenceMap::const_iterator it;
+		for (it = occ_map.begin(); it != occ_map.end(); it++) {
+			overlaps_from_kmer_seed<K>(it->second, bvv,
+						   min_overlap_len, max_edits,
+						   0, max_kmer_occs, ovv,
+						   num_overlaps,
+						   num_pairs_considered);
+		}
 	}
 	info("Found %lu overlaps", num_overlaps);
 	info("Considered %lu read pairs", num_pairs_considered);
 }
 
-static const char *optstring = "l:e:h";
+//
+// Return the length of the k-mer seeds used to find overlaps at least
+// @min_overlap_len long: the longest supported length that is not longer.
+//
+static unsigned seed_len(const unsigned min_overlap_len)
+{
+	if (min_overlap_len < 8)
+		return 4;
+	else if (min_overlap_len < 16)
+		return 8;
+	else if (min_overlap_len < 24)
+		return 16;
+	else if (min_overlap_len < 32)
+		return 24;
+	else if (min_overlap_len < 40)
+		return 32;
+	else if (min_overlap_len < 48)
+		return 40;
+	else if (min_overlap_len < 64)
+		return 48;
+	else if (min_overlap_len < 96)
+		return 64;
+	else if (min_overlap_len < 128)
+		return 96;
+	else
+		return 128;
+}
+
+// Replace the file @filename with the file @tmp_filename.
+static void rename_tmp_file(const std::string & tmp_filename,
+			    const char *filename)
+{
+	if (rename(tmp_filename.c_str(), filename) != 0)
+		fatal_error_with_errno("Error renaming \"%s\" to \"%s\"",
+				       tmp_filename.c_str(), filename);
+}
+
+static const char *optstring = "l:e:m:i:a:h";
 static const struct option longopts[] = {
 	{"min-overlap-len", required_argument, NULL, 'l'},
 	{"max-edits",   required_argument, NULL, 'e'},
+	{"max-kmer-occurrences", required_argument, NULL, 'm'},
+	{"kmer-index",  required_argument, NULL, 'i'},
+	{"add-reads",   required_argument, NULL, 'a'},
 	END_LONGOPTS
 };
 
 DEFINE_USAGE(
-"Usage: compute-overlaps READS_FILE OVERLAPS_FILE\n"
+"Usage: compute-overlaps [OPTIONS] READS_FILE OVERLAPS_FILE\n"
+"       compute-overlaps [OPTIONS] --kmer-index=INDEX_FILE\n"
+"                        --add-reads=NEW_READS_FILE READS_FILE OVERLAPS_FILE\n"
 "\n"
 "Computes all overlaps between reads in a set of reads.\n"
 "\n"
+"The overlaps are seeded from an index of the k-mers of the reads.  With\n"
+"--kmer-index, the index is kept in a file, as written by build-kmer-index or\n"
+"by an earlier run, so that runs with a different --min-overlap-len or\n"
+"--max-kmer-occurrences do not have to index the reads again.\n"
+"\n"
+"With --add-reads, reads are added to a read set whose overlaps were already\n"
+"computed: only the overlaps of the new reads with the old reads and with each\n"
+"other are computed, seeded from the k-mer index of the old reads.\n"
+"READS_FILE, OVERLAPS_FILE and INDEX_FILE are all updated, the new reads\n"
+"following the old ones; each is written to a temporary file, and the three\n"
+"replace the old files only once all of them have been written.  The result\n"
+"is the same as computing the overlaps of the whole read set.  The string\n"
+"graph is not updated: run remove-contained-reads and the later stages again\n"
+"on the updated overlaps.\n"
+"\n"
 "Input:\n"
 "     READS_FILE:  FASTQ, FASTA, or binary reads (BaseVecVec) file\n"
 "                  containing the read set.\n"
@@ -436,7 +557,20 @@ DEFINE_USAGE(
 "Options:\n"
 "  -l, --min-overlap-len=LEN\n"
 "  -e, --max-edits=MAX_EDITS\n"
+"  -m, --max-kmer-occurrences=N\n"
+"                  Do not seed overlaps at k-mers that occur more than N\n"
+"                  times, which are repeats.  Default: 0 (no limit).\n"
+"  -i, --kmer-index=INDEX_FILE\n"
+"                  If INDEX_FILE exists, seed the overlaps from the k-mer\n"
+"                  index in it, which must be of READS_FILE and of k-mers no\n"
+"                  longer than LEN.  Otherwise, write the k-mer index of the\n"
+"                  reads to INDEX_FILE.\n"
+"  -a, --add-reads=NEW_READS_FILE\n"
+"                  Add the reads in NEW_READS_FILE to READS_FILE, whose\n"
+"                  overlaps are in OVERLAPS_FILE and whose k-mer index is\n"
+"                  INDEX_FILE.\n"
 "  -h, --help\n"
+VERIFY_USAGE
 );
 
 int main(int argc, char *argv[])
@@ -444,6 +578,9 @@ int main(int argc, char *argv[])
 	int c;
 	unsigned min_overlap_len = 25;
 	unsigned max_edits = 0;
+	size_t max_kmer_occs = 0;
+	const char *index_file = NULL;
+	const char *new_reads_file = NULL;
 	for_opt(c) {
 		switch (c) {
 		case 'l':
@@ -454,6 +591,16 @@ int main(int argc, char *argv[])
 			max_edits = parse_long(optarg, "--max-edits",
 					       0, UINT_MAX);
 			break;
+		case 'm':
+			max_kmer_occs = parse_long(optarg, "--max-kmer-occurrences",
+						   0, LLONG_MAX);
+			break;
+		case 'i':
+			index_file = optarg;
+			break;
+		case 'a':
+			new_reads_file = optarg;
+			break;
 		PROCESS_OTHER_OPTS
 		}
 	}
@@ -464,33 +611,137 @@ int main(int argc, char *argv[])
 	if (max_edits != 0)
 		unimplemented();
 
+	if (new_reads_file && !index_file)
+		fatal_error("--add-reads requires --kmer-index");
+
+	// Seed with the k-mers of the index, if there is one; they need only
+	// be no longer than the minimum overlap length.
+	const bool index_exists = (index_file && access(index_file, F_OK) == 0);
+	unsigned kmer_len = seed_len(min_overlap_len);
+	if (index_exists) {
+		kmer_len = KmerIndexFile::read_kmer_len(index_file);
+		if (kmer_len > min_overlap_len)
+			fatal_error("\"%s\" is an index of %u-mers, which cannot "
+				    "seed overlaps of %u bases", index_file,
+				    kmer_len, min_overlap_len);
+	} else if (new_reads_file) {
+		fatal_error_with_errno("Error opening \"%s\"", index_file);
+	}
+
 	info("Loading reads from \"%s\"", argv[0]);
 	BaseVecVec bvv(argv[0]);
 	info("Loaded %zu reads from \"%s\"", bvv.size(), argv[0]);
 	OverlapVecVec ovv;
+	size_t num_old_reads = 0;
+
+	if (new_reads_file) {
+		num_old_reads = bvv.size();
+
+		info("Loading overlaps from \"%s\"", argv[1]);
+		OverlapVecVec(argv[1]).swap(ovv);
+		if (ovv.size() != num_old_reads)
+			fatal_error("\"%s\" has overlaps for %zu reads, but "
+				    "there are %zu reads", argv[1], ovv.size(),
+				    num_old_reads);
+
+		info("Loading new reads from \"%s\"", new_reads_file);
+		BaseVecVec new_reads(new_reads_file);
+		info("Loaded %zu new reads from \"%s\"", new_reads.size(),
+		     new_reads_file);
+
+		// Only the BaseVec handles are moved, so clearing
+		// @new_reads does not free the bases.
+		bvv.insert(bvv.end(), new_reads.begin(), new_reads.end());
+		new_reads.clear();
+	}
 
-	if (min_overlap_len < 8)
-		compute_overlaps<4>(bvv, min_overlap_len, max_edits, ovv);
-	if (min_overlap_len < 16)
-		compute_overlaps<8>(bvv, min_overlap_len, max_edits, ovv);
-	else if (min_overlap_len < 24)
-		compute_overlaps<16>(bvv, min_overlap_len, max_edits, ovv);
-	else if (min_overlap_len < 32)
-		compute_overlaps<24>(bvv, min_overlap_len, max_edits, ovv);
-	else if (min_overlap_len < 40)
-		compute_overlaps<32>(bvv, min_overlap_len, max_edits, ovv);
-	else if (min_overlap_len < 48)
-		compute_overlaps<40>(bvv, min_overlap_len, max_edits, ovv);
-	else if (min_overlap_len < 64)
-		compute_overlaps<48>(bvv, min_overlap_len, max_edits, ovv);
-	else if (min_overlap_len < 96)
-		compute_overlaps<64>(bvv, min_overlap_len, max_edits, ovv);
-	else if (min_overlap_len < 128)
-		compute_overlaps<96>(bvv, min_overlap_len, max_edits, ovv);
-	else
-		compute_overlaps<128>(bvv, min_overlap_len, max_edits, ovv);
+	// The updated files are all written to temporary files first, which
+	// replace the originals only once all of them have been written.  So a
+	// run that fails leaves the reads, overlaps and index as they were.  A
+	// run interrupted while the files are being renamed leaves files that
+	// do not match, which the checks of the number of reads and of the
+	// index checksum catch on the next run.
+	const bool write_index = index_file && (!index_exists || new_reads_file);
+	const std::string index_tmp_file = write_index ?
+				std::string(index_file) + ".tmp" : std::string();
+	const char *index_out_file = write_index ? index_tmp_file.c_str() : NULL;
+	const std::string reads_tmp_file = std::string(argv[0]) + ".tmp";
+	const std::string overlaps_tmp_file = std::string(argv[1]) + ".tmp";
+
+	switch (kmer_len) {
+	case 4:
+		compute_overlaps<4>(bvv, num_old_reads, min_overlap_len, max_edits,
+				     max_kmer_occs, index_file, index_exists,
+				     index_out_file, ovv);
+		break;
+	case 8:
+		compute_overlaps<8>(bvv, num_old_reads, min_overlap_len, max_edits,
+				     max_kmer_occs, index_file, index_exists,
+				     index_out_file, ovv);
+		break;
+	case 16:
+		compute_overlaps<16>(bvv, num_old_reads, min_overlap_len, max_edits,
+				      max_kmer_occs, index_file, index_exists,
+				      index_out_file, ovv);
+		break;
+	case 24:
+		compute_overlaps<24>(bvv, num_old_reads, min_overlap_len, max_edits,
+				      max_kmer_occs, index_file, index_exists,
+				      index_out_file, ovv);
+		break;
+	case 32:
+		compute_overlaps<32>(bvv, num_old_reads, min_overlap_len, max_edits,
+				      max_kmer_occs, index_file, index_exists,
+				      index_out_file, ovv);
+		break;
+	case 40:
+		compute_overlaps<40>(bvv, num_old_reads, min_overlap_len, max_edits,
+				      max_kmer_occs, index_file, index_exists,
+				      index_out_file, ovv);
+		break;
+	case 48:
+		compute_overlaps<48>(bvv, num_old_reads, min_overlap_len, max_edits,
+				      max_kmer_occs, index_file, index_exists,
+				      index_out_file, ovv);
+		break;
+	case 64:
+		compute_overlaps<64>(bvv, num_old_reads, min_overlap_len, max_edits,
+				      max_kmer_occs, index_file, index_exists,
+				      index_out_file, ovv);
+		break;
+	case 96:
+		compute_overlaps<96>(bvv, num_old_reads, min_overlap_len, max_edits,
+				      max_kmer_occs, index_file, index_exists,
+				      index_out_file, ovv);
+		break;
+	case 128:
+		compute_overlaps<128>(bvv, num_old_reads, min_overlap_len, max_edits,
+				       max_kmer_occs, index_file, index_exists,
+				       index_out_file, ovv);
+		break;
+	default:
+		fatal_error("Unsupported k-mer length %u", kmer_len);
+	}
+
+	const BaseVecVec::file_type reads_ft =
+			BaseVecVec::file_type_from_extension(argv[0]);
+	if (new_reads_file) {
+		info("Writing %zu reads to \"%s\"", bvv.size(),
+		     reads_tmp_file.c_str());
+		bvv.write(reads_tmp_file.c_str(), reads_ft);
+	}
 
-	info("Writing overlaps to \"%s\"", argv[1]);
-	ovv.write(argv[1]);
+	info("Writing overlaps to \"%s\"", overlaps_tmp_file.c_str());
+	ovv.write(overlaps_tmp_file.c_str());
+
+	if (new_reads_file) {
+		rename_tmp_file(reads_tmp_file, argv[0]);
+		if (reads_ft == BaseVecVec::NATIVE)
+			rename_tmp_file(BaseVecVec::lengths_filename(reads_tmp_file.c_str()),
+					BaseVecVec::lengths_filename(argv[0]).c_str());
+	}
+	rename_tmp_file(overlaps_tmp_file, argv[1]);
+	if (write_index)
+		rename_tmp_file(index_tmp_file, index_file);
 	info("Done writing \"%s\"", argv[1]);
 }
@@ -0,0 +1,110 @@
+#include "KmerSpectrum.h"
+#include <getopt.h>
+
+DEFINE_USAGE(
+"Usage: correct-reads [OPTIONS] READS_FILE OUT_READS_FILE\n"
+"\n"
+"Corrects substitution errors in reads with the k-mer spectrum of the reads.\n"
+"A k-mer is solid if it occurs at least MIN_COUNT times in the reads, counting\n"
+"both strands.  Each read that has k-mers that are not solid is corrected by\n"
+"substituting as few bases as possible to make all of its k-mers solid.  Reads\n"
+"that cannot be corrected are written unchanged.\n"
+"\n"
+"compute-overlaps only finds exact overlaps, so correcting the reads first\n"
+"recovers overlaps that errors would otherwise break.\n"
+"\n"
+"Input:\n"
+"      READS_FILE:      FASTQ, FASTA, or binary reads (BaseVecVec) file.\n"
+"\n"
+"Output:\n"
+"      OUT_READS_FILE:  File to write the corrected reads to, in the same\n"
+"                       order.  The format is chosen as in convert-reads.\n"
+"\n"
+"Options:\n"
+"   -k, --kmer-len=K          Length of the k-mers: 16, 20, 24, 28 or 32.\n"
+"                             Default: 24.\n"
+"   -c, --min-count=COUNT     Number of times a k-mer must occur to be solid.\n"
+"                             Default: 3.\n"
+"   -m, --max-corrections=N   Maximum number of bases to substitute in each\n"
+"                             read.  Default: 4.\n"
+"   -h, --help\n"
+VERIFY_USAGE
+);
+
+static const char *optstring = "k:c:m:h";
+static const struct option longopts[] = {
+	{"kmer-len", required_argument, NULL, 'k'},
+	{"min-count", required_argument, NULL, 'c'},
+	{"max-corrections", required_argument, NULL, 'm'},
+	END_LONGOPTS
+};
+
+template <unsigned K>
+static void correct_reads(BaseVecVec & reads, const unsigned min_count,
+			  const unsigned max_corrections)
+{
+	const KmerSpectrum<K> spectrum(reads, min_count);
+	const read_correction_stats stats =
+		correct_reads(reads, spectrum, max_corrections);
+	info("Corrected %zu reads (%.2f%%) with %zu substitutions",
+	     stats.num_corrected_reads,
+	     TO_PERCENT(stats.num_corrected_reads, reads.size()),
+	     stats.num_substitutions);
+	info("Left %zu reads (%.2f%%) that could not be corrected unchanged",
+	     stats.num_uncorrectable_reads,
+	     TO_PERCENT(stats.num_uncorrectable_reads, reads.size()));
+}
+
+int main(int argc, char *argv[])
+{
+	int c;
+	unsigned kmer_len = 24;
+	unsigned min_count = 3;
+	unsigned max_corrections = 4;
+	for_opt(c) {
+		switch (c) {
+		case 'k':
+			kmer_len = parse_long(optarg, "--kmer-len", 16, 32);
+			break;
+		case 'c':
+			min_count = parse_long(optarg, "--min-count", 1, INT_MAX);
+			break;
+		case 'm':
+			max_corrections = parse_long(optarg, "--max-corrections",
+						     0, INT_MAX);
+			break;
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 2);
+
+	info("Loading reads from \"%s\"", argv[0]);
+	BaseVecVec reads(argv[0]);
+	info("Loaded %zu reads from \"%s\"", reads.size(), argv[0]);
+
+	switch (kmer_len) {
+	case 16:
+		correct_reads<16>(reads, min_count, max_corrections);
+		break;
+	case 20:
+		correct_reads<20>(reads, min_count, max_corrections);
+		break;
+	case 24:
+		correct_reads<24>(reads, min_count, max_corrections);
+		break;
+	case 28:
+		correct_reads<28>(reads, min_count, max_corrections);
+		break;
+	case 32:
+		correct_reads<32>(reads, min_count, max_corrections);
+		break;
+	default:
+		fatal_error("Unsupported k-mer length %u (expected 16, 20, "
+			    "24, 28 or 32)", kmer_len);
+	}
+
+	info("Writing corrected reads to \"%s\"", argv[1]);
+	reads.write(argv[1]);
+}
@@ -1,9 +1,10 @@
 #include "BidirectedStringGraph.h"
 #include "DirectedStringGraph.h"
 #include "util.h"
+#include <getopt.h>
 
 DEFINE_USAGE(
-"Usage: digraph-to-bidigraph DIGRAPH_FILE OUT_BIDIGRAPH_FILE\n"
+"Usage: digraph-to-bidigraph [--verify=LEVEL] DIGRAPH_FILE OUT_BIDIGRAPH_FILE\n"
 "\n"
 "Turns a directed string graph into a bidirected string graph.\n"
 "\n"
@@ -12,18 +13,34 @@ DEFINE_USAGE(
 "\n"
 "Output:\n"
 "      OUT_BIDIGRAPH_FILE:  A bidirected string graph in binary format.\n"
+"\n"
+"Options:\n"
+VERIFY_USAGE
 );
 
+static const char *optstring = "h";
+static const struct option longopts[] = {
+	END_LONGOPTS
+};
+
 int main(int argc, char *argv[])
 {
-	USAGE_IF(argc != 3);
-	info("Loading directed string graph from \"%s\"", argv[1]);
-	DirectedStringGraph digraph(argv[1]);
+	int c;
+	for_opt(c) {
+		switch (c) {
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 2);
+	info("Loading directed string graph from \"%s\"", argv[0]);
+	DirectedStringGraph digraph(argv[0]);
 
 	BidirectedStringGraph bidigraph(digraph.num_vertices() / 2);
 
 	bidigraph.build_from_digraph(digraph);
 
-	info("Writing bidirected string graph to \"%s\"", argv[2]);
-	bidigraph.write(argv[2]);
+	info("Writing bidirected string graph to \"%s\"", argv[1]);
+	bidigraph.write(argv[1]);
 }
@@ -0,0 +1,303 @@
+#include "BidirectedStringGraph.h"
+#include "FastaWriter.h"
+#include <getopt.h>
+#include <limits.h>
+#include <sstream>
+#include <unordered_map>
+
+DEFINE_USAGE(
+"Usage: emit-contigs [--min-len=LEN] [--verify=LEVEL]\n"
+"                    BIDIGRAPH_FILE CYCLE_FILE OUT_FASTA_FILE\n"
+"       emit-contigs --unitigs [--min-len=LEN] [--verify=LEVEL]\n"
+"                    BIDIGRAPH_FILE OUT_FASTA_FILE\n"
+"\n"
+"Writes the sequences spelled by a bidirected string graph to a FASTA file.\n"
+"\n"
+"By default, the Eulerian cycle is walked and the labels of its edges are\n"
+"concatenated in the direction each edge is traversed, after the read of the\n"
+"vertex at which the walk starts.  The cycle is split into separate contigs at\n"
+"the special edges, which do not correspond to any sequence.  The traversal\n"
+"counts count both strands, so the cycle walks each copy of a contig twice,\n"
+"either way; it is written only the first time.  A cycle with no special\n"
+"edges is a single circular contig, of which only the first half is written\n"
+"if the second half walks it again.  With --unitigs, each non-special edge\n"
+"traversed at least once is instead written as its own sequence, starting\n"
+"with the read of its first vertex, along with its traversal count.\n"
+"\n"
+"Sequences are streamed to the output file as they are decoded, so no contig\n"
+"is ever held in memory in full.\n"
+"\n"
+"Input:\n"
+"      BIDIGRAPH_FILE:  A bidirected string graph in binary format, with the\n"
+"                       traversal count of each edge computed.\n"
+"      CYCLE_FILE:      An Eulerian cycle of the graph, as written by\n"
+"                       bidigraph-eulerian-cycle.\n"
+"\n"
+"Output:\n"
+"      OUT_FASTA_FILE:  The FASTA file to write the sequences to.\n"
+"\n"
+"Options:\n"
+"   --min-len=LEN    Do not write sequences shorter than LEN bases.\n"
+"   --unitigs        Write the traversed edges rather than walking a cycle.\n"
+VERIFY_USAGE
+);
+
+static const char *optstring = "l:uh";
+static const struct option longopts[] = {
+	{"min-len", required_argument, NULL, 'l'},
+	{"unitigs", no_argument, NULL, 'u'},
+	END_LONGOPTS
+};
+
+static void write_label(FastaWriter & writer, const EdgeLabel & label,
+			const BaseVecVec & reads)
+{
+	for (BaseVec::size_type i = 0; i < label.length(); i++)
+		writer.put_base(label.base(i, reads));
+}
+
+// Return the read of the vertex from which the edge @e is traversed from side
+// @side, or NULL if the vertex has none, as the special vertex does.  The read
+// is to be written forward if @rc is set to %false, or reverse-complemented
+// if it is set to %true, so that the edge's label continues it.
+static const BaseVec *get_tail_read(const BidirectedStringGraph & graph,
+				    const BidirectedStringGraphEdge & e,
+				    const unsigned side, bool & rc)
+{
+	const BidirectedStringGraphEdge::v_idx_t dv_idx =
+		e.get_directed_tail_idx(side);
+	if (dv_idx / 2 >= graph.reads().size())
+		return NULL;
+	rc = !(dv_idx & 1);
+	return &graph.reads()[dv_idx / 2];
+}
+
+static void write_read(FastaWriter & writer, const BaseVec & bv, const bool rc)
+{
+	for (BaseVec::size_type i = 0; i < bv.size(); i++)
+		writer.put_base(rc ? 3 ^ bv[bv.size() - 1 - i] : bv[i]);
+}
+
+// Write the contig spelled by the half-edges cycle[begin], ..., cycle[end - 1],
+// where the indices wrap around the end of the cycle, if it is at least
+// @min_len bases long.  A linear contig begins with the read of the vertex at
+// which the first edge starts, since the labels only spell the rest of each
+// read; a circular contig is spelled by the labels alone.
+static void write_contig(FastaWriter & writer,
+			 const BidirectedStringGraph & graph,
+			 const PackedIntVec & cycle,
+			 size_t begin, size_t end, size_t min_len,
+			 bool circular)
+{
+	const size_t n = cycle.size();
+	const BaseVec *first_read = NULL;
+	bool first_read_rc = false;
+	if (!circular)
+		first_read = get_tail_read(graph,
+					   graph.edges()[cycle[begin % n] / 2],
+					   cycle[begin % n] & 1, first_read_rc);
+	uint64_t len = first_read ? first_read->size() : 0;
+	for (size_t i = begin; i < end; i++) {
+		const BidirectedStringGraphEdge & e = graph.edges()[cycle[i % n] / 2];
+		len += e.get_label(cycle[i % n] & 1).length();
+	}
+	if (len == 0 || len < min_len)
+		return;
+
+	std::ostringstream name;
+	name << "contig_" << (writer.num_records() + 1) << " len=" << len
+	     << " edges=" << (end - begin);
+	writer.begin_record(name.str());
+	if (first_read)
+		write_read(writer, *first_read, first_read_rc);
+	for (size_t i = begin; i < end; i++) {
+		const BidirectedStringGraphEdge & e = graph.edges()[cycle[i % n] / 2];
+		write_label(writer, e.get_label(cycle[i % n] & 1), graph.reads());
+	}
+	writer.end_record();
+}
+
+// Pairs up the runs of the cycle between special edges, so that each contig is
+// written once rather than once per traversal.  The traversal count of an edge
+// of a bidirected graph counts both strands of the sequence, so every copy of
+// a contig is walked twice: either the same way twice, or once each way, as
+// its twin--- the same edges, traversed in reverse from the opposite sides,
+// which spell its reverse complement.
+class RunPairFilter {
+private:
+	const PackedIntVec & _cycle;
+	const size_t _n;
+
+	// The runs written that have not been paired yet, by the smaller of
+	// the hashes of the run and of its twin.
+	std::unordered_multimap<uint64_t, std::pair<size_t, size_t> > _unpaired;
+
+	uint64_t half_edge(size_t i) const
+	{
+		return _cycle[i % _n];
+	}
+
+	static uint64_t hash_step(uint64_t hash, uint64_t half_edge)
+	{
+		return (hash ^ half_edge) * 0x9e3779b97f4a7c15ULL + 1;
+	}
+public:
+	RunPairFilter(const PackedIntVec & cycle)
+		: _cycle(cycle), _n(cycle.size())
+	{
+	}
+
+	// Return %true iff the runs [@begin, @end) and [@begin_2, @end_2) of
+	// the cycle are the same contig, walked either way.
+	bool same_contig(size_t begin, size_t end,
+			 size_t begin_2, size_t end_2) const
+	{
+		if (end - begin != end_2 - begin_2)
+			return false;
+		bool same = true;
+		bool twin = true;
+		for (size_t i = 0; i < end - begin && (same || twin); i++) {
+			const uint64_t h = half_edge(begin + i);
+			same = same && h == half_edge(begin_2 + i);
+			twin = twin && h == (half_edge(end_2 - 1 - i) ^ 1);
+		}
+		return same || twin;
+	}
+
+	// Return %true iff the run cycle[begin], ..., cycle[end - 1] is to be
+	// written, which it is unless it pairs with a run already written.
+	bool keep(size_t begin, size_t end)
+	{
+		uint64_t hash = 0;
+		uint64_t twin_hash = 0;
+		for (size_t i = begin; i < end; i++) {
+			hash = hash_step(hash, half_edge(i));
+			twin_hash = hash_step(twin_hash,
+					      half_edge(end - 1 - (i - begin)) ^ 1);
+		}
+		const uint64_t key = std::min(hash, twin_hash);
+		auto range = _unpaired.equal_range(key);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (same_contig(begin, end, it->second.first,
+					it->second.second)) {
+				_unpaired.erase(it);
+				return false;
+			}
+		}
+		_unpaired.insert(std::make_pair(key, std::make_pair(begin, end)));
+		return true;
+	}
+};
+
+static void emit_cycle_contigs(FastaWriter & writer,
+			       const BidirectedStringGraph & graph,
+			       const PackedIntVec & cycle, size_t min_len)
+{
+	// Start the walk just after a special edge, so that no contig wraps
+	// around the end of the cycle without being split.  With no special
+	// edges, the whole cycle is a single circular contig, which the cycle
+	// walks twice like any other: if its second half repeats or twins its
+	// first half, only the first half is written.
+	const size_t n = cycle.size();
+	size_t start = 0;
+	bool circular = true;
+	for (size_t i = 0; i < n; i++) {
+		if (cycle[i] / 2 >= graph.num_edges())
+			fatal_error("Eulerian cycle refers to nonexistent edge %zu",
+				    size_t(cycle[i] / 2));
+	}
+	for (size_t i = 0; i < n; i++) {
+		if (graph.edges()[cycle[i] / 2].is_special()) {
+			start = i + 1;
+			circular = false;
+			break;
+		}
+	}
+	RunPairFilter run_filter(cycle);
+	if (circular) {
+		if (n % 2 == 0 && run_filter.same_contig(0, n / 2, n / 2, n))
+			write_contig(writer, graph, cycle, 0, n / 2, min_len, true);
+		else
+			write_contig(writer, graph, cycle, 0, n, min_len, true);
+		return;
+	}
+
+	size_t run_begin = start;
+	for (size_t i = start; i < start + n; i++) {
+		if (graph.edges()[cycle[i % n] / 2].is_special()) {
+			if (i != run_begin && run_filter.keep(run_begin, i))
+				write_contig(writer, graph, cycle,
+					     run_begin, i, min_len, false);
+			run_begin = i + 1;
+		}
+	}
+}
+
+static void emit_unitigs(FastaWriter & writer,
+			 const BidirectedStringGraph & graph, size_t min_len)
+{
+	for (size_t i = 0; i < graph.num_edges(); i++) {
+		const BidirectedStringGraphEdge & e = graph.edges()[i];
+		if (e.is_special() || e.get_traversal_count() <= 0)
+			continue;
+		const EdgeLabel & label = e.get_label_1_to_2();
+		bool first_read_rc = false;
+		const BaseVec *first_read = get_tail_read(graph, e, 0,
+							  first_read_rc);
+		const uint64_t len = label.length() +
+				     (first_read ? first_read->size() : 0);
+		if (len == 0 || len < min_len)
+			continue;
+		std::ostringstream name;
+		name << "unitig_" << (writer.num_records() + 1) << " edge=" << i
+		     << " copies=" << e.get_traversal_count()
+		     << " len=" << len;
+		writer.begin_record(name.str());
+		if (first_read)
+			write_read(writer, *first_read, first_read_rc);
+		write_label(writer, label, graph.reads());
+		writer.end_record();
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int c;
+	size_t min_len = 0;
+	bool unitigs = false;
+	for_opt(c) {
+		switch (c) {
+		case 'l':
+			min_len = parse_long(optarg, "--min-len", 0, LONG_MAX);
+			break;
+		case 'u':
+			unitigs = true;
+			break;
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != (unitigs ? 2 : 3));
+
+	const char *graph_file = argv[0];
+	const char *out_file = argv[argc - 1];
+
+	info("Loading bidirected string graph from \"%s\"", graph_file);
+	BidirectedStringGraph graph(graph_file);
+
+	FastaWriter writer(out_file);
+	if (unitigs) {
+		info("Writing unitigs to \"%s\"", out_file);
+		emit_unitigs(writer, graph, min_len);
+	} else {
+		info("Loading Eulerian cycle from \"%s\"", argv[1]);
+		const PackedIntVec cycle(argv[1]);
+		if (get_verify_level() >= VERIFY_STRUCTURE)
+			graph.assert_eulerian_cycle_valid(cycle);
+		info("Writing contigs to \"%s\"", out_file);
+		emit_cycle_contigs(writer, graph, cycle, min_len);
+	}
+	writer.close();
+	info("Wrote %zu sequences to \"%s\"", writer.num_records(), out_file);
+}
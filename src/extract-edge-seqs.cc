@@ -1,8 +1,9 @@
 #include "AnyStringGraph.h"
 #include "util.h"
+#include <getopt.h>
 
 DEFINE_USAGE(
-"Usage: extract-edge-seqs GRAPH_FILE OUT_CONTIGS_FILE\n"
+"Usage: extract-edge-seqs [--verify=LEVEL] GRAPH_FILE OUT_CONTIGS_FILE\n"
 "\n"
 "Extracts the sequences from the edges of a string graph.\n"
 "\n"
@@ -10,13 +11,29 @@ DEFINE_USAGE(
 "      GRAPH_FILE:  The string graph.\n"
 "      OUT_CONTIGS_FILE:  A file to which the edge sequences are to be\n"
 "                         extracted.\n"
+"\n"
+"Options:\n"
+VERIFY_USAGE
 );
 
+static const char *optstring = "h";
+static const struct option longopts[] = {
+	END_LONGOPTS
+};
+
 int main(int argc, char **argv)
 {
-	USAGE_IF(argc != 3);
-	const char *graph_file = argv[1];
-	const char *out_contigs_file = argv[2];
+	int c;
+	for_opt(c) {
+		switch (c) {
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 2);
+	const char *graph_file = argv[0];
+	const char *out_contigs_file = argv[1];
 
 	AnyStringGraph graph(graph_file);
 
@@ -0,0 +1,80 @@
+#include "Overlap.h"
+#include "parallel.h"
+#include <getopt.h>
+#include <limits.h>
+
+DEFINE_USAGE(
+"Usage: filter-overlaps [--verify=LEVEL] OVERLAPS_FILE\n"
+"                       MIN_OVERLAP_LEN OUT_OVERLAPS_FILE\n"
+"                       [MIN_OVERLAP_LEN OUT_OVERLAPS_FILE]...\n"
+"\n"
+"Filters a set of overlaps down to those at least MIN_OVERLAP_LEN bases long,\n"
+"for each of one or more minimum overlap lengths.  The overlaps computed with\n"
+"compute-overlaps -l LEN are exactly those of at least LEN bases among the\n"
+"overlaps computed with any shorter -l, so overlaps for several minimum\n"
+"overlap lengths can be computed once, with the shortest, and filtered for the\n"
+"others.  Each filtered set of overlaps can then be passed to\n"
+"remove-contained-reads with the same reads.\n"
+"\n"
+"The overlaps are loaded once and the filtered sets are made and written in\n"
+"parallel.\n"
+"\n"
+"Input:\n"
+"      OVERLAPS_FILE:      The overlaps, computed with a minimum overlap\n"
+"                          length no longer than any MIN_OVERLAP_LEN.\n"
+"\n"
+"Output:\n"
+"      OUT_OVERLAPS_FILE:  File to write the overlaps of at least\n"
+"                          MIN_OVERLAP_LEN bases to.\n"
+"\n"
+"Options:\n"
+VERIFY_USAGE
+);
+
+static const char *optstring = "h";
+static const struct option longopts[] = {
+	END_LONGOPTS
+};
+
+int main(int argc, char *argv[])
+{
+	int c;
+	for_opt(c) {
+		switch (c) {
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc < 3 || argc % 2 != 1);
+
+	const char *overlaps_file = argv[0];
+	const size_t num_outputs = (argc - 1) / 2;
+	std::vector<unsigned> min_overlap_lens(num_outputs);
+	for (size_t i = 0; i < num_outputs; i++)
+		min_overlap_lens[i] = parse_long(argv[1 + 2 * i],
+						 "MIN_OVERLAP_LEN", 1, UINT_MAX);
+
+	info("Loading overlaps from \"%s\"", overlaps_file);
+	const OverlapVecVec ovv(overlaps_file);
+	size_t num_overlaps = 0;
+	foreach(const OverlapVecVec::OverlapSet & overlap_set, ovv)
+		num_overlaps += overlap_set.size();
+	info("Loaded %zu overlaps of %zu reads", num_overlaps, ovv.size());
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (size_t i = 0; i < num_outputs; i++) {
+		const char *out_file = argv[2 + 2 * i];
+		OverlapVecVec filtered_ovv;
+		ovv.filter_by_length(min_overlap_lens[i], filtered_ovv);
+		size_t num_kept = 0;
+		foreach(const OverlapVecVec::OverlapSet & overlap_set, filtered_ovv)
+			num_kept += overlap_set.size();
+		info("Writing %zu of %zu overlaps (%.2f%%) of at least %u bases "
+		     "to \"%s\"", num_kept, num_overlaps,
+		     TO_PERCENT(num_kept, num_overlaps), min_overlap_lens[i],
+		     out_file);
+		filtered_ovv.write(out_file);
+	}
+	info("Done");
+}
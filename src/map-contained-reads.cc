@@ -1,14 +1,23 @@
 #include "Overlap.h"
 #include "BaseVecVec.h"
 #include "AnyStringGraph.h"
+#include "PackedIntVec.h"
 #include "util.h"
+#include <getopt.h>
 
 DEFINE_USAGE(
-"Usage: map-contained-reads ORIG_READS_FILE ORIG_OVERLAPS_FILE\n"
-"                           OLD_TO_NEW_INDICES_FILE GRAPH_FILE OUT_GRAPH_FILE\n"
+"Usage: map-contained-reads [--check-overlaps] [--weights=WEIGHTS_FILE]\n"
+"                           [--verify=LEVEL]\n"
+"                           ORIG_READS_FILE ORIG_OVERLAPS_FILE\n"
+"                           OLD_TO_NEW_INDICES_FILE GRAPH_FILE\n"
+"                           OUT_GRAPH_FILE\n"
 "\n"
 "Map contained reads back into a graph.\n"
 "\n"
+"Only the lengths of the reads are needed, so the reads themselves are not\n"
+"loaded if the read length table that is written alongside READS_FILE is\n"
+"available.\n"
+"\n"
 "Input:\n"
 "      READS_FILE:     The set of reads from which the overlaps were found.\n"
 "      OVERLAPS_FILE:  The set of overlaps, computed from the reads in\n"
@@ -20,32 +29,63 @@ DEFINE_USAGE(
 "Output:\n"
 "      OUT_GRAPH_FILE: The output graph into which the contained reads have.\n"
 "                      been mapped.\n"
+"\n"
+"Options:\n"
+"   --check-overlaps   Same as --verify=full: load the full reads and check\n"
+"                      the bases of every overlap, not just its extents.\n"
+"   --weights=WEIGHTS_FILE\n"
+"                      Weight each original read by the number of reads it\n"
+"                      stands for, as written by normalize-reads, when\n"
+"                      counting the reads mapped to each edge.  Without this,\n"
+"                      each read has weight 1.\n"
+VERIFY_USAGE
 );
 
+static const char *optstring = "h";
+static const struct option longopts[] = {
+	{"check-overlaps", no_argument, NULL, 'c'},
+	{"weights", required_argument, NULL, 'w'},
+	END_LONGOPTS
+};
+
 int main(int argc, char **argv)
 {
-	USAGE_IF(argc != 6);
-	const char * const orig_reads_file         = argv[1];
-	const char * const orig_overlaps_file      = argv[2];
-	const char * const old_to_new_indices_file = argv[3];
-	const char * const graph_file              = argv[4];
-	const char * const out_graph_file          = argv[5];
-
-	info("Loading original reads from \"%s\"", orig_reads_file);
-	BaseVecVec orig_reads(orig_reads_file);
+	int c;
+	const char *weights_file = NULL;
+	for_opt(c) {
+		switch (c) {
+		case 'c':
+			set_verify_level("full");
+			break;
+		case 'w':
+			weights_file = optarg;
+			break;
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 5);
+	const char * const orig_reads_file         = argv[0];
+	const char * const orig_overlaps_file      = argv[1];
+	const char * const old_to_new_indices_file = argv[2];
+	const char * const graph_file              = argv[3];
+	const char * const out_graph_file          = argv[4];
+
+	info("Loading original read lengths for \"%s\"", orig_reads_file);
+	PackedIntVec orig_read_lens;
+	BaseVecVec::read_lengths(orig_reads_file, orig_read_lens);
 
 	info("Loading original overlaps from \"%s\"", orig_overlaps_file);
 	OverlapVecVec orig_overlaps(orig_overlaps_file);
 
 	info("Loading map from old to new read indices from \"%s\"", old_to_new_indices_file);
-	std::vector<size_t> old_to_new_indices;
-	{
-		std::ifstream is(old_to_new_indices_file);
-		boost::archive::binary_iarchive ar(is);
-		ar >> old_to_new_indices;
-	}
+	const PackedIntVec old_to_new_indices(old_to_new_indices_file);
+
+	// Value of old_to_new_indices[i] when read i is contained.
+	const PackedIntVec::value_type NONE = old_to_new_indices.max_value();
 
-	size_t num_orig_reads = orig_reads.size();
+	size_t num_orig_reads = orig_read_lens.size();
 
 	assert(old_to_new_indices.size() == num_orig_reads);
 	assert(orig_overlaps.size() == num_orig_reads);
@@ -53,13 +93,26 @@ int main(int argc, char **argv)
 	// Count the number of contained reads.
 	size_t num_contained_reads = 0;
 	for (size_t i = 0; i < num_orig_reads; i++)
-		if (old_to_new_indices[i] == ~size_t(0))
+		if (old_to_new_indices[i] == NONE)
 			num_contained_reads++;
 
 	// The number of uncontained reads is the number of original reads minus
 	// the number of contained reads.
 	size_t num_uncontained_reads = num_orig_reads - num_contained_reads;
 
+	// Weight of each original read.
+	std::vector<float> orig_read_weights(num_orig_reads, 1.0f);
+	if (weights_file) {
+		info("Loading read weights from \"%s\"", weights_file);
+		const PackedIntVec weights(weights_file);
+		if (weights.size() != num_orig_reads)
+			fatal_error("\"%s\" has %zu read weights, but there are "
+				    "%zu reads", weights_file, weights.size(),
+				    num_orig_reads);
+		for (size_t i = 0; i < num_orig_reads; i++)
+			orig_read_weights[i] = weights[i];
+	}
+
 	info("%zu of %zu original reads were contained (%.2f%%)",
 	     num_contained_reads, num_orig_reads,
 	     TO_PERCENT(num_contained_reads, num_orig_reads));
@@ -73,8 +126,8 @@ int main(int argc, char **argv)
 	std::vector<size_t> new_to_old_indices(num_uncontained_reads, ~size_t(0));
 	std::vector<size_t> old_to_contained_indices(num_orig_reads, ~size_t(0));
 	size_t j = 0;
-	for (size_t i = 0; i < orig_reads.size(); i++) {
-		if (old_to_new_indices[i] == ~size_t(0)) {
+	for (size_t i = 0; i < num_orig_reads; i++) {
+		if (old_to_new_indices[i] == NONE) {
 			// The read exists in the original reads but not in the
 			// new reads, so it is a contained read.
 			old_to_contained_indices[i] = j;
@@ -120,36 +173,38 @@ int main(int argc, char **argv)
 			Overlap::read_idx_t uncontained_read_orig_idx;
 			Overlap::read_pos_t uncontained_read_overlap_beg;
 			Overlap::read_pos_t uncontained_read_overlap_end;
-
-			assert_overlap_valid(o, orig_reads, 1, 0);
+			Overlap::read_pos_t uncontained_read_len;
 
 			o.get(f_idx, f_beg, f_end, g_idx, g_beg, g_end, rc);
-			const BaseVec & f = orig_reads[f_idx];
-			const BaseVec & g = orig_reads[g_idx];
-			const BaseVec * uncontained_read;
 
 			assert(f_idx < num_orig_reads);
 			assert(g_idx < num_orig_reads);
 
+			const Overlap::read_pos_t f_len = orig_read_lens[f_idx];
+			const Overlap::read_pos_t g_len = orig_read_lens[g_idx];
+
+			if (get_verify_level() >= VERIFY_STRUCTURE)
+				assert_overlap_extents_valid(o, f_len, g_len, 1);
+
 			size_t contained_read_orig_idx = ~size_t(0);
-			if (f_beg == 0 && f_end == f.size() - 1) {
+			if (f_beg == 0 && f_end == f_len - 1) {
 				// Read f is contained
 				// ... but only count this overlap if g is NOT
 				// contained
-				if (old_to_new_indices[g_idx] != ~size_t(0)) {
+				if (old_to_new_indices[g_idx] != NONE) {
 					contained_read_orig_idx      = f_idx;
-					uncontained_read             = &g;
+					uncontained_read_len         = g_len;
 					uncontained_read_orig_idx    = g_idx;
 					uncontained_read_overlap_beg = g_beg;
 					uncontained_read_overlap_end = g_end;
 				}
-			} else if (g_beg == 0 && g_end == g.size() - 1) {
+			} else if (g_beg == 0 && g_end == g_len - 1) {
 				// Read g is contained
 				// ... but only count this overlap is f is NOT
 				// contained
-				if (old_to_new_indices[f_idx] != ~size_t(0)) {
+				if (old_to_new_indices[f_idx] != NONE) {
 					contained_read_orig_idx      = g_idx;
-					uncontained_read             = &f;
+					uncontained_read_len         = f_len;
 					uncontained_read_orig_idx    = f_idx;
 					uncontained_read_overlap_beg = f_beg;
 					uncontained_read_overlap_end = f_end;
@@ -158,7 +213,7 @@ int main(int argc, char **argv)
 
 			if (contained_read_orig_idx != ~size_t(0)) {
 				assert(old_to_new_indices[contained_read_orig_idx] ==
-				       ~size_t(0));
+				       NONE);
 				assert(old_to_contained_indices[contained_read_orig_idx] !=
 				       ~size_t(0));
 				// This is a containing overlap, and the read
@@ -174,7 +229,7 @@ int main(int argc, char **argv)
 					//
 					//                 |overhang|
 					overhang_len = uncontained_read_overlap_beg;
-					underhang_len = uncontained_read->length() -
+					underhang_len = uncontained_read_len -
 							(uncontained_read_overlap_end + 1);
 				} else {
 					//
@@ -183,9 +238,9 @@ int main(int argc, char **argv)
 					//  ------------------------>
 					//
 					//                 |overhang|
-					assert(uncontained_read->length() >=
+					assert(uncontained_read_len >=
 					       uncontained_read_overlap_end + 1);
-					overhang_len = uncontained_read->length() -
+					overhang_len = uncontained_read_len -
 						       (uncontained_read_overlap_end + 1);
 					underhang_len = uncontained_read_overlap_beg;
 				}
@@ -210,13 +265,22 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (get_verify_level() >= VERIFY_FULL) {
+		info("Checking the original overlaps against the original reads");
+		BaseVecVec orig_reads(orig_reads_file);
+		assert(orig_reads.size() == num_orig_reads);
+		foreach (const OverlapVecVec::OverlapSet & overlap_set, orig_overlaps)
+			foreach(const Overlap & o, overlap_set)
+				assert_overlap_valid(o, orig_reads, 1, 0);
+	}
+
 	info("Reading string graph from \"%s\"", graph_file);
 	AnyStringGraph graph(graph_file);
 
-	info("Mapping %zu contained reads into the string graph", num_contained_reads);
-
-	// Map the contained reads into the graph, given the overlap to use to
-	// map each contained read.
+	// Locate both ends of each contained read, given the overlap to use to
+	// map each end.
+	std::vector<ContainedReadEnd> contained_read_ends;
+	contained_read_ends.reserve(num_contained_reads * 2);
 	for (size_t i = 0; i < num_contained_reads; i++) {
 
 		// Original index of this contained read
@@ -237,7 +301,7 @@ int main(int argc, char **argv)
 		// contained, and it must have at least 1 overlap with an
 		// uncontained read.
 		assert(contained_read_orig_idx < num_orig_reads);
-		assert(old_to_new_indices[contained_read_orig_idx] == ~size_t(0));
+		assert(old_to_new_indices[contained_read_orig_idx] == NONE);
 		assert(o != NULL);
 		o->get_indices(f_idx, g_idx);
 		if (f_idx == contained_read_orig_idx) {
@@ -248,9 +312,10 @@ int main(int argc, char **argv)
 		}
 		assert(uncontained_read_new_idx < num_uncontained_reads);
 		uncontained_read_dir = (o->is_rc() ? 1 : 0);
-		graph.map_contained_read(uncontained_read_new_idx,
-					 uncontained_read_dir,
-					 shortest_overhang_lens[i]);
+		contained_read_ends.push_back({uncontained_read_new_idx,
+					       uncontained_read_dir,
+					       shortest_overhang_lens[i],
+					       orig_read_weights[contained_read_orig_idx]});
 
 		// Map the underhang
 		o = shortest_underhang_overlaps[i];
@@ -264,11 +329,23 @@ int main(int argc, char **argv)
 		}
 		assert(uncontained_read_new_idx < num_uncontained_reads);
 		uncontained_read_dir = (o->is_rc() ? 0 : 1);
-		graph.map_contained_read(uncontained_read_new_idx,
-					 uncontained_read_dir,
-					 shortest_overhang_lens[i]);
+		contained_read_ends.push_back({uncontained_read_new_idx,
+					       uncontained_read_dir,
+					       shortest_overhang_lens[i],
+					       orig_read_weights[contained_read_orig_idx]});
+	}
+
+	if (weights_file) {
+		info("Weighting the uncontained reads in the string graph");
+		std::vector<float> read_weights(num_uncontained_reads);
+		for (size_t i = 0; i < num_uncontained_reads; i++)
+			read_weights[i] = orig_read_weights[new_to_old_indices[i]];
+		graph.set_read_weights(read_weights);
 	}
 
+	info("Mapping %zu contained reads into the string graph", num_contained_reads);
+	graph.map_contained_reads(contained_read_ends);
+
 	info("Writing string graph to \"%s\"", out_graph_file);
 	graph.write(out_graph_file);
 	return 0;
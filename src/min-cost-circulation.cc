@@ -1,7 +1,9 @@
 #include "AnyStringGraph.h"
+#include <getopt.h>
 
 DEFINE_USAGE(
-"Usage: min-cost-circulation GRAPH_FILE OUT_GRAPH_FILE\n"
+"Usage: min-cost-circulation [--solver=SOLVER] [--verify=LEVEL]\n"
+"                            GRAPH_FILE OUT_GRAPH_FILE\n"
 "\n"
 "Solves a minimum-cost circulation problem on a directed or bidirected\n"
 "string graph.\n"
@@ -12,14 +14,36 @@ DEFINE_USAGE(
 "Output:\n"
 "      OUT_GRAPH_FILE:  The resulting graph with each edge labeled with a\n"
 "                       traversal count.\n"
+"\n"
+"Options:\n"
+CIRCULATION_SOLVER_USAGE
+VERIFY_USAGE
 );
 
+static const char *optstring = "h";
+static const struct option longopts[] = {
+	{"solver", required_argument, NULL, 's'},
+	END_LONGOPTS
+};
+
 int main(int argc, char *argv[])
 {
-	USAGE_IF(argc != 3);
-	info("Loading string graph from \"%s\"", argv[1]);
-	AnyStringGraph graph(argv[1]);
-	graph.min_cost_circulation();
-	info("Writing string graph to \"%s\"", argv[2]);
-	graph.write(argv[2]);
+	int c;
+	circulation_solver solver = SOLVER_NETWORK_SIMPLEX;
+	for_opt(c) {
+		switch (c) {
+		case 's':
+			solver = parse_circulation_solver(optarg);
+			break;
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 2);
+	info("Loading string graph from \"%s\"", argv[0]);
+	AnyStringGraph graph(argv[0]);
+	graph.min_cost_circulation(solver);
+	info("Writing string graph to \"%s\"", argv[1]);
+	graph.write(argv[1]);
 }
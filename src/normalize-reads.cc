@@ -0,0 +1,267 @@
+#include "BaseVecVec.h"
+#include "CountMinSketch.h"
+#include "Kmer.h"
+#include "PackedIntVec.h"
+#include "parallel.h"
+#include <algorithm>
+#include <getopt.h>
+#include <unordered_map>
+
+DEFINE_USAGE(
+"Usage: normalize-reads [OPTIONS] READS_FILE OUT_READS_FILE\n"
+"\n"
+"Normalizes the coverage of a read set (\"digital normalization\"): the reads\n"
+"are considered in order, and each one is kept only if the median abundance\n"
+"of its k-mers among the reads kept so far is below the target coverage.\n"
+"Where the genome is already covered to the target, further reads are\n"
+"dropped, so the size of the output depends on the size of the genome rather\n"
+"than the depth of sequencing.  The k-mer abundances are tracked in a\n"
+"count-min sketch of fixed size, and the reads are read and written a batch\n"
+"at a time, so the memory used does not grow with the depth either.\n"
+"\n"
+"Each dropped read is attributed to a kept read with which it shares a\n"
+"minimizer, a k-mer sampled from the read in a way that overlapping reads\n"
+"tend to agree on.  With --weights, the number of original reads that each\n"
+"kept read stands for is written out, so that map-contained-reads can weight\n"
+"the reads and the A-statistics stay calibrated to the original coverage.\n"
+"\n"
+"Input:\n"
+"      READS_FILE:      FASTQ, FASTA, or binary reads (BaseVecVec) file.\n"
+"\n"
+"Output:\n"
+"      OUT_READS_FILE:  File to write the kept reads to, in their original\n"
+"                       order.  The format is chosen as in convert-reads.\n"
+"\n"
+"Options:\n"
+"   -k, --kmer-len=K            Length of the k-mers: 16, 20, 24, 28 or 32.\n"
+"                               Default: 20.\n"
+"   -c, --target-coverage=C     Keep a read only if the median abundance of\n"
+"                               its k-mers is less than C.  Default: 20.\n"
+"   -b, --sketch-bits=BITS      Use 4 rows of 2^BITS counters for the\n"
+"                               count-min sketch.  Default: 22 (64 MiB).\n"
+"   -w, --weights=WEIGHTS_FILE  Write the weight of each kept read to\n"
+"                               WEIGHTS_FILE, as a packed integer vector.\n"
+"   -h, --help\n"
+VERIFY_USAGE
+);
+
+static const char *optstring = "k:c:b:w:h";
+static const struct option longopts[] = {
+	{"kmer-len", required_argument, NULL, 'k'},
+	{"target-coverage", required_argument, NULL, 'c'},
+	{"sketch-bits", required_argument, NULL, 'b'},
+	{"weights", required_argument, NULL, 'w'},
+	END_LONGOPTS
+};
+
+// Number of consecutive k-mers in each window from which a minimizer is chosen.
+static const size_t MINIMIZER_WINDOW = 16;
+
+// Reads are decided in batches.  The reads of a batch are decided in parallel
+// against the sketch as it was before the batch, so the result does not depend
+// on the number of threads, but the reads of a batch cannot see each other.  So
+// the batches start small and grow with the number of reads already seen, up
+// to MAX_BATCH_SIZE.
+static const size_t MIN_BATCH_SIZE = 64;
+static const size_t MAX_BATCH_SIZE = 4096;
+
+//
+// Normalize the reads from @reader to @target_coverage with K-mers, writing the
+// kept reads to @writer as they are decided, and set the weight of each kept
+// read: 1 plus the number of dropped reads attributed to it.
+//
+// The reads are read and decided a batch at a time, so only one batch of reads
+// is held in memory.  For each batch, in parallel, the median abundance of each
+// read's k-mers is estimated and the read's minimizers--- the k-mer of least
+// hash value in each window of MINIMIZER_WINDOW consecutive k-mers--- are
+// found.  The k-mers of the kept reads are then added to the sketch, in
+// parallel.  Last, in order, each kept read is written and registers its
+// minimizers that no earlier kept read has, and each dropped read is
+// attributed to the first kept read found under one of its minimizers, or to
+// the last kept read if none is found.  The map of minimizers and the weights
+// grow with the number of kept reads, so with the size of the genome.
+//
+template <unsigned K>
+static void normalize_reads(BaseVecVecReader & reader,
+			    BaseVecVecWriter & writer,
+			    const unsigned target_coverage,
+			    const unsigned sketch_bits,
+			    std::vector<uint64_t> & weights)
+{
+	CountMinSketch sketch(sketch_bits);
+	std::unordered_map<uint64_t, size_t> minimizer_reads;
+	std::vector<std::vector<uint64_t> > minimizers(MAX_BATCH_SIZE);
+	std::vector<unsigned char> keep(MAX_BATCH_SIZE);
+	BaseVecVec reads;
+	const size_t NONE = ~size_t(0);
+	size_t last_kept_idx = NONE;
+	size_t num_reads = 0;
+	size_t num_kept = 0;
+	size_t num_attributed = 0;
+	size_t num_unattributed = 0;
+
+	info("Normalizing reads to %u-mer coverage %u, with a %zu-byte "
+	     "count-min sketch", K, target_coverage, sketch.memory_size());
+
+	weights.clear();
+
+	for (;;) {
+		const size_t batch_size = std::max(MIN_BATCH_SIZE,
+						   std::min(MAX_BATCH_SIZE, num_reads / 16));
+		if (reader.read_batch(reads, batch_size) == 0)
+			break;
+		num_reads += reads.size();
+
+		#pragma omp parallel
+		{
+			std::vector<uint64_t> hashes;
+			std::vector<uint32_t> counts;
+			#pragma omp for schedule(dynamic, 64)
+			for (size_t i = 0; i < reads.size(); i++) {
+				hashes.clear();
+				for_each_kmer<K>(reads[i], [&](size_t pos, const Kmer<K> & kmer) {
+					hashes.push_back(CountMinSketch::mix(kmer.hash()));
+				});
+				std::vector<uint64_t> & mins = minimizers[i];
+				mins.clear();
+				if (hashes.empty()) {
+					// Reads shorter than K are always kept.
+					keep[i] = 1;
+					continue;
+				}
+				counts.resize(hashes.size());
+				for (size_t j = 0; j < hashes.size(); j++)
+					counts[j] = sketch.estimate(hashes[j]);
+				std::nth_element(counts.begin(),
+						 counts.begin() + counts.size() / 2,
+						 counts.end());
+				keep[i] = (counts[counts.size() / 2] < target_coverage);
+
+				const size_t w = std::min(MINIMIZER_WINDOW, hashes.size());
+				for (size_t j = 0; j + w <= hashes.size(); j++) {
+					const uint64_t m = *std::min_element(
+							hashes.begin() + j,
+							hashes.begin() + j + w);
+					if (mins.empty() || mins.back() != m)
+						mins.push_back(m);
+				}
+			}
+
+			#pragma omp for schedule(dynamic, 64)
+			for (size_t i = 0; i < reads.size(); i++) {
+				if (!keep[i])
+					continue;
+				for_each_kmer<K>(reads[i], [&](size_t pos, const Kmer<K> & kmer) {
+					sketch.add(CountMinSketch::mix(kmer.hash()));
+				});
+			}
+		}
+
+		for (size_t i = 0; i < reads.size(); i++) {
+			const std::vector<uint64_t> & mins = minimizers[i];
+			if (keep[i]) {
+				writer.push_back(reads[i]);
+				foreach (const uint64_t m, mins)
+					minimizer_reads.insert(std::make_pair(m, num_kept));
+				weights.push_back(1);
+				last_kept_idx = num_kept++;
+				continue;
+			}
+			size_t kept_idx = NONE;
+			foreach (const uint64_t m, mins) {
+				std::unordered_map<uint64_t, size_t>::const_iterator it =
+					minimizer_reads.find(m);
+				if (it != minimizer_reads.end()) {
+					kept_idx = it->second;
+					break;
+				}
+			}
+			if (kept_idx != NONE) {
+				num_attributed++;
+			} else {
+				kept_idx = last_kept_idx;
+				num_unattributed++;
+			}
+			assert(kept_idx != NONE);
+			weights[kept_idx]++;
+		}
+	}
+
+	info("Kept %zu of %zu reads (%.2f%%)", num_kept, num_reads,
+	     TO_PERCENT(num_kept, num_reads));
+	info("Attributed %zu dropped reads by minimizer and %zu to the previous "
+	     "kept read (%zu minimizers)", num_attributed, num_unattributed,
+	     minimizer_reads.size());
+}
+
+int main(int argc, char *argv[])
+{
+	int c;
+	unsigned kmer_len = 20;
+	unsigned target_coverage = 20;
+	unsigned sketch_bits = 22;
+	const char *weights_file = NULL;
+	for_opt(c) {
+		switch (c) {
+		case 'k':
+			kmer_len = parse_long(optarg, "--kmer-len", 16, 32);
+			break;
+		case 'c':
+			target_coverage = parse_long(optarg, "--target-coverage",
+						     1, INT_MAX);
+			break;
+		case 'b':
+			sketch_bits = parse_long(optarg, "--sketch-bits", 8, 32);
+			break;
+		case 'w':
+			weights_file = optarg;
+			break;
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 2);
+
+	BaseVecVecReader reader(argv[0]);
+	BaseVecVecWriter writer(argv[1]);
+	std::vector<uint64_t> weights;
+	info("Reading reads from \"%s\" and writing the kept reads to \"%s\"",
+	     argv[0], argv[1]);
+	switch (kmer_len) {
+	case 16:
+		normalize_reads<16>(reader, writer, target_coverage, sketch_bits, weights);
+		break;
+	case 20:
+		normalize_reads<20>(reader, writer, target_coverage, sketch_bits, weights);
+		break;
+	case 24:
+		normalize_reads<24>(reader, writer, target_coverage, sketch_bits, weights);
+		break;
+	case 28:
+		normalize_reads<28>(reader, writer, target_coverage, sketch_bits, weights);
+		break;
+	case 32:
+		normalize_reads<32>(reader, writer, target_coverage, sketch_bits, weights);
+		break;
+	default:
+		fatal_error("Unsupported k-mer length %u (expected 16, 20, "
+			    "24, 28 or 32)", kmer_len);
+	}
+	assert(writer.num_written() == weights.size());
+	writer.close();
+
+	// A dropped read can be attributed to any earlier kept read, so the
+	// weights are only known once all the reads have been seen.
+	if (weights_file) {
+		uint64_t max_weight = 0;
+		foreach (const uint64_t w, weights)
+			max_weight = std::max(max_weight, w);
+		PackedIntVec packed_weights(weights.size(),
+					    PackedIntVec::bytes_needed(max_weight));
+		for (size_t i = 0; i < weights.size(); i++)
+			packed_weights.set(i, weights[i]);
+		info("Writing read weights to \"%s\"", weights_file);
+		packed_weights.write(weights_file);
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#ifdef _OPENMP
+#	include <omp.h>
+#else
+static inline int omp_get_max_threads() { return 1; }
+static inline int omp_get_num_threads() { return 1; }
+static inline int omp_get_thread_num() { return 0; }
+#endif
+
+//
+// Compute, in parallel, the new indices of the elements [0, @n) of an array
+// that is being compacted so that only the elements for which @keep(i) returns
+// %true remain, in their original order.
+//
+// @assign(i, new_idx) is called exactly once for every element.  @new_idx is
+// the index of element @i in the compacted array, or ~size_t(0) if the element
+// is not kept.  Calls for different elements may be made concurrently.
+//
+// This is a two-pass blocked prefix sum: each thread counts the kept elements in
+// one block of the array, the per-block counts are scanned, and then each thread
+// numbers the elements of its block starting at the block's offset.
+//
+// Returns the number of kept elements.
+//
+template <typename Keep, typename Assign>
+size_t parallel_compact_indices(const size_t n, Keep keep, Assign assign)
+{
+	const size_t num_blocks = omp_get_max_threads();
+	std::vector<size_t> block_offsets(num_blocks + 1, 0);
+
+	#pragma omp parallel for schedule(static, 1)
+	for (size_t b = 0; b < num_blocks; b++) {
+		const size_t end = n * (b + 1) / num_blocks;
+		size_t count = 0;
+		for (size_t i = n * b / num_blocks; i < end; i++)
+			if (keep(i))
+				count++;
+		block_offsets[b + 1] = count;
+	}
+
+	for (size_t b = 0; b < num_blocks; b++)
+		block_offsets[b + 1] += block_offsets[b];
+
+	#pragma omp parallel for schedule(static, 1)
+	for (size_t b = 0; b < num_blocks; b++) {
+		const size_t end = n * (b + 1) / num_blocks;
+		size_t new_idx = block_offsets[b];
+		for (size_t i = n * b / num_blocks; i < end; i++) {
+			if (keep(i))
+				assign(i, new_idx++);
+			else
+				assign(i, ~size_t(0));
+		}
+	}
+	return block_offsets[num_blocks];
+}
@@ -3,7 +3,8 @@
 #include <getopt.h>
 
 DEFINE_USAGE(
-"Usage: print-string-graph [--dot] [--seqs] [--stats] GRAPH_FILE\n"
+"Usage: print-string-graph [--dot] [--seqs] [--stats] [--verify=LEVEL]\n"
+"                          GRAPH_FILE\n"
 "\n"
 "Prints a directed or bidirected string graph.\n"
 "\n"
@@ -14,6 +15,7 @@ DEFINE_USAGE(
 "   --dot    Print the graph in DOT format.\n"
 "   --seqs   Show edge sequence labels instead of their lengths.\n"
 "   --stats  Print statistics about the graph.\n"
+VERIFY_USAGE
 );
 
 static const char *optstring = "h";
@@ -1,10 +1,14 @@
 #include "Overlap.h"
 #include "BaseVecVec.h"
+#include "PackedIntVec.h"
+#include "parallel.h"
 #include "util.h"
+#include <getopt.h>
 
 DEFINE_USAGE(
-"Usage: remove-contained-reads READS_FILE UNCONTAINED_READS_FILE\n"
-"                              OVERLAPS_FILE UNCONTAINED_OVERLAPS_FILE\n"
+"Usage: remove-contained-reads [--verify=LEVEL] READS_FILE\n"
+"                              UNCONTAINED_READS_FILE OVERLAPS_FILE\n"
+"                              UNCONTAINED_OVERLAPS_FILE\n"
 "                              OLD_TO_NEW_INDICES_FILE\n"
 "\n"
 "Given a set of reads and all overlaps that were computed from them, find all\n"
@@ -24,18 +28,37 @@ DEFINE_USAGE(
 "      UNCONTAINED_OVERLAPS_FILE: The set of overlaps, with overlaps with\n"
 "                                 contained reads removed.\n"
 "      OLD_TO_NEW_INDICES_FILE:   A map from the old read indices to the new\n"
-"                                 read indices.\n"
+"                                 read indices, as a packed array of 32-bit\n"
+"                                 (or 40-bit, for very large read sets)\n"
+"                                 integers.  Contained reads map to the\n"
+"                                 largest representable value.\n"
+"\n"
+"Options:\n"
+VERIFY_USAGE
 );
 
 
+static const char *optstring = "h";
+static const struct option longopts[] = {
+	END_LONGOPTS
+};
+
 int main(int argc, char **argv)
 {
-	USAGE_IF(argc != 6);
-	const char *reads_file = argv[1];
-	const char *uncontained_reads_file = argv[2];
-	const char *overlaps_file = argv[3];
-	const char *uncontained_overlaps_file = argv[4];
-	const char *old_to_new_indices_file = argv[5];
+	int c;
+	for_opt(c) {
+		switch (c) {
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 5);
+	const char *reads_file = argv[0];
+	const char *uncontained_reads_file = argv[1];
+	const char *overlaps_file = argv[2];
+	const char *uncontained_overlaps_file = argv[3];
+	const char *old_to_new_indices_file = argv[4];
 
 	info("Loading reads from \"%s\"", reads_file);
 	BaseVecVec bvv(reads_file);
@@ -47,11 +70,13 @@ int main(int argc, char **argv)
 
 	assert(bvv.size() == ovv.size());
 
-	std::vector<bool> read_contained(bvv.size(), false);
+	const size_t num_reads = bvv.size();
+	std::vector<unsigned char> read_contained(num_reads, 0);
 
 	info("Searching for overlaps indicating contained reads");
-	foreach (const OverlapVecVec::OverlapSet & overlap_set, ovv) {
-		foreach(const Overlap & o, overlap_set) {
+	#pragma omp parallel for schedule(dynamic, 4096)
+	for (size_t i = 0; i < num_reads; i++) {
+		foreach(const Overlap & o, ovv[i]) {
 			Overlap::read_idx_t f_idx;
 			Overlap::read_pos_t f_beg;
 			Overlap::read_pos_t f_end;
@@ -60,86 +85,100 @@ int main(int argc, char **argv)
 			Overlap::read_pos_t g_end;
 			bool rc;
 
-			assert_overlap_valid(o, bvv, 1, 0);
+			verify_overlap(o, bvv, 1, 0);
 
 			o.get(f_idx, f_beg, f_end, g_idx, g_beg, g_end, rc);
 			const BaseVec & f = bvv[f_idx];
 			const BaseVec & g = bvv[g_idx];
 
+			// The contained read may be marked from another
+			// read's overlap set at the same time.
 			if ((f_beg == 0 && f_end == f.size() - 1))
-				read_contained[f_idx] = true;
+				atomic_set(&read_contained[f_idx], (unsigned char)1);
 			else if (g_beg == 0 && g_end == g.size() - 1)
-				read_contained[g_idx] = true;
+				atomic_set(&read_contained[g_idx], (unsigned char)1);
 		}
 	}
 
 	info("Computing new read indices");
-	std::vector<size_t> old_to_new_indices(bvv.size());
-	BaseVecVec uncontained_bvv;
-	size_t i, j;
-	for (i = 0, j = 0; i < bvv.size(); i++) {
-		if (read_contained[i]) {
-			old_to_new_indices[i] = std::numeric_limits<size_t>::max();
-			bvv[i].destroy();
-		} else {
-			old_to_new_indices[i] = j++;
-			uncontained_bvv.push_back(bvv[i]);
-		}
-	}
-	size_t num_contained_reads = bvv.size() - uncontained_bvv.size();
+	PackedIntVec old_to_new_indices(num_reads,
+					std::max(4U, PackedIntVec::bytes_needed(num_reads)));
+	const PackedIntVec::value_type NONE = old_to_new_indices.max_value();
+	const size_t num_uncontained_reads =
+		parallel_compact_indices(num_reads,
+			[&](size_t i) { return !read_contained[i]; },
+			[&](size_t i, size_t new_idx) {
+				old_to_new_indices.set(i, (new_idx == ~size_t(0)) ?
+							  NONE : new_idx);
+			});
+	const size_t num_contained_reads = num_reads - num_uncontained_reads;
 	info("%zu of %zu reads were contained (%.2f%%)",
-	     num_contained_reads, bvv.size(),
-	     TO_PERCENT(num_contained_reads, bvv.size()));
-
-	bvv.clear();
+	     num_contained_reads, num_reads,
+	     TO_PERCENT(num_contained_reads, num_reads));
 
 	info("Deleting overlaps for the contained reads");
 	unsigned long num_overlaps_deleted = 0;
 	unsigned long num_overlaps = 0;
-	for (i = 0, j = 0; i < ovv.size(); i++) {
-		if (!read_contained[i]) {
-			std::set<Overlap> new_set;
-			foreach(const Overlap & o, ovv[i]) {
-				Overlap::read_idx_t f_idx;
-				Overlap::read_idx_t g_idx;
-				num_overlaps++;
-				o.get_indices(f_idx, g_idx);
-				if (!read_contained[f_idx] && !read_contained[g_idx]) {
-					f_idx = old_to_new_indices[f_idx];
-					g_idx = old_to_new_indices[g_idx];
-					Overlap new_o(o);
-					new_o.set_indices(f_idx, g_idx);
-					new_set.insert(new_o);
-				} else {
-					num_overlaps_deleted++;
-				}
+	#pragma omp parallel for schedule(dynamic, 4096) \
+		reduction(+:num_overlaps, num_overlaps_deleted)
+	for (size_t i = 0; i < num_reads; i++) {
+		OverlapVecVec::OverlapSet & overlap_set = ovv[i];
+		num_overlaps += overlap_set.size();
+		if (read_contained[i]) {
+			num_overlaps_deleted += overlap_set.size();
+			OverlapVecVec::OverlapSet().swap(overlap_set);
+			bvv[i].destroy();
+			continue;
+		}
+		// Renumber the overlaps between uncontained reads and rebuild
+		// the set from them.  The elements of a std::set cannot be
+		// changed in place.  Renumbering keeps the relative order of
+		// the uncontained reads, so the renumbered overlaps are still
+		// sorted and the set is rebuilt in linear time.
+		std::vector<Overlap> kept_overlaps;
+		kept_overlaps.reserve(overlap_set.size());
+		foreach(const Overlap & o, overlap_set) {
+			Overlap::read_idx_t f_idx;
+			Overlap::read_idx_t g_idx;
+			o.get_indices(f_idx, g_idx);
+			if (!read_contained[f_idx] && !read_contained[g_idx]) {
+				kept_overlaps.push_back(o);
+				kept_overlaps.back().set_indices(
+						old_to_new_indices[f_idx],
+						old_to_new_indices[g_idx]);
+			} else {
+				num_overlaps_deleted++;
 			}
-			ovv[j++] = new_set;
 		}
+		assert2(std::is_sorted(kept_overlaps.begin(), kept_overlaps.end()));
+		OverlapVecVec::OverlapSet(kept_overlaps.begin(),
+					  kept_overlaps.end()).swap(overlap_set);
 	}
 	info("Deleted %lu of %lu overlaps (%.2f%%)",
 	     num_overlaps_deleted, num_overlaps,
 	     TO_PERCENT(num_overlaps_deleted, num_overlaps));
-	ovv.resize(j);
 
-	assert(ovv.size() == uncontained_bvv.size());
+	// Move each uncontained read and its overlap set down to its new index.
+	// A new index is never greater than the old index, and only the BaseVec
+	// handles and set headers are moved, so this is done in place.
+	for (size_t i = 0; i < num_reads; i++) {
+		const PackedIntVec::value_type j = old_to_new_indices[i];
+		if (j != NONE && j != i) {
+			bvv[j] = bvv[i];
+			ovv[j].swap(ovv[i]);
+		}
+	}
+	bvv.resize(num_uncontained_reads);
+	ovv.resize(num_uncontained_reads);
 
 	info("Writing uncontained reads to \"%s\"", uncontained_reads_file);
-	uncontained_bvv.write(uncontained_reads_file);
+	bvv.write(uncontained_reads_file);
 	info("Writing uncontained overlaps to \"%s\"", uncontained_overlaps_file);
 	ovv.write(uncontained_overlaps_file);
 
 	info("Writing map from old read indices to new read indices to \"%s\"",
 	     old_to_new_indices_file);
-	{
-		std::ofstream out(old_to_new_indices_file);
-		boost::archive::binary_oarchive ar(out);
-		ar << old_to_new_indices;
-		out.close();
-		if (!out)
-			fatal_error_with_errno("Error writing to \"%s\"",
-					       old_to_new_indices_file);
-	}
+	old_to_new_indices.write(old_to_new_indices_file);
 
 	info("Done");
 	return 0;
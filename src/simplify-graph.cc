@@ -0,0 +1,96 @@
+#include "DirectedStringGraph.h"
+#include <getopt.h>
+#include <limits.h>
+
+DEFINE_USAGE(
+"Usage: simplify-graph [OPTIONS] DIGRAPH_FILE OUT_DIGRAPH_FILE\n"
+"\n"
+"Simplifies a directed string graph by clipping tips and popping bubbles,\n"
+"which are mostly made by sequencing errors, and collapsing the unbranched\n"
+"paths this leaves.  This is repeated until nothing changes or the maximum\n"
+"number of rounds is reached.\n"
+"\n"
+"A tip is an edge into a dead end from a vertex that has other edges leaving\n"
+"it.  A bubble is an edge whose sequence is also spelled, with few edits, by\n"
+"another path between the same two vertices whose edges have more reads\n"
+"mapped to them.\n"
+"\n"
+"Input:\n"
+"      DIGRAPH_FILE:      A directed string graph in binary format, usually\n"
+"                         with unbranched paths collapsed.\n"
+"\n"
+"Output:\n"
+"      OUT_DIGRAPH_FILE:  The simplified graph.\n"
+"\n"
+"Options:\n"
+"   --max-tip-len=LEN           Only clip tips of at most LEN bases.\n"
+"                               Default: 100.\n"
+"   --max-tip-reads=N           Only clip tips with at most N mapped reads.\n"
+"                               Default: 3.\n"
+"   --max-bubble-len=LEN        Only remove bubble edges of at most LEN\n"
+"                               bases.  Default: 200.\n"
+"   --max-bubble-depth=DEPTH    Search for the other path of a bubble at\n"
+"                               most DEPTH edges deep.  Default: 3.\n"
+"   --min-bubble-identity=FRAC  Require the two sequences of a bubble to\n"
+"                               have an identity of at least FRAC.\n"
+"                               Default: 0.9.\n"
+"   --max-rounds=N              Do at most N rounds.  Default: 5.\n"
+VERIFY_USAGE
+);
+
+static const char *optstring = "h";
+static const struct option longopts[] = {
+	{"max-tip-len", required_argument, NULL, 't'},
+	{"max-tip-reads", required_argument, NULL, 'r'},
+	{"max-bubble-len", required_argument, NULL, 'b'},
+	{"max-bubble-depth", required_argument, NULL, 'd'},
+	{"min-bubble-identity", required_argument, NULL, 'i'},
+	{"max-rounds", required_argument, NULL, 'n'},
+	END_LONGOPTS
+};
+
+int main(int argc, char *argv[])
+{
+	int c;
+	simplify_params params;
+	for_opt(c) {
+		switch (c) {
+		case 't':
+			params.max_tip_len = parse_long(optarg, "--max-tip-len",
+							0, UINT_MAX);
+			break;
+		case 'r':
+			params.max_tip_mapped_reads =
+				parse_double(optarg, "--max-tip-reads",
+					     0, 1e30);
+			break;
+		case 'b':
+			params.max_bubble_len = parse_long(optarg, "--max-bubble-len",
+							   0, UINT_MAX);
+			break;
+		case 'd':
+			params.max_bubble_depth =
+				parse_long(optarg, "--max-bubble-depth", 1, 100);
+			break;
+		case 'i':
+			params.min_bubble_identity =
+				parse_double(optarg, "--min-bubble-identity",
+					     0, 1);
+			break;
+		case 'n':
+			params.max_rounds = parse_long(optarg, "--max-rounds",
+						       0, UINT_MAX);
+			break;
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 2);
+
+	info("Loading directed string graph from \"%s\"", argv[0]);
+	DirectedStringGraph graph(argv[0]);
+	graph.simplify(params);
+	info("Writing directed string graph to \"%s\"", argv[1]);
+	graph.write(argv[1]);
+}
@@ -1,7 +1,8 @@
 #include "AnyStringGraph.h"
+#include <getopt.h>
 
 DEFINE_USAGE(
-"Usage: transitive-reduction GRAPH_FILE OUT_GRAPH_FILE\n"
+"Usage: transitive-reduction [--verify=LEVEL] GRAPH_FILE OUT_GRAPH_FILE\n"
 "\n"
 "Performs a transitive reduction on a directed or bidirected string graph.\n"
 "\n"
@@ -10,14 +11,30 @@ DEFINE_USAGE(
 "\n"
 "Output:\n"
 "      OUT_GRAPH_FILE:  The graph with transitive reduction done.\n"
+"\n"
+"Options:\n"
+VERIFY_USAGE
 );
 
+static const char *optstring = "h";
+static const struct option longopts[] = {
+	END_LONGOPTS
+};
+
 int main(int argc, char *argv[])
 {
-	USAGE_IF(argc != 3);
-	info("Loading string graph from \"%s\"", argv[1]);
-	AnyStringGraph graph(argv[1]);
+	int c;
+	for_opt(c) {
+		switch (c) {
+		PROCESS_OTHER_OPTS
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	USAGE_IF(argc != 2);
+	info("Loading string graph from \"%s\"", argv[0]);
+	AnyStringGraph graph(argv[0]);
 	graph.transitive_reduction();
-	info("Writing string graph to \"%s\"", argv[2]);
-	graph.write(argv[2]);
+	info("Writing string graph to \"%s\"", argv[1]);
+	graph.write(argv[1]);
 }
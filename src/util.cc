@@ -73,3 +73,52 @@ long long parse_long(const char *optstr, const char *argument,
 		fatal_error("Expected number <= %lld for argument %s", max, argument);
 	return n;
 }
+
+double parse_double(const char *optstr, const char *argument,
+		    double min, double max)
+{
+	char *tmp;
+	double x = strtod(optstr, &tmp);
+	if (tmp == optstr || *tmp)
+		fatal_error("Error parsing \"%s\": not a number", optstr);
+	if (x < min)
+		fatal_error("Expected number >= %g for argument %s", min, argument);
+	if (x > max)
+		fatal_error("Expected number <= %g for argument %s", max, argument);
+	return x;
+}
+
+static verify_level parse_verify_level(const char *level_str)
+{
+	static const char * const level_names[] =
+		{"none", "checksum", "structure", "full"};
+	for (size_t i = 0; i < sizeof(level_names) / sizeof(level_names[0]); i++)
+		if (strcmp(level_str, level_names[i]) == 0)
+			return verify_level(i);
+	fatal_error("Unknown verification level \"%s\" (expected none, "
+		    "checksum, structure, or full)", level_str);
+}
+
+static verify_level verify_level_from_env()
+{
+	const char *level_str = getenv("ASSEMBLER_VERIFY");
+	if (level_str && *level_str)
+		return parse_verify_level(level_str);
+	return VERIFY_STRUCTURE;
+}
+
+/* Initialized before main() runs, so it can be read from parallel code without
+ * synchronization. */
+static verify_level cur_verify_level = verify_level_from_env();
+
+/* Returns the current verification level. */
+verify_level get_verify_level()
+{
+	return cur_verify_level;
+}
+
+/* Sets the verification level from its name. */
+void set_verify_level(const char *level_str)
+{
+	cur_verify_level = parse_verify_level(level_str);
+}
@@ -27,11 +27,45 @@ extern void info(const char *format, ...);
 #define unreachable() \
 	fatal_error("unreachable() at %s:%d", __FILE__, __LINE__)
 
+//
+// How much checking of data structures is done as they are read, built, and
+// written.  Each level includes the checks of the levels below it.
+//
+// VERIFY_NONE:      No checking.
+// VERIFY_CHECKSUM:  Check the checksums in the headers of graph files.
+// VERIFY_STRUCTURE: Also check the structure of graphs and the extents of
+//                   overlaps.
+// VERIFY_FULL:      Also check the bases of overlaps and seeds against the
+//                   reads.
+//
+// The default is VERIFY_STRUCTURE, unless the environment variable
+// ASSEMBLER_VERIFY is set to one of "none", "checksum", "structure", or "full".
+// Tools also accept the --verify=LEVEL option, which takes precedence.
+//
+enum verify_level {
+	VERIFY_NONE,
+	VERIFY_CHECKSUM,
+	VERIFY_STRUCTURE,
+	VERIFY_FULL,
+};
+
+extern verify_level get_verify_level();
+extern void set_verify_level(const char *level_str);
+
 #define END_LONGOPTS \
+	{"verify",      required_argument, NULL, 'V'}, \
 	{"help",        no_argument,       NULL, 'h'}, \
 	{NULL,          0,                 NULL, 0}
 
+#define VERIFY_USAGE \
+"   --verify=LEVEL  How much checking to do: none, checksum, structure, or\n" \
+"                   full.  Overrides the ASSEMBLER_VERIFY environment\n" \
+"                   variable.  The default is structure.\n"
+
 #define PROCESS_OTHER_OPTS \
+		case 'V':			\
+			set_verify_level(optarg);	\
+			break;			\
 		default:			\
 		case 'h':			\
 			usage();			\
@@ -52,6 +86,9 @@ static void usage() \
 extern long long parse_long(const char *optstr, const char *argument,
 			    long long min = INT_MIN, long long max = INT_MAX);
 
+extern double parse_double(const char *optstr, const char *argument,
+			   double min, double max);
+
 #define assert2 assert
 
 